@@ -7,8 +7,10 @@
 #include "Histogram.hpp"
 #include "ContourExtractor.hpp"
 #include "FourierImage.hpp"
+#include "ThreadPool.hpp"
 #include "parameters.hpp"
 #include <exception>
+#include <fstream>
 
 using namespace std;
 
@@ -71,6 +73,9 @@ int main(int argc, char **argv) {
         cerr << "Warning: No mode specified. Run ./main for to see the help screen" << endl;
     }
 
+    ThreadPool::setGlobalThreads(NUM_THREADS);
+    FrequencyMask::setCacheBudget(FOURIER_MASK_CACHE_BYTES);
+
     Image image(input_name);
 
     if (output_name.empty()) {
@@ -96,11 +101,16 @@ int main(int argc, char **argv) {
         // show information about what is being done
         cout << "Denoising image: " << input_name << endl;
         cout << "Parameters used for denoising are:" << endl;
-        cout << "\tKernel size: " << DENOISER_KERNEL_SIZE << endl;
+        if (DENOISER_RECURSIVE) {
+            cout << "\tRecursive Gaussian" << endl;
+        } else {
+            cout << "\tKernel size: " << DENOISER_KERNEL_SIZE << endl;
+        }
         cout << "\tSigma: " << DENOISER_SIGMA << endl;
         cout << "\tOutput file: " << output_name << endl;
         try {
-            Denoiser denoiser(DENOISER_KERNEL_SIZE, DENOISER_SIGMA);
+            Denoiser denoiser = DENOISER_RECURSIVE ? Denoiser::recursiveGaussian(DENOISER_SIGMA)
+                                                   : Denoiser(DENOISER_KERNEL_SIZE, DENOISER_SIGMA);
             Image denoised_image = denoiser.denoise(image, true);
             denoised_image.save(output_name, true);
             cout << "Denoising complete." << endl;
@@ -160,6 +170,17 @@ int main(int argc, char **argv) {
             cerr <<"Invalid filter type: " + FILTER_TYPE << endl;
             return 1;
         }
+        FrequencyMask::Profile profile;
+        if (FILTER_PROFILE == "ideal") {
+            profile = FrequencyMask::Profile::Ideal;
+        } else if (FILTER_PROFILE == "butterworth") {
+            profile = FrequencyMask::Profile::Butterworth;
+        } else if (FILTER_PROFILE == "gaussian") {
+            profile = FrequencyMask::Profile::Gaussian;
+        } else {
+            cerr << "Invalid filter profile: " + FILTER_PROFILE << endl;
+            return 1;
+        }
         //change output name by adding filter type
         size_t dot_pos = output_name.rfind('.');
         output_name.insert(dot_pos, "_" + FILTER_TYPE);
@@ -168,25 +189,42 @@ int main(int argc, char **argv) {
         cout << "Apply frequency domain filtering to image: " << input_name << endl;
         cout << "Parameters used are:" << endl;
         cout << "\tShow progress: " << SHOW_FOURIER_PROGRESS << endl;
+        cout << "\tThreads: " << ThreadPool::global().getNumThreads() << endl;
         cout << "\tShow Fourier Transform Images: " << SHOW_FOURIER_TRANSFORM_IMAGES << endl;
         cout << "\tLow cutoff: " << LOW_CUTOFF << endl;
         cout << "\tHigh cutoff: " << HIGH_CUTOFF << endl;
         cout << "\tFilter type: " << FILTER_TYPE << endl;
+        cout << "\tFilter profile: " << FILTER_PROFILE << endl;
+        cout << "\tKeep color: " << FOURIER_KEEP_COLOR << endl;
+        if (FOURIER_RAM_BUDGET > 0) {
+            cout << "\tRAM budget: " << FOURIER_RAM_BUDGET << " bytes (scratch file: " << FOURIER_SCRATCH_FILE << ")"
+                 << endl;
+        }
         cout << "\tOutput file: " << output_name << endl;
 
         try {
             FourierImage fourier_image(image);
-            cout << "Applying Fourier Transform..." << endl;
-            fourier_image.applyTransform(SHOW_FOURIER_PROGRESS);
+            fourier_image.enableOutOfCore(FOURIER_SCRATCH_FILE, FOURIER_RAM_BUDGET);
+            fourier_image.setMultiChannel(FOURIER_KEEP_COLOR);
+            if (!FOURIER_SPECTRUM_FILE.empty() && ifstream(FOURIER_SPECTRUM_FILE).good()) {
+                cout << "Loading Fourier Transform from " << FOURIER_SPECTRUM_FILE << "..." << endl;
+                fourier_image.loadTransform(FOURIER_SPECTRUM_FILE);
+            } else {
+                cout << "Applying Fourier Transform..." << endl;
+                fourier_image.applyTransform(SHOW_FOURIER_PROGRESS);
+                if (!FOURIER_SPECTRUM_FILE.empty()) {
+                    fourier_image.saveTransform(FOURIER_SPECTRUM_FILE);
+                }
+            }
             FourierImage original_fourier_image = fourier_image;
 
 
             if (FILTER_TYPE == "band") {
-                fourier_image.applyBandPassFilter(LOW_CUTOFF, HIGH_CUTOFF);
+                fourier_image.applyBandPassFilter(LOW_CUTOFF, HIGH_CUTOFF, profile, BUTTERWORTH_ORDER);
             } else if (FILTER_TYPE == "high") {
-                fourier_image.applyHighPassFilter(HIGH_CUTOFF);
+                fourier_image.applyHighPassFilter(HIGH_CUTOFF, profile, BUTTERWORTH_ORDER);
             } else if (FILTER_TYPE == "low") {
-                fourier_image.applyLowPassFilter(LOW_CUTOFF);
+                fourier_image.applyLowPassFilter(LOW_CUTOFF, profile, BUTTERWORTH_ORDER);
             }
 
             cout << "Applying Inverse Fourier Transform..." << endl;
@@ -7,9 +7,13 @@
 
 #include <string>
 
+/* Parallelism Parameters */
+int NUM_THREADS = 0; // 0 uses all hardware threads
+
 /* Denoiser Parameters */
 double DENOISER_SIGMA = 1;
 int DENOISER_KERNEL_SIZE = 3;
+bool DENOISER_RECURSIVE = false; // recursive Gaussian, whose cost does not depend on sigma (kernel size is ignored)
 
 /* Contour Extractor Parameters */
 double CONTOUR_EXTRACTOR_THRESHOLD = 0.3;
@@ -28,5 +32,12 @@ bool SHOW_FOURIER_TRANSFORM_IMAGES = true;
 double LOW_CUTOFF = 0.1;
 double HIGH_CUTOFF = 0.9;
 string FILTER_TYPE = "band"; // "band", "low", "high"
+string FILTER_PROFILE = "ideal"; // "ideal", "butterworth", "gaussian"
+int BUTTERWORTH_ORDER = 2;
+bool FOURIER_KEEP_COLOR = false; // filter each channel instead of the grayscale image
+string FOURIER_SPECTRUM_FILE = ""; // if set, the transform is loaded from this file, or saved to it if it is missing
+size_t FOURIER_RAM_BUDGET = 0; // bytes of the spectrum kept in memory, 0 keeps all of it (no scratch file)
+string FOURIER_SCRATCH_FILE = "fourier_scratch.bin";
+size_t FOURIER_MASK_CACHE_BYTES = (size_t) 256 << 20; // bytes of sampled filter masks kept for reuse, 0 disables it
 
 #endif //IMAGEPROCESSING_PARAMETERS_HPP
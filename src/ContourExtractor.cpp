@@ -100,8 +100,7 @@ void ContourExtractor::setDenoiser(int kernel_size, double sigma) {
  */
 Image ContourExtractor::extractContours(const Image &image, bool show) {
     // convert to grayscale
-    Image gray = image;
-    gray = gray.reduceChannels();
+    Image gray = image.reduceChannels();
 
     // denoise image
     Image denoised = this->denoiser.denoise(gray);
@@ -0,0 +1,203 @@
+//
+// Host calibration of the convolution methods, used to choose the fastest one.
+//
+
+#include "ConvolutionCalibration.hpp"
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+// Range of the lengths of the FFT blocks (powers of 2, the fastest transforms)
+static const int MIN_FFT_BLOCK = 128;
+static const int MAX_FFT_BLOCK = 1024;
+// Size of the image and of the kernel used to time the methods
+static const int CALIBRATION_SIZE = 256;
+static const int CALIBRATION_KERNEL_SIZE = 7;
+// Number of timed runs of each method, the fastest one is kept
+static const int CALIBRATION_RUNS = 3;
+
+// Process-wide calibration, measured on first use
+static unique_ptr<ConvolutionCalibration> global_calibration;
+static mutex global_calibration_mutex;
+
+/*!
+ * @brief Constructor for ConvolutionCalibration
+ * @param direct_cost Time of one multiply-add of the direct convolution, in nanoseconds.
+ * @param separable_cost Time of one multiply-add of the separable convolution, in nanoseconds.
+ * @param fft_cost Time of one unit of FFT work, in nanoseconds (see fftWork).
+ */
+ConvolutionCalibration::ConvolutionCalibration(double direct_cost, double separable_cost, double fft_cost) {
+    if (!(direct_cost > 0) || !(separable_cost > 0) || !(fft_cost > 0)) {
+        throw invalid_argument("Calibration costs must be positive.");
+    }
+    this->direct_cost = direct_cost;
+    this->separable_cost = separable_cost;
+    this->fft_cost = fft_cost;
+}
+
+/*!
+ * @brief Simple direct cost getter.
+ * @return Time of one multiply-add of the direct convolution, in nanoseconds.
+ */
+double ConvolutionCalibration::getDirectCost() const {
+    return this->direct_cost;
+}
+
+/*!
+ * @brief Simple separable cost getter.
+ * @return Time of one multiply-add of the separable convolution, in nanoseconds.
+ */
+double ConvolutionCalibration::getSeparableCost() const {
+    return this->separable_cost;
+}
+
+/*!
+ * @brief Simple FFT cost getter.
+ * @return Time of one unit of FFT work, in nanoseconds.
+ */
+double ConvolutionCalibration::getFFTCost() const {
+    return this->fft_cost;
+}
+
+/*!
+ * @brief Predicts the run time of a convolution.
+ * @param method Convolution method (not ConvolutionMethod::Auto).
+ * @param rows Number of rows of the image.
+ * @param cols Number of columns of the image.
+ * @param kernel_size Size of the (square) kernel.
+ * @return Predicted time, in nanoseconds.
+ */
+double ConvolutionCalibration::estimate(ConvolutionMethod method, int rows, int cols, int kernel_size) const {
+    double pixels = (double) rows * cols;
+    switch (method) {
+        case ConvolutionMethod::Direct:
+            return pixels * kernel_size * kernel_size * this->direct_cost;
+        case ConvolutionMethod::Separable:
+            return pixels * 2 * kernel_size * this->separable_cost;
+        case ConvolutionMethod::FFT:
+            return fftWork(rows, cols, kernel_size) * this->fft_cost;
+        default:
+            throw invalid_argument("Only concrete convolution methods can be estimated.");
+    }
+}
+
+/*!
+ * @brief Chooses the fastest convolution method.
+ * @param rows Number of rows of the image.
+ * @param cols Number of columns of the image.
+ * @param kernel_size Size of the (square) kernel.
+ * @param separable Whether the kernel is separable.
+ * @return The method with the smallest predicted time.
+ */
+ConvolutionMethod ConvolutionCalibration::choose(int rows, int cols, int kernel_size, bool separable) const {
+    ConvolutionMethod best = separable ? ConvolutionMethod::Separable : ConvolutionMethod::Direct;
+    if (this->estimate(ConvolutionMethod::FFT, rows, cols, kernel_size) < this->estimate(best, rows, cols, kernel_size)) {
+        best = ConvolutionMethod::FFT;
+    }
+    return best;
+}
+
+/*!
+ * @brief Length of the FFT blocks along one dimension of the image.
+ * @details The image, extended by the kernel radius on each side, is split in overlapping blocks, each contributing
+ * (length - kernel_size + 1) output pixels. The length is the power of 2 (the fastest transforms) that minimizes the
+ * total work along the dimension, between MIN_FFT_BLOCK and MAX_FFT_BLOCK (or more, for very large kernels), and not
+ * longer than needed to hold the whole extended image.
+ * @param size Number of rows or columns of the image.
+ * @param kernel_size Size of the kernel.
+ * @return Length of the blocks.
+ */
+int ConvolutionCalibration::fftBlockLength(int size, int kernel_size) {
+    int needed = size + kernel_size - 1;
+    int best = 0;
+    double best_work = numeric_limits<double>::infinity();
+    for (int length = MIN_FFT_BLOCK; best == 0 || (length <= MAX_FFT_BLOCK && length / 2 < needed); length *= 2) {
+        if (length < 2 * kernel_size) {
+            continue;
+        }
+        int tiles = (size + length - kernel_size) / (length - kernel_size + 1);
+        double work = tiles * length * log2(length);
+        if (work < best_work) {
+            best = length;
+            best_work = work;
+        }
+    }
+    return best;
+}
+
+/*!
+ * @brief Amount of work of an FFT convolution.
+ * @details A forward and an inverse transform of each block, and the transform of the kernel, i.e. n log2(n) per
+ * transform of a block of n pixels.
+ * @param rows Number of rows of the image.
+ * @param cols Number of columns of the image.
+ * @param kernel_size Size of the kernel.
+ * @return Units of FFT work.
+ */
+double ConvolutionCalibration::fftWork(int rows, int cols, int kernel_size) {
+    int block_rows = fftBlockLength(rows, kernel_size);
+    int block_cols = fftBlockLength(cols, kernel_size);
+    int tiles_rows = (rows + block_rows - kernel_size) / (block_rows - kernel_size + 1);
+    int tiles_cols = (cols + block_cols - kernel_size) / (block_cols - kernel_size + 1);
+    double block = (double) block_rows * block_cols;
+    return (2. * tiles_rows * tiles_cols + 1) * block * log2(block);
+}
+
+/*!
+ * @brief Measures the calibration on this host.
+ * @details Times each method on a small image, with the current thread pool, and divides by the amount of work. Takes
+ * a few milliseconds.
+ * @return The measured calibration.
+ */
+ConvolutionCalibration ConvolutionCalibration::measure() {
+    int n = CALIBRATION_SIZE;
+    int k = CALIBRATION_KERNEL_SIZE;
+    Eigen::ArrayXXd image = Eigen::ArrayXXd::Random(n, n);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(k, k);
+    Eigen::ArrayXd kernel_1d = Eigen::ArrayXd::Random(k);
+
+    auto fastest = [](const function<void()>& run) {
+        double best = numeric_limits<double>::infinity();
+        for (int i = 0; i < CALIBRATION_RUNS; i++) {
+            auto start = chrono::steady_clock::now();
+            run();
+            auto end = chrono::steady_clock::now();
+            best = min(best, (double) chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+        }
+        // clocks may be coarse
+        return max(best, 1.);
+    };
+    double direct = fastest([&]() { applyConvolution(image, kernel, BorderMode::Zero, 0, ConvolutionMethod::Direct); });
+    double separable = fastest([&]() { applySeparableConvolution(image, kernel_1d, kernel_1d); });
+    double fft = fastest([&]() { applyFFTConvolution(image, kernel); });
+
+    double pixels = (double) n * n;
+    return {direct / (pixels * k * k), separable / (pixels * 2 * k), fft / fftWork(n, n, k)};
+}
+
+/*!
+ * @brief Gets the process-wide calibration.
+ * @details Measures it on the first call (see measure), unless one was set with setGlobal. This method is thread-safe.
+ * @return The process-wide calibration.
+ */
+ConvolutionCalibration ConvolutionCalibration::global() {
+    lock_guard<mutex> lock(global_calibration_mutex);
+    if (!global_calibration) {
+        global_calibration = make_unique<ConvolutionCalibration>(measure());
+    }
+    return *global_calibration;
+}
+
+/*!
+ * @brief Replaces the process-wide calibration.
+ * @param calibration The new calibration.
+ * @return
+ */
+void ConvolutionCalibration::setGlobal(const ConvolutionCalibration& calibration) {
+    lock_guard<mutex> lock(global_calibration_mutex);
+    global_calibration = make_unique<ConvolutionCalibration>(calibration);
+}
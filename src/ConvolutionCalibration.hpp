@@ -0,0 +1,59 @@
+//
+// Host calibration of the convolution methods, used to choose the fastest one.
+//
+
+#ifndef IMAGEPROCESSING_CONVOLUTIONCALIBRATION_HPP
+#define IMAGEPROCESSING_CONVOLUTIONCALIBRATION_HPP
+
+#include "operations.hpp"
+
+using namespace std;
+
+/**
+ * @brief The ConvolutionCalibration class
+ * @details Predicts the run time of each convolution method from the size of the image and of the kernel, to choose
+ * the fastest one (see applyConvolution with ConvolutionMethod::Auto). The direct method costs k^2 multiply-adds per
+ * pixel, the separable method 2k, and the FFT method a forward and an inverse transform of each block of the image
+ * (see fftBlockLength), i.e. O(log n) per pixel whatever the size of the kernel. The cost of one unit of work of each
+ * method is measured once on the host, by timing the methods on a small image (see measure): this table of costs is
+ * the calibration. A process-wide calibration is measured on first use (see global), and can be replaced (e.g. by a
+ * fixed one, to make the choices reproducible) with setGlobal.
+ */
+class ConvolutionCalibration {
+private:
+    /**
+     * @var direct_cost
+     * Time of one multiply-add of the direct convolution, in nanoseconds.
+     */
+    double direct_cost;
+    /**
+     * @var separable_cost
+     * Time of one multiply-add of the separable convolution, in nanoseconds.
+     */
+    double separable_cost;
+    /**
+     * @var fft_cost
+     * Time of one unit of FFT work (n log2(n) for a block of n pixels), in nanoseconds.
+     */
+    double fft_cost;
+
+public:
+    ConvolutionCalibration(double direct_cost, double separable_cost, double fft_cost);
+
+    [[nodiscard]] double getDirectCost() const;
+    [[nodiscard]] double getSeparableCost() const;
+    [[nodiscard]] double getFFTCost() const;
+
+    [[nodiscard]] double estimate(ConvolutionMethod method, int rows, int cols, int kernel_size) const;
+    [[nodiscard]] ConvolutionMethod choose(int rows, int cols, int kernel_size, bool separable) const;
+
+    static int fftBlockLength(int size, int kernel_size);
+    static double fftWork(int rows, int cols, int kernel_size);
+
+    static ConvolutionCalibration measure();
+    static ConvolutionCalibration global();
+    static void setGlobal(const ConvolutionCalibration& calibration);
+};
+
+
+#endif //IMAGEPROCESSING_CONVOLUTIONCALIBRATION_HPP
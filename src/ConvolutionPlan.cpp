@@ -0,0 +1,299 @@
+//
+// Convolution plans: everything that depends on the kernel, computed once and reused for many images.
+//
+
+#include "ConvolutionPlan.hpp"
+#include <limits>
+#include <stdexcept>
+#include "ConvolutionCalibration.hpp"
+#include "ThreadPool.hpp"
+
+// View of an image (or channel) given by its first pixel and the distance between its columns
+typedef Eigen::Map<const Eigen::ArrayXXd, 0, Eigen::OuterStride<>> InputView;
+typedef Eigen::Map<Eigen::ArrayXXd, 0, Eigen::OuterStride<>> OutputView;
+
+/*!
+ * @brief Constructor for ConvolutionPlan
+ * @details Checks the kernel as applyConvolution, chooses the method (from the host calibration for
+ * ConvolutionMethod::Auto), and computes everything the method needs from the kernel.
+ * @param rows Number of rows of the images convolved.
+ * @param cols Number of columns of the images convolved.
+ * @param kernel Kernel of the convolution. Must be square, odd in size, and not larger than the images.
+ * @param border How the images are extended beyond their edges.
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant.
+ * @param method How the convolutions are computed.
+ */
+ConvolutionPlan::ConvolutionPlan(int rows, int cols, const Eigen::ArrayXXd& kernel, BorderMode border,
+                                 double border_value, ConvolutionMethod method) {
+    checkKernelSize(rows, cols, kernel.rows(), kernel.cols());
+    if (kernel.rows() != kernel.cols()) {
+        throw invalid_argument("Kernel must be square");
+    }
+    this->rows = rows;
+    this->cols = cols;
+    this->kernel = kernel;
+    this->border = border;
+    this->border_value = border_value;
+
+    bool separable = method != ConvolutionMethod::Direct &&
+                     separateKernel(kernel, this->column_kernel, this->row_kernel);
+    if (method == ConvolutionMethod::Auto) {
+        method = ConvolutionCalibration::global().choose(rows, cols, (int) kernel.rows(), separable);
+    }
+    if (method == ConvolutionMethod::Separable && !separable) {
+        throw invalid_argument("Kernel is not separable");
+    }
+    if (method == ConvolutionMethod::FFT) {
+        this->kernel_spectrum = fftConvolutionKernelSpectrum(kernel, rows, cols);
+    }
+    this->method = method;
+}
+
+/*!
+ * @brief Constructor for ConvolutionPlan with a separable kernel
+ * @details The convolutions are computed as two 1D passes, as applySeparableConvolution.
+ * @param rows Number of rows of the images convolved.
+ * @param cols Number of columns of the images convolved.
+ * @param column_kernel Kernel applied along the rows of the images (vertical pass). Must be odd in size.
+ * @param row_kernel Kernel applied along the columns of the images (horizontal pass). Must be odd in size.
+ * @param border How the images are extended beyond their edges.
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant.
+ */
+ConvolutionPlan::ConvolutionPlan(int rows, int cols, const Eigen::ArrayXd& column_kernel,
+                                 const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value) {
+    checkKernelSize(rows, cols, column_kernel.size(), row_kernel.size());
+    this->rows = rows;
+    this->cols = cols;
+    this->kernel = (column_kernel.matrix() * row_kernel.matrix().transpose()).array();
+    this->column_kernel = column_kernel;
+    this->row_kernel = row_kernel;
+    this->border = border;
+    this->border_value = border_value;
+    this->method = ConvolutionMethod::Separable;
+}
+
+/*!
+ * @brief Simple rows getter.
+ * @return The number of rows of the images convolved.
+ */
+int ConvolutionPlan::getRows() const {
+    return this->rows;
+}
+
+/*!
+ * @brief Simple columns getter.
+ * @return The number of columns of the images convolved.
+ */
+int ConvolutionPlan::getCols() const {
+    return this->cols;
+}
+
+/*!
+ * @brief Simple method getter.
+ * @return The method used to compute the convolutions (never ConvolutionMethod::Auto).
+ */
+ConvolutionMethod ConvolutionPlan::getMethod() const {
+    return this->method;
+}
+
+/*!
+ * @brief Simple kernel getter.
+ * @return The kernel of the convolution.
+ */
+Eigen::ArrayXXd ConvolutionPlan::getKernel() const {
+    return this->kernel;
+}
+
+/*!
+ * @brief Checks that an input and an output have the size of the plan.
+ * @param input_rows Number of rows of the input.
+ * @param input_cols Number of columns of the input.
+ * @param output_rows Number of rows of the output.
+ * @param output_cols Number of columns of the output.
+ * @return
+ */
+void ConvolutionPlan::checkSize(Eigen::Index input_rows, Eigen::Index input_cols, Eigen::Index output_rows,
+                                Eigen::Index output_cols) const {
+    if (input_rows != this->rows || input_cols != this->cols) {
+        throw invalid_argument("Input must have the size of the convolution plan");
+    }
+    if (output_rows != this->rows || output_cols != this->cols) {
+        throw invalid_argument("Output must have the size of the convolution plan");
+    }
+}
+
+/*!
+ * @brief Convolves the images of channels with the direct or separable method.
+ * @details The output of each image is split in bands of CONVOLUTION_BAND columns, and all the bands of all the images
+ * are computed as independent tasks on the global thread pool. Each worker uses its own buffers, which are kept
+ * between calls. If track_range is set, the range of each output column is read while the column is still in cache,
+ * and the ranges of all the workers are merged into the low and high values of the channels.
+ * @return
+ */
+void ConvolutionPlan::convolveChannels() {
+    ThreadPool& pool = ThreadPool::global();
+    int workers = pool.getNumThreads();
+    if ((int) this->scratch.size() < workers) {
+        this->scratch.resize(workers);
+        for (auto& buffers: this->scratch) {
+            buffers.sources.reserve(this->kernel.size());
+            buffers.weights.reserve(this->kernel.size());
+            buffers.horizontal.resize(this->rows);
+        }
+    }
+    int channel_count = (int) this->channels.size();
+    if (this->track_range) {
+        this->lows.assign(workers * channel_count, numeric_limits<double>::infinity());
+        this->highs.assign(workers * channel_count, -numeric_limits<double>::infinity());
+    }
+
+    int bands = (this->cols + CONVOLUTION_BAND - 1) / CONVOLUTION_BAND;
+    pool.parallelFor(0, channel_count * bands, [this, bands](int worker, int task) {
+        const Channel& channel = this->channels[task / bands];
+        InputView input(channel.input, this->rows, this->cols, Eigen::OuterStride<>(channel.input_stride));
+        OutputView output(channel.output, this->rows, this->cols, Eigen::OuterStride<>(channel.output_stride));
+        int j_begin = (task % bands) * CONVOLUTION_BAND;
+        int j_end = min(j_begin + CONVOLUTION_BAND, this->cols);
+        double low = numeric_limits<double>::infinity();
+        double high = -numeric_limits<double>::infinity();
+        for (int j = j_begin; j < j_end; j++) {
+            if (this->method == ConvolutionMethod::Separable) {
+                separableColumn(input, this->column_kernel, this->row_kernel, this->border, this->border_value, j,
+                                this->scratch[worker], output);
+            } else {
+                directColumn(input, this->kernel, this->border, this->border_value, j, this->scratch[worker], output);
+            }
+            if (this->track_range) {
+                low = min(low, output.col(j).minCoeff());
+                high = max(high, output.col(j).maxCoeff());
+            }
+        }
+        if (this->track_range) {
+            size_t index = (size_t) worker * this->channels.size() + task / bands;
+            this->lows[index] = min(this->lows[index], low);
+            this->highs[index] = max(this->highs[index], high);
+        }
+    });
+
+    if (this->track_range) {
+        for (int c = 0; c < channel_count; c++) {
+            Channel& channel = this->channels[c];
+            channel.low = numeric_limits<double>::infinity();
+            channel.high = -numeric_limits<double>::infinity();
+            for (int w = 0; w < workers; w++) {
+                channel.low = min(channel.low, this->lows[w * channel_count + c]);
+                channel.high = max(channel.high, this->highs[w * channel_count + c]);
+            }
+        }
+    }
+}
+
+/*!
+ * @brief Normalizes the outputs of channels to [0,1], in place.
+ * @details Each output is rescaled from the low and high values of its channel, in a single pass, with the bands of
+ * all the channels in parallel.
+ * @return
+ */
+void ConvolutionPlan::normalizeChannels() {
+    int bands = (this->cols + CONVOLUTION_BAND - 1) / CONVOLUTION_BAND;
+    ThreadPool::global().parallelFor(0, (int) this->channels.size() * bands, [this, bands](int, int task) {
+        const Channel& channel = this->channels[task / bands];
+        OutputView output(channel.output, this->rows, this->cols, Eigen::OuterStride<>(channel.output_stride));
+        int j_begin = (task % bands) * CONVOLUTION_BAND;
+        int j_count = min(CONVOLUTION_BAND, this->cols - j_begin);
+        auto band = output.middleCols(j_begin, j_count);
+        band = (band - channel.low) / (channel.high - channel.low);
+    });
+}
+
+/*!
+ * @brief Convolves an image given as an array.
+ * @details Computes the same convolution as applyConvolution, into the given output.
+ * @param input Input image, with the size of the plan.
+ * @param output Output image, with the size of the plan. Must not overlap the input.
+ * @return
+ */
+void ConvolutionPlan::execute(const Eigen::Ref<const Eigen::ArrayXXd>& input, Eigen::Ref<Eigen::ArrayXXd> output) {
+    this->checkSize(input.rows(), input.cols(), output.rows(), output.cols());
+    if (this->method == ConvolutionMethod::FFT) {
+        applyFFTConvolution(input, (int) this->kernel.rows(), this->kernel_spectrum, this->border, this->border_value,
+                            output);
+        return;
+    }
+    this->channels.assign(1, Channel{input.data(), input.outerStride(), output.data(), output.outerStride(), 0, 0});
+    this->track_range = false;
+    this->convolveChannels();
+}
+
+/*!
+ * @brief Convolves an image.
+ * @details Computes the same convolution as applyConvolution on Image objects, into the given output, with the bands
+ * of all channels in parallel. As there, each channel of the output is normalized to [0,1] by default, in place: the
+ * range of the channels is recorded while they are convolved, so this only adds one pass over the output. The
+ * channels of images whose columns are not contiguous (row-major and interleaved layouts, see ImageLayout) are copied
+ * to and from planar buffers kept by the plan. The alpha channel, if any (see Image::hasAlpha), is copied unchanged.
+ * @param input Input image, with the size of the plan.
+ * @param output Output image, with the size of the plan and as many channels as the input.
+ * @param normalize_output Whether to normalize each channel of the output to [0,1], or keep the raw convolution values
+ * (which may then be outside [0,1]).
+ * @return
+ */
+void ConvolutionPlan::execute(const Image& input, Image& output, bool normalize_output) {
+    this->checkSize(input.getHeight(), input.getWidth(), output.getHeight(), output.getWidth());
+    if (input.getChannels() != output.getChannels()) {
+        throw invalid_argument("Output must have as many channels as the input");
+    }
+
+    // the kernels read and write whole columns, so the channels of other layouts go through the staging arrays
+    int channel_count = input.getColorChannels();
+    if ((int) this->staging.size() < 2 * channel_count) {
+        this->staging.resize(2 * channel_count);
+    }
+    this->channels.clear();
+    for (int c = 0; c < channel_count; c++) {
+        Channel channel{input.getBuffer() + c * input.getChannelStride(), input.getColStride(),
+                        output.getBuffer() + c * output.getChannelStride(), output.getColStride(), 0, 0};
+        if (input.getRowStride() != 1) {
+            Eigen::ArrayXXd& input_staging = this->staging[2 * c];
+            input_staging.resize(this->rows, this->cols);
+            input_staging = input.getChannelView(c);
+            channel.input = input_staging.data();
+            channel.input_stride = this->rows;
+        }
+        if (output.getRowStride() != 1) {
+            Eigen::ArrayXXd& output_staging = this->staging[2 * c + 1];
+            output_staging.resize(this->rows, this->cols);
+            channel.output = output_staging.data();
+            channel.output_stride = this->rows;
+        }
+        this->channels.push_back(channel);
+    }
+    if (this->method == ConvolutionMethod::FFT) {
+        for (Channel& channel: this->channels) {
+            InputView input_channel(channel.input, this->rows, this->cols, Eigen::OuterStride<>(channel.input_stride));
+            OutputView output_channel(channel.output, this->rows, this->cols,
+                                      Eigen::OuterStride<>(channel.output_stride));
+            applyFFTConvolution(input_channel, (int) this->kernel.rows(), this->kernel_spectrum, this->border,
+                                this->border_value, output_channel);
+            if (normalize_output) {
+                channel.low = output_channel.minCoeff();
+                channel.high = output_channel.maxCoeff();
+            }
+        }
+    } else {
+        this->track_range = normalize_output;
+        this->convolveChannels();
+    }
+
+    if (normalize_output) {
+        this->normalizeChannels();
+    }
+    if (output.getRowStride() != 1) {
+        for (int c = 0; c < channel_count; c++) {
+            output.getChannelView(c) = this->staging[2 * c + 1];
+        }
+    }
+    if (input.hasAlpha()) {
+        output.getChannelView(3) = input.getChannelView(3);
+    }
+}
@@ -0,0 +1,138 @@
+//
+// Convolution plans: everything that depends on the kernel, computed once and reused for many images.
+//
+
+#ifndef IMAGEPROCESSING_CONVOLUTIONPLAN_HPP
+#define IMAGEPROCESSING_CONVOLUTIONPLAN_HPP
+
+#include <Eigen/Eigen>
+#include <vector>
+#include "Image.hpp"
+#include "operations.hpp"
+
+using namespace std;
+
+/**
+ * @brief The ConvolutionPlan class
+ * @details A plan convolves images of a given size with a given kernel, as applyConvolution, into outputs provided by
+ * the caller. Everything that depends on the kernel is done once, when the plan is built: the choice of the method
+ * (see ConvolutionCalibration), the split of separable kernels, and the spectrum of the kernel for the FFT method.
+ * The plan also keeps the buffers of the parallel tasks, so that once the first image has been convolved, the direct
+ * and separable methods do not allocate memory: a loop over the frames of a video can reuse the same plan and output.
+ * The FFT method still allocates its blocks for each image. When the outputs are normalized, the smallest and largest
+ * values of each channel are recorded while the columns are computed, so that normalizing takes a single pass.
+ * A plan can be reused for any number of images, but must not be executed from several threads at the same time.
+ */
+class ConvolutionPlan {
+private:
+    /**
+     * @brief Input and output of one image (or channel) convolved by a task.
+     */
+    struct Channel {
+        const double* input;        ///< First pixel of the input.
+        Eigen::Index input_stride;  ///< Distance between the columns of the input.
+        double* output;             ///< First pixel of the output.
+        Eigen::Index output_stride; ///< Distance between the columns of the output.
+        double low;                 ///< Smallest value of the output, once computed.
+        double high;                ///< Largest value of the output, once computed.
+    };
+
+    /**
+     * @var rows
+     * Number of rows of the images convolved.
+     */
+    int rows;
+    /**
+     * @var cols
+     * Number of columns of the images convolved.
+     */
+    int cols;
+    /**
+     * @var kernel
+     * Kernel of the convolution.
+     */
+    Eigen::ArrayXXd kernel;
+    /**
+     * @var column_kernel
+     * Kernel applied along the rows of the images, for the separable method.
+     */
+    Eigen::ArrayXd column_kernel;
+    /**
+     * @var row_kernel
+     * Kernel applied along the columns of the images, for the separable method.
+     */
+    Eigen::ArrayXd row_kernel;
+    /**
+     * @var border
+     * How the images are extended beyond their edges.
+     */
+    BorderMode border;
+    /**
+     * @var border_value
+     * Value of the pixels beyond the edges, for BorderMode::Constant.
+     */
+    double border_value;
+    /**
+     * @var method
+     * Method used to compute the convolutions (never ConvolutionMethod::Auto).
+     */
+    ConvolutionMethod method;
+    /**
+     * @var kernel_spectrum
+     * Spectrum of the kernel, for the FFT method (see fftConvolutionKernelSpectrum).
+     */
+    Eigen::ArrayXXcd kernel_spectrum;
+    /**
+     * @var scratch
+     * Buffers of each worker of the global thread pool.
+     */
+    vector<ColumnScratch> scratch;
+    /**
+     * @var channels
+     * Inputs and outputs of the images being convolved.
+     */
+    vector<Channel> channels;
+    /**
+     * @var staging
+     * Planar copies of the input (even indices) and output (odd indices) channels of images whose columns are not
+     * contiguous.
+     */
+    vector<Eigen::ArrayXXd> staging;
+    /**
+     * @var track_range
+     * Whether the tasks record the smallest and largest output values, to normalize the outputs.
+     */
+    bool track_range = false;
+    /**
+     * @var lows
+     * Smallest output value of each channel seen by each worker, at index worker * channels + channel.
+     */
+    vector<double> lows;
+    /**
+     * @var highs
+     * Largest output value of each channel seen by each worker, at index worker * channels + channel.
+     */
+    vector<double> highs;
+
+    void checkSize(Eigen::Index input_rows, Eigen::Index input_cols, Eigen::Index output_rows,
+                   Eigen::Index output_cols) const;
+    void convolveChannels();
+    void normalizeChannels();
+
+public:
+    ConvolutionPlan(int rows, int cols, const Eigen::ArrayXXd& kernel, BorderMode border = BorderMode::Zero,
+                    double border_value = 0, ConvolutionMethod method = ConvolutionMethod::Auto);
+    ConvolutionPlan(int rows, int cols, const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel,
+                    BorderMode border = BorderMode::Zero, double border_value = 0);
+
+    [[nodiscard]] int getRows() const;
+    [[nodiscard]] int getCols() const;
+    [[nodiscard]] ConvolutionMethod getMethod() const;
+    [[nodiscard]] Eigen::ArrayXXd getKernel() const;
+
+    void execute(const Eigen::Ref<const Eigen::ArrayXXd>& input, Eigen::Ref<Eigen::ArrayXXd> output);
+    void execute(const Image& input, Image& output, bool normalize_output = true);
+};
+
+
+#endif //IMAGEPROCESSING_CONVOLUTIONPLAN_HPP
@@ -83,21 +83,69 @@ Denoiser::Denoiser(const Eigen::ArrayXXd& kernel) {
     this->kernel = kernel;
 }
 
+/*!
+ * @brief Recursive Gaussian constructor for Denoiser
+ * @details Creates a Gaussian Filter computed with a recursive filter (see applyRecursiveGaussian), whose cost per pixel
+ * does not depend on sigma, e.g. for the sigmas of 10 to 30 pixels used to estimate the background. The kernel of the
+ * Denoiser is the Gaussian kernel truncated at 3 sigma, which the recursive filter approximates.
+ * @param sigma The sigma value of the Gaussian Filter. Must be at least 0.5.
+ * @return The Denoiser
+ */
+Denoiser Denoiser::recursiveGaussian(double sigma) {
+    if (sigma < 0.5) {
+        throw invalid_argument("Sigma must be at least 0.5 for the recursive Gaussian");
+    }
+    Denoiser denoiser(2 * (int) ceil(3 * sigma) + 1, sigma);
+    denoiser.recursive_sigma = sigma;
+    return denoiser;
+}
+
 /*!
  * @brief Denoises the image without saving it.
- * @details Denoises the image using the kernel of the Denoiser.
+ * @details Denoises the image using the kernel of the Denoiser. A uniform kernel (mean filter) is applied as a box
+ * filter (see applyBoxFilter), whose cost does not depend on the kernel size. A recursive Denoiser (see
+ * recursiveGaussian) applies the recursive filter instead of the kernel.
  * @param image The image to denoise.
  * @param show Whether to show the denoised image.
  * @return The denoised image.
  */
 Image Denoiser::denoise(const Image& image, bool show) {
-    Image denoised_image = applyConvolution(image, this->kernel);
+    bool uniform = (this->kernel == this->kernel(0, 0)).all();
+    Image denoised_image = this->recursive_sigma > 0 ? applyRecursiveGaussian(image, this->recursive_sigma)
+                         : uniform ? applyBoxFilter(image, (int) this->kernel.rows())
+                         : applyConvolution(image, this->kernel);
     if (show) {
         denoised_image.show("Denoised Image");
     }
     return denoised_image;
 }
 
+/*!
+ * @brief Denoises an image with compact pixels.
+ * @details Separable kernels (Gaussian and mean filters) are applied natively, in single precision (see
+ * applySeparableConvolution on TypedImage). Unlike the denoising of an Image, the output is not normalized, so the image
+ * keeps its brightness. Other kernels, and the recursive Gaussian filter, go through a double precision copy of the
+ * image.
+ * @param image The image to denoise.
+ * @return The denoised image, with the type and layout of the input.
+ */
+template <typename T>
+TypedImage<T> Denoiser::denoise(const TypedImage<T>& image) const {
+    Eigen::ArrayXd column_kernel, row_kernel;
+    if (this->recursive_sigma == 0 && separateKernel(this->kernel, column_kernel, row_kernel)) {
+        return applySeparableConvolution(image, column_kernel, row_kernel);
+    }
+    Image input = image.toImage();
+    Image output(input.getWidth(), input.getHeight(), input.getChannels());
+    for (int c = 0; c < input.getChannels(); c++) {
+        output.getChannelView(c) = applyToChannel(input, c, [this](const Eigen::Ref<const Eigen::ArrayXXd>& channel) {
+            return this->recursive_sigma > 0 ? applyRecursiveGaussian(channel, this->recursive_sigma)
+                                             : applyConvolution(channel, this->kernel);
+        });
+    }
+    return TypedImage<T>(output, image.getLayout());
+}
+
 /*!
  * @brief Simple getter for the kernel.
  * @return The kernel of the Denoiser.
@@ -106,8 +154,17 @@ Eigen::ArrayXXd Denoiser::getKernel() const {
     return this->kernel;
 }
 
+/*!
+ * @brief Whether the Denoiser uses the recursive Gaussian filter.
+ * @return True if it was created with recursiveGaussian, and its kernel was not replaced since.
+ */
+bool Denoiser::isRecursive() const {
+    return this->recursive_sigma > 0;
+}
+
 /*!
  * @brief Simple setter for the kernel.
+ * @details The kernel replaces the recursive filter of a recursive Denoiser.
  * @param kernel
  */
 void Denoiser::setKernel(const Eigen::ArrayXXd &kernel) {
@@ -130,4 +187,9 @@ void Denoiser::setKernel(const Eigen::ArrayXXd &kernel) {
         throw invalid_argument("Kernel must be normalized");
     }
     this->kernel = kernel;
+    this->recursive_sigma = 0;
 }
+
+template TypedImage<uint8_t> Denoiser::denoise<uint8_t>(const TypedImage<uint8_t>& image) const;
+template TypedImage<uint16_t> Denoiser::denoise<uint16_t>(const TypedImage<uint16_t>& image) const;
+template TypedImage<float> Denoiser::denoise<float>(const TypedImage<float>& image) const;
@@ -8,6 +8,7 @@
 
 #include <Eigen/Eigen>
 #include "Image.hpp"
+#include "TypedImage.hpp"
 #include <string>
 
 using namespace std;
@@ -17,7 +18,9 @@ using namespace std;
  * @details This class implements a Denoiser for Image Processing.
  * It uses a Gaussian Filter (or a mean filter as a special case)
  * to denoise an image.
- * Both the kernel size and the sigma value can be set.
+ * Both the kernel size and the sigma value can be set. For large
+ * sigmas, a recursive Gaussian filter, whose cost does not depend
+ * on sigma, can be used instead of the kernel.
  */
 
 class Denoiser {
@@ -27,17 +30,27 @@ private:
      * Convolutional kernel to apply to the image for denoising..
      */
     Eigen::ArrayXXd kernel;
+    /**
+     * @var recursive_sigma
+     * Sigma of the recursive Gaussian filter used for denoising, or 0 to convolve with the kernel.
+     */
+    double recursive_sigma = 0;
 
 public:
     Denoiser();
     Denoiser(int size, double sigma); // NOTE: we could use template here to be more flexible in the sigma typing
     explicit Denoiser(const Eigen::ArrayXXd& kernel);
+    static Denoiser recursiveGaussian(double sigma);
 
     Image denoise(const Image& image, bool show=false);
+    template <typename T>
+    TypedImage<T> denoise(const TypedImage<T>& image) const;
 
     void setKernel(const Eigen::ArrayXXd& kernel);
 
     [[nodiscard]] Eigen::ArrayXXd getKernel() const;
+
+    [[nodiscard]] bool isRecursive() const;
 };
 
 
@@ -0,0 +1,333 @@
+//
+// FFT plans: precomputed tables for a fast Fourier transform of a given length and direction.
+//
+
+#include "FFTPlan.hpp"
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+// Largest prime factor handled by the mixed-radix butterflies. Lengths with larger factors use Bluestein's algorithm.
+static const int MAX_MIXED_RADIX_FACTOR = 13;
+
+// Process-wide plan cache, keyed by (length, inverse).
+static map<pair<int, bool>, shared_ptr<const FFTPlan>> plan_cache;
+static mutex plan_cache_mutex;
+
+/*!
+ * @brief Decomposes N into its prime factors, in increasing order.
+ * @param N Number to factorize
+ * @return Vector with the prime factors of N (with repetition)
+ */
+static vector<int> primeFactors(int N) {
+    vector<int> factors;
+    for (int p = 2; p * p <= N; p++) {
+        while (N % p == 0) {
+            factors.push_back(p);
+            N /= p;
+        }
+    }
+    if (N > 1) {
+        factors.push_back(N);
+    }
+    return factors;
+}
+
+/*!
+ * @brief Constructor for FFTPlan
+ * @details Chooses the algorithm from the length of the transform and precomputes its tables: radix-2 for powers of 2,
+ * mixed-radix Cooley-Tukey when all prime factors are small, and Bluestein's algorithm otherwise. Prefer FFTPlan::get,
+ * which reuses cached plans.
+ * @param length Length of the transform. Must be non-negative.
+ * @param inverse Whether the plan computes the inverse transform.
+ */
+FFTPlan::FFTPlan(int length, bool inverse) {
+    if (length < 0) {
+        throw invalid_argument("FFT length must be non-negative");
+    }
+    this->length = length;
+    this->inverse = inverse;
+
+    if (length <= 1) {
+        this->algorithm = Algorithm::Trivial;
+        return;
+    }
+
+    double sign = inverse ? 1. : -1.;
+    if ((length & (length - 1)) == 0) {
+        this->algorithm = Algorithm::Radix2;
+    } else {
+        this->factors = primeFactors(length);
+        this->algorithm = this->factors.back() > MAX_MIXED_RADIX_FACTOR ? Algorithm::Bluestein : Algorithm::MixedRadix;
+    }
+
+    if (this->algorithm == Algorithm::Bluestein) {
+        this->factors.clear();
+        int M = 1;
+        while (M < 2 * length - 1) {
+            M <<= 1;
+        }
+        this->convolution_forward = FFTPlan::get(M, false);
+        this->convolution_inverse = FFTPlan::get(M, true);
+
+        // chirp: w_k = exp(-i*pi*k^2/N). k^2 is reduced modulo 2N to keep the angle small and accurate.
+        this->chirp.resize(length);
+        for (long long k = 0; k < length; k++) {
+            long long k2 = (k * k) % (2LL * length);
+            this->chirp[k] = polar(1., sign * M_PI * (double) k2 / length);
+        }
+
+        // the filter of the circular convolution only depends on the length, so its transform is computed here
+        this->chirp_filter.assign(M, 0.);
+        this->chirp_filter[0] = conj(this->chirp[0]);
+        for (int k = 1; k < length; k++) {
+            this->chirp_filter[k] = conj(this->chirp[k]);
+            this->chirp_filter[M - k] = conj(this->chirp[k]);
+        }
+        this->convolution_forward->execute(this->chirp_filter.data());
+        for (auto &value: this->chirp_filter) {
+            value /= M;
+        }
+        return;
+    }
+
+    this->twiddles.resize(length);
+    for (int k = 0; k < length; k++) {
+        this->twiddles[k] = polar(1., sign * 2 * M_PI * k / length);
+    }
+
+    if (this->algorithm == Algorithm::Radix2) {
+        for (int i = 1, j = 0; i < length; i++) {
+            int bit = length >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j) {
+                this->bit_reversal.emplace_back(i, j);
+            }
+        }
+    }
+}
+
+/*!
+ * @brief Gets a plan from the process-wide cache.
+ * @details Returns the cached plan for the given length and direction, building it on the first request. This method
+ * is thread-safe, and plans are never rebuilt while they are in the cache.
+ * @param length Length of the transform. Must be non-negative.
+ * @param inverse Whether the plan computes the inverse transform.
+ * @return Shared pointer to the plan.
+ */
+shared_ptr<const FFTPlan> FFTPlan::get(int length, bool inverse) {
+    pair<int, bool> key(length, inverse);
+    {
+        lock_guard<mutex> lock(plan_cache_mutex);
+        auto it = plan_cache.find(key);
+        if (it != plan_cache.end()) {
+            return it->second;
+        }
+    }
+    // build outside the lock: Bluestein plans request their own sub-plans from the cache
+    auto plan = make_shared<const FFTPlan>(length, inverse);
+    lock_guard<mutex> lock(plan_cache_mutex);
+    // if another thread built the same plan meanwhile, keep the first one
+    return plan_cache.emplace(key, plan).first->second;
+}
+
+/*!
+ * @brief Number of plans in the cache.
+ * @return The number of cached plans.
+ */
+size_t FFTPlan::cacheSize() {
+    lock_guard<mutex> lock(plan_cache_mutex);
+    return plan_cache.size();
+}
+
+/*!
+ * @brief Removes all plans from the cache.
+ * @details Plans still referenced elsewhere stay valid until they are released.
+ */
+void FFTPlan::clearCache() {
+    lock_guard<mutex> lock(plan_cache_mutex);
+    plan_cache.clear();
+}
+
+/*!
+ * @brief Simple length getter.
+ * @return Length of the transform.
+ */
+int FFTPlan::getLength() const {
+    return this->length;
+}
+
+/*!
+ * @brief Simple direction getter.
+ * @return True if the plan computes the inverse transform.
+ */
+bool FFTPlan::isInverse() const {
+    return this->inverse;
+}
+
+/*!
+ * @brief Simple algorithm getter.
+ * @return The algorithm used by the plan.
+ */
+FFTPlan::Algorithm FFTPlan::getAlgorithm() const {
+    return this->algorithm;
+}
+
+/*!
+ * @brief Size of the scratch buffer needed to execute the plan.
+ * @return Number of complex elements the scratch buffer must hold.
+ */
+size_t FFTPlan::getScratchSize() const {
+    switch (this->algorithm) {
+        case Algorithm::MixedRadix:
+            return this->length + this->factors.back();
+        case Algorithm::Bluestein:
+            return this->chirp_filter.size();
+        default:
+            return 0;
+    }
+}
+
+/*!
+ * @brief Executes the plan in place, using a scratch buffer owned by the calling thread.
+ * @details The scratch buffer is thread-local and only grows, so after the first call on a thread no memory is
+ * allocated.
+ * @param data Signal to transform, with getLength() elements.
+ */
+void FFTPlan::execute(complex<double>* data) const {
+    thread_local vector<complex<double>> scratch;
+    if (scratch.size() < this->getScratchSize()) {
+        scratch.resize(this->getScratchSize());
+    }
+    this->execute(data, scratch.data());
+}
+
+/*!
+ * @brief Executes the plan in place.
+ * @param data Signal to transform, with getLength() elements.
+ * @param scratch Scratch buffer with at least getScratchSize() elements. It must not be shared with another thread
+ * executing at the same time.
+ */
+void FFTPlan::execute(complex<double>* data, complex<double>* scratch) const {
+    switch (this->algorithm) {
+        case Algorithm::Trivial:
+            return;
+        case Algorithm::Radix2:
+            this->executeRadix2(data);
+            return;
+        case Algorithm::MixedRadix:
+            copy(data, data + this->length, scratch);
+            this->executeMixedRadix(data, scratch, 1, 0, scratch + this->length);
+            return;
+        case Algorithm::Bluestein:
+            this->executeBluestein(data, scratch);
+            return;
+    }
+}
+
+/*!
+ * @brief Iterative radix-2 FFT, in place.
+ * @details Cooley-Tukey decimation in time: the precomputed bit reversal permutation is applied, followed by log2(N)
+ * butterfly stages.
+ * @param data Signal to transform.
+ */
+void FFTPlan::executeRadix2(complex<double>* data) const {
+    for (const auto &swap_pair: this->bit_reversal) {
+        swap(data[swap_pair.first], data[swap_pair.second]);
+    }
+
+    int N = this->length;
+    for (int len = 2; len <= N; len <<= 1) {
+        int half = len >> 1;
+        int step = N / len;
+        for (int start = 0; start < N; start += len) {
+            for (int k = 0; k < half; k++) {
+                complex<double> t = data[start + k + half] * this->twiddles[k * step];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
+
+/*!
+ * @brief Recursive mixed-radix FFT stage.
+ * @details Cooley-Tukey decimation in time for a length p*m, where p is the factor at 'factor_index'. The p
+ * sub-transforms of length m are computed recursively (reading the input with a growing stride), and are then combined
+ * with a generic radix-p butterfly. The cost of a stage is O(N*p), so this is only used for small prime factors.
+ * @param output Output buffer for this stage, with p*m elements.
+ * @param input Input signal of the stage.
+ * @param stride Stride between consecutive input elements of this stage.
+ * @param factor_index Index of the factor used in this stage.
+ * @param scratch Scratch buffer with (at least) as many elements as the largest factor.
+ */
+void FFTPlan::executeMixedRadix(complex<double>* output, const complex<double>* input, int stride, int factor_index,
+                                complex<double>* scratch) const {
+    int N = this->length;
+    int p = this->factors[factor_index];
+    int m = 1;
+    for (int i = factor_index + 1; i < (int) this->factors.size(); i++) {
+        m *= this->factors[i];
+    }
+
+    // sub-transforms of the decimated sequences
+    if (m == 1) {
+        for (int q = 0; q < p; q++) {
+            output[q] = input[q * stride];
+        }
+    } else {
+        for (int q = 0; q < p; q++) {
+            this->executeMixedRadix(output + q * m, input + q * stride, stride * p, factor_index + 1, scratch);
+        }
+    }
+
+    // generic radix-p butterfly
+    for (int u = 0; u < m; u++) {
+        for (int q = 0; q < p; q++) {
+            scratch[q] = output[u + q * m];
+        }
+        for (int q1 = 0; q1 < p; q1++) {
+            int k = u + q1 * m;
+            int twiddle_index = 0;
+            complex<double> sum = scratch[0];
+            for (int q = 1; q < p; q++) {
+                twiddle_index += stride * k;
+                twiddle_index %= N;
+                sum += scratch[q] * this->twiddles[twiddle_index];
+            }
+            output[k] = sum;
+        }
+    }
+}
+
+/*!
+ * @brief Bluestein's (chirp-z) FFT, in place.
+ * @details Rewrites a DFT of arbitrary length N as a circular convolution with a chirp, computed with radix-2 FFTs of
+ * length M >= 2N - 1. The transform of the chirp filter is precomputed, so each execution costs two radix-2 FFTs.
+ * @param data Signal to transform.
+ * @param scratch Scratch buffer with at least M elements.
+ */
+void FFTPlan::executeBluestein(complex<double>* data, complex<double>* scratch) const {
+    int N = this->length;
+    int M = (int) this->chirp_filter.size();
+
+    for (int k = 0; k < N; k++) {
+        scratch[k] = data[k] * this->chirp[k];
+    }
+    fill(scratch + N, scratch + M, 0.);
+
+    // circular convolution with the chirp filter (radix-2 plans need no scratch)
+    this->convolution_forward->execute(scratch, nullptr);
+    for (int k = 0; k < M; k++) {
+        scratch[k] *= this->chirp_filter[k];
+    }
+    this->convolution_inverse->execute(scratch, nullptr);
+
+    for (int k = 0; k < N; k++) {
+        data[k] = scratch[k] * this->chirp[k];
+    }
+}
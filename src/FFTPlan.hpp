@@ -0,0 +1,110 @@
+//
+// FFT plans: precomputed tables for a fast Fourier transform of a given length and direction.
+//
+
+#ifndef IMAGEPROCESSING_FFTPLAN_HPP
+#define IMAGEPROCESSING_FFTPLAN_HPP
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief The FFTPlan class
+ * @details A plan holds everything needed to compute a 1D FFT of a given length and direction: twiddle factors,
+ * the bit reversal permutation (radix-2), the prime factorization (mixed-radix) or the chirp tables (Bluestein).
+ * Plans are immutable once built, so a single plan can be executed from several threads at the same time. Each
+ * thread uses its own scratch buffer, which is allocated once and reused by all the plans executed on that thread.
+ * Plans should be obtained with FFTPlan::get, which keeps a process-wide cache so that the setup cost is paid only
+ * once per (length, direction) pair.
+ * The transforms computed by a plan are in natural order (frequency origin at index 0) and are not normalized.
+ */
+class FFTPlan {
+public:
+    /**
+     * @brief Algorithm used by a plan, chosen from the factorization of its length.
+     */
+    enum class Algorithm {
+        Trivial,    ///< Length 0 or 1, nothing to do.
+        Radix2,     ///< Iterative Cooley-Tukey, for powers of 2.
+        MixedRadix, ///< Recursive Cooley-Tukey, when all prime factors are small.
+        Bluestein   ///< Chirp-z transform, for lengths with large prime factors.
+    };
+
+private:
+    /**
+     * @var length
+     * Length of the transform.
+     */
+    int length;
+    /**
+     * @var inverse
+     * Whether the plan computes the inverse transform.
+     */
+    bool inverse;
+    /**
+     * @var algorithm
+     * Algorithm used to compute the transform.
+     */
+    Algorithm algorithm;
+    /**
+     * @var twiddles
+     * Twiddle factors exp(-+2*pi*i*k/N), for k in [0, N).
+     */
+    vector<complex<double>> twiddles;
+    /**
+     * @var bit_reversal
+     * Pairs of indices (i, j), with i < j, to swap for the radix-2 bit reversal permutation.
+     */
+    vector<pair<int, int>> bit_reversal;
+    /**
+     * @var factors
+     * Prime factors of the length, used by the mixed-radix algorithm.
+     */
+    vector<int> factors;
+    /**
+     * @var chirp
+     * Chirp exp(-+i*pi*k^2/N) for Bluestein's algorithm.
+     */
+    vector<complex<double>> chirp;
+    /**
+     * @var chirp_filter
+     * Forward transform of the (padded) conjugate chirp, already scaled by the normalization of the convolution.
+     */
+    vector<complex<double>> chirp_filter;
+    /**
+     * @var convolution_forward
+     * Radix-2 forward plan used by Bluestein's algorithm.
+     */
+    shared_ptr<const FFTPlan> convolution_forward;
+    /**
+     * @var convolution_inverse
+     * Radix-2 inverse plan used by Bluestein's algorithm.
+     */
+    shared_ptr<const FFTPlan> convolution_inverse;
+
+    void executeRadix2(complex<double>* data) const;
+    void executeMixedRadix(complex<double>* output, const complex<double>* input, int stride, int factor_index,
+                           complex<double>* scratch) const;
+    void executeBluestein(complex<double>* data, complex<double>* scratch) const;
+
+public:
+    FFTPlan(int length, bool inverse);
+
+    static shared_ptr<const FFTPlan> get(int length, bool inverse = false);
+    static size_t cacheSize();
+    static void clearCache();
+
+    [[nodiscard]] int getLength() const;
+    [[nodiscard]] bool isInverse() const;
+    [[nodiscard]] Algorithm getAlgorithm() const;
+    [[nodiscard]] size_t getScratchSize() const;
+
+    void execute(complex<double>* data) const;
+    void execute(complex<double>* data, complex<double>* scratch) const;
+};
+
+
+#endif //IMAGEPROCESSING_FFTPLAN_HPP
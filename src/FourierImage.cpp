@@ -4,74 +4,294 @@
 
 #include "FourierImage.hpp"
 
+// Filter specifications //
+
+/*!
+ * @brief Describes a low pass filter.
+ * @param cutoff Radius of the kept circle, relative to the minimum dimension of the image.
+ * @param profile Profile of the edge of the filter.
+ * @param order Order of the Butterworth profile.
+ * @return The filter specification.
+ */
+FilterSpec FilterSpec::lowPass(double cutoff, FrequencyMask::Profile profile, int order) {
+    FilterSpec filter;
+    filter.type = Type::LowPass;
+    filter.cutoff1 = cutoff;
+    filter.profile = profile;
+    filter.order = order;
+    return filter;
+}
+
+/*!
+ * @brief Describes a high pass filter.
+ * @param cutoff Radius of the removed circle, relative to the minimum dimension of the image.
+ * @param profile Profile of the edge of the filter.
+ * @param order Order of the Butterworth profile.
+ * @return The filter specification.
+ */
+FilterSpec FilterSpec::highPass(double cutoff, FrequencyMask::Profile profile, int order) {
+    FilterSpec filter = FilterSpec::lowPass(cutoff, profile, order);
+    filter.type = Type::HighPass;
+    return filter;
+}
+
+/*!
+ * @brief Describes a band pass filter.
+ * @param cutoff1 Radius of the inner removed circle, relative to the minimum dimension of the image.
+ * @param cutoff2 Radius of the outer kept circle, relative to the minimum dimension of the image.
+ * @param profile Profile of the edges of the filter.
+ * @param order Order of the Butterworth profile.
+ * @return The filter specification.
+ */
+FilterSpec FilterSpec::bandPass(double cutoff1, double cutoff2, FrequencyMask::Profile profile, int order) {
+    FilterSpec filter = FilterSpec::lowPass(cutoff1, profile, order);
+    filter.type = Type::BandPass;
+    filter.cutoff2 = cutoff2;
+    return filter;
+}
+
+/*!
+ * @brief Describes a notch filter.
+ * @param u Row frequency of the center of the notch, in frequency bins.
+ * @param v Column frequency of the center of the notch, in frequency bins.
+ * @param radius Radius of the notch, in frequency bins.
+ * @param profile Profile of the edge of the filter.
+ * @param order Order of the Butterworth profile.
+ * @return The filter specification.
+ */
+FilterSpec FilterSpec::notch(double u, double v, double radius, FrequencyMask::Profile profile, int order) {
+    FilterSpec filter = FilterSpec::lowPass(radius, profile, order);
+    filter.type = Type::Notch;
+    filter.u = u;
+    filter.v = v;
+    return filter;
+}
+
 // Transform methods //
 
 /*!
  * @brief Applies the Fourier Transform to the image.
- * @details Applies the Fourier Transform to the image and stores the result in the transform attribute.
+ * @details Applies the Fourier Transform to the image and stores the non-redundant half of the result in the
+ * transform attribute. In multi-channel mode, every channel is transformed, in a single batch; otherwise color images
+ * are converted to grayscale first. The channels of images in a column-major layout are transformed in place, without
+ * copying them.
  * @param show_progress Whether to show the progress of the computation.
  * @return
  */
 void FourierImage::applyTransform(bool show_progress) {
-    Eigen::ArrayXXcd input;
-    // convert to complex, and to grayscale if necessary
-    if (this->getChannels() > 1) {
+    Image converted;
+    const Image* source = this;
+    if (!this->multi_channel && this->getChannels() != 1) {
+        // convert to grayscale
         std::cerr << "FourierImage::applyTransform: Converting to grayscale..." << endl;
-        input = this->reduceChannels().getData(0).cast<std::complex<double>>();
+        converted = this->reduceChannels();
+        source = &converted;
+    }
+    if (source->getRowStride() != 1) {
+        // the channels are read in place, so their columns must be contiguous
+        converted = source->toLayout(ImageLayout::PlanarColumnMajor);
+        source = &converted;
+    }
+    // the alpha channel is not transformed, it is copied by the inverse transforms
+    vector<Eigen::Ref<const Eigen::ArrayXXd>> inputs;
+    for (int c = 0; c < source->getColorChannels(); c++) {
+        inputs.emplace_back(source->getColumnMajorView(c));
+    }
+    this->full_transform = false;
+    this->data_transf.clear();
+    this->disk_transf.clear();
+    this->mapped_transf.reset();
+    if (this->isOutOfCore()) {
+        // one scratch file per channel, sharing the budget
+        int channels = (int) inputs.size();
+        for (int c = 0; c < channels; c++) {
+            this->disk_transf.push_back(make_shared<OutOfCoreSpectrum>(this->scratch_path, this->getHeight(),
+                                                                       this->getWidth(), this->ram_budget / channels));
+            this->disk_transf.back()->forward(inputs[c], show_progress);
+        }
     } else {
-        input = this->getData(0).cast<std::complex<double>>();
+        this->data_transf = rdft2(inputs, show_progress);
     }
-    this->data_transf = dft2(input, false, show_progress);
 }
 
 
 /*!
  * @brief Applies the inverse Fourier Transform to the image.
- * @details Applies the inverse Fourier Transform to the image, and stores the real part in the data attribute.
+ * @details Applies the inverse Fourier Transform to the image, and stores the real part in the data attribute. In
+ * multi-channel mode, all channels are transformed back in a single batch, and the result is a color image, with the
+ * alpha channel of the image (if any) unchanged.
  * @param show_progress Whether to show the progress of the computation.
  * @return A new FourierImage object with the result of the inverse transform.
  */
 FourierImage FourierImage::applyInverseTransform(bool show_progress) {
     // check if transform has been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
 
     // apply inverse transform
-    Eigen::ArrayXXcd output = dft2(this->data_transf, true, show_progress);
+    vector<Eigen::ArrayXXd> outputs;
+    if (!this->disk_transf.empty()) {
+        for (const auto& spectrum: this->disk_transf) {
+            outputs.push_back(spectrum->inverse(show_progress));
+        }
+    } else {
+        vector<Eigen::Map<const Eigen::ArrayXXcd>> views;
+        for (int c = 0; c < this->getTransformChannels(); c++) {
+            views.push_back(this->getTransformView(c));
+        }
+        if (this->full_transform) {
+            for (const auto& view: views) {
+                outputs.push_back(dft2(view, true, show_progress).real());
+            }
+        } else {
+            outputs = irdft2(views, this->getWidth(), show_progress);
+        }
+    }
+    for (auto& output: outputs) {
+        output = normalize(output);
+    }
+    if (this->hasAlpha() && (int) outputs.size() == this->getColorChannels()) {
+        outputs.push_back(this->getData(3));
+    }
 
     // create new fourier image
-    Eigen::ArrayXXd output_real = output.real();
-    FourierImage result = FourierImage(normalize(output_real));
-    result.setTransform(this->data_transf);
+    FourierImage result = FourierImage(outputs);
+    result.data_transf = this->data_transf;
+    result.full_transform = this->full_transform;
+    result.disk_transf = this->disk_transf;
+    result.mapped_transf = this->mapped_transf;
+    result.scratch_path = this->scratch_path;
+    result.ram_budget = this->ram_budget;
+    result.multi_channel = this->multi_channel;
     return result;
 }
 
 
+/*!
+ * @brief Enables the out-of-core mode.
+ * @details The next transforms are computed into a memory-mapped scratch file, and at most about 'budget' bytes of
+ * the spectrum are in memory at any time during the transforms and the filters. Getting the transform (or its
+ * magnitude, phase...) still loads it in memory. Copies of the image share the scratch files until one of them is
+ * filtered, which then gets its own copy of the spectrum first.
+ * @param path Path of the scratch files. They are created by applyTransform with a unique suffix, and never outlive
+ * the images using them.
+ * @param budget Number of bytes of the spectrum allowed in memory. Zero disables the out-of-core mode.
+ * @return
+ */
+void FourierImage::enableOutOfCore(const string& path, size_t budget) {
+    this->scratch_path = path;
+    this->ram_budget = budget;
+}
+
+
+/*!
+ * @brief Checks whether the out-of-core mode is enabled.
+ * @return True if the transforms are computed into a scratch file.
+ */
+bool FourierImage::isOutOfCore() const {
+    return this->ram_budget > 0;
+}
+
+
+/*!
+ * @brief Enables or disables the multi-channel mode.
+ * @details In multi-channel mode, applyTransform keeps the color of the image: each channel gets its own spectrum,
+ * the filters are applied to every channel, and applyInverseTransform returns a color image. Otherwise, color images
+ * are converted to grayscale before the transform.
+ * @param enable Whether to enable the multi-channel mode.
+ * @return
+ */
+void FourierImage::setMultiChannel(bool enable) {
+    this->multi_channel = enable;
+}
+
+
+/*!
+ * @brief Checks whether the multi-channel mode is enabled.
+ * @return True if all channels are transformed.
+ */
+bool FourierImage::isMultiChannel() const {
+    return this->multi_channel;
+}
+
+
+/*!
+ * @brief Number of channels of the transform.
+ * @return Number of spectra (one per transformed channel), or 0 if no transform has been applied.
+ */
+int FourierImage::getTransformChannels() const {
+    if (this->mapped_transf) {
+        return this->mapped_transf->getChannels();
+    }
+    return (int) max(this->data_transf.size(), this->disk_transf.size());
+}
+
+
+/*!
+ * @brief Views the spectrum of a channel held in memory.
+ * @details Gives the same access to the computed spectra and to the spectra mapped from a file.
+ * @param channel Channel of the transform. There must be a transform in memory (not in out-of-core mode).
+ * @return Read-only view of the stored spectrum.
+ */
+Eigen::Map<const Eigen::ArrayXXcd> FourierImage::getTransformView(int channel) const {
+    if (this->mapped_transf) {
+        Eigen::Map<Eigen::ArrayXXcd> mapped = this->mapped_transf->map(channel);
+        return {mapped.data(), mapped.rows(), mapped.cols()};
+    }
+    const Eigen::ArrayXXcd& transform = this->data_transf[channel];
+    return {transform.data(), transform.rows(), transform.cols()};
+}
+
+
+/*!
+ * @brief Checks whether the transform has been computed (or set).
+ * @return True if there is a transform, in memory or on disk.
+ */
+bool FourierImage::hasTransform() const {
+    return this->getTransformChannels() > 0;
+}
+
+
 // Getters //
 
 /*!
  * @brief Returns the transform attribute.
- * @details Returns the transform attribute.
+ * @details Returns the full spectrum, expanding the stored half spectrum if needed. In out-of-core mode, the spectrum
+ * is loaded from the scratch file.
+ * @param channel Channel of the transform (see getTransformChannels).
  * @return The transform attribute.
  */
-Eigen::ArrayXXcd FourierImage::getTransform() const {
-    return this->data_transf;
+Eigen::ArrayXXcd FourierImage::getTransform(int channel) const {
+    if (!this->hasTransform()) {
+        return {};
+    }
+    if (channel < 0 || channel >= this->getTransformChannels()) {
+        throw std::invalid_argument("Invalid transform channel.");
+    }
+    if (!this->disk_transf.empty()) {
+        return expandHalfSpectrum(this->disk_transf[channel]->load(), this->getWidth());
+    }
+    if (this->full_transform) {
+        return this->getTransformView(channel);
+    }
+    return expandHalfSpectrum(this->getTransformView(channel), this->getWidth());
 }
 
 
 /*!
  * @brief Returns the magnitude of the transform attribute.
  * @details Returns the magnitude of the transform attribute as a new Eigen::ArrayXXd object.
+ * @param channel Channel of the transform (see getTransformChannels).
  * @return The magnitude of the transform attribute.
  */
-Eigen::ArrayXXd FourierImage::getMagnitude(bool log) const {
+Eigen::ArrayXXd FourierImage::getMagnitude(bool log, int channel) const {
     // throw error if transform has not been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
 
-    Eigen::ArrayXXd magnitude = this->data_transf.abs();
+    Eigen::ArrayXXd magnitude = this->getTransform(channel).abs();
     if (log) {
         magnitude = (magnitude + 1e-8).log();
     }
@@ -82,14 +302,15 @@ Eigen::ArrayXXd FourierImage::getMagnitude(bool log) const {
 /*!
  * @brief Returns the phase of the transform attribute.
  * @details Returns the phase of the transform attribute as a new Eigen::ArrayXXd object.
+ * @param channel Channel of the transform (see getTransformChannels).
  * @return The phase of the transform attribute.
  */
-Eigen::ArrayXXd FourierImage::getPhase() const {
+Eigen::ArrayXXd FourierImage::getPhase(int channel) const {
     // throw error if transform has not been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
-    Eigen::ArrayXXd phase = this->data_transf.arg();
+    Eigen::ArrayXXd phase = this->getTransform(channel).arg();
     return phase;
 }
 
@@ -97,14 +318,15 @@ Eigen::ArrayXXd FourierImage::getPhase() const {
 /*!
  * @brief Returns the real part of the transform attribute.
  * @details Returns the real part of the transform attribute as a new Eigen::ArrayXXd object.
+ * @param channel Channel of the transform (see getTransformChannels).
  * @return The real part of the transform attribute.
  */
-Eigen::ArrayXXd FourierImage::getReal() const {
+Eigen::ArrayXXd FourierImage::getReal(int channel) const {
     // throw error if transform has not been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
-    Eigen::ArrayXXd real = this->data_transf.real();
+    Eigen::ArrayXXd real = this->getTransform(channel).real();
     return real;
 }
 
@@ -112,23 +334,54 @@ Eigen::ArrayXXd FourierImage::getReal() const {
 /*!
  * @brief Returns the imaginary part of the transform attribute.
  * @details Returns the imaginary part of the transform attribute as a new Eigen::ArrayXXd object.
+ * @param channel Channel of the transform (see getTransformChannels).
  * @return The imaginary part of the transform attribute.
  */
-Eigen::ArrayXXd FourierImage::getImaginary() const {
+Eigen::ArrayXXd FourierImage::getImaginary(int channel) const {
     // throw error if transform has not been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
-    Eigen::ArrayXXd imaginary = this->data_transf.imag();
+    Eigen::ArrayXXd imaginary = this->getTransform(channel).imag();
     return imaginary;
 }
 
 
+/*!
+ * @brief Saves the transform to a file.
+ * @details Writes the stored spectra (half or full, for every channel) in the format of SpectrumFile, so that they can
+ * be loaded with loadTransform instead of being computed again. In out-of-core mode, the spectra are read from the
+ * scratch files one channel at a time.
+ * @param path Path of the spectrum file. It is overwritten if it exists.
+ * @param single_precision Whether to store the values as floats, which halves the size of the file but prevents
+ * mapping it without conversion.
+ * @return
+ */
+void FourierImage::saveTransform(const string& path, bool single_precision) const {
+    if (!this->hasTransform()) {
+        throw std::runtime_error("No transform has been applied to the image.");
+    }
+    SpectrumFile::Precision precision = single_precision ? SpectrumFile::Precision::Float :
+                                        SpectrumFile::Precision::Double;
+    int channels = this->getTransformChannels();
+    ofstream file = SpectrumFile::create(path, SpectrumFile::makeHeader(this->getHeight(), this->getWidth(), channels,
+                                                                        this->full_transform, precision));
+    for (int c = 0; c < channels; c++) {
+        if (!this->disk_transf.empty()) {
+            SpectrumFile::append(file, this->disk_transf[c]->load(), precision);
+        } else {
+            SpectrumFile::append(file, this->getTransformView(c), precision);
+        }
+    }
+}
+
+
 // Setters //
 
 /*!
  * @brief Sets the transform attribute.
- * @details Sets the transform attribute.
+ * @details Sets the transform attribute. The given spectrum is stored in full (and in memory), since it is not
+ * necessarily Hermitian. It replaces the transform of all channels.
  * @param transform The new transform attribute.
  * @return
  */
@@ -138,110 +391,259 @@ void FourierImage::setTransform(const Eigen::ArrayXXcd &transform) {
         throw std::runtime_error("Invalid transform size.");
     }
 
-    this->data_transf = transform;
+    this->data_transf = {transform};
+    this->full_transform = true;
+    this->disk_transf.clear();
+    this->mapped_transf.reset();
 }
 
 
-// Filter methods //
-
 /*!
- * @brief Applies a low pass filter.
- * @details Applies a low pass filter to the transform attribute.
- * @param cutoff The cutoff frequency of the filter. It's the radius of the circle that will be kept,
- * relative to the minimum dimension of the image.
+ * @brief Loads a transform saved with saveTransform.
+ * @details Double precision files are memory-mapped and used in place (zero-copy): nothing is read until the spectrum
+ * is accessed, and filtering it never modifies the file. Single precision files are read and converted to double.
+ * The file must have the size of the image, and as many spectra as applyTransform would compute (one per color channel
+ * in multi-channel mode, one otherwise).
+ * @param path Path of the spectrum file.
  * @return
  */
-void FourierImage::applyLowPassFilter(double cutoff) {
-    // check if transform has been applied
-    if (this->data_transf.size() == 0) {
-        throw std::runtime_error("No transform has been applied to the image.");
+void FourierImage::loadTransform(const string& path) {
+    auto file = make_shared<SpectrumFile>(path);
+    if (file->getRows() != this->getHeight() || file->getCols() != this->getWidth()) {
+        throw std::invalid_argument("The stored transform does not match the size of the image.");
     }
-
-    // check if cutoff is valid
-    if (cutoff < 0) {
-        throw std::invalid_argument("Invalid cutoff value.");
+    // one spectrum per channel in multi-channel mode, and a single one of the grayscale image otherwise
+    if (file->getChannels() != (this->multi_channel ? this->getColorChannels() : 1)) {
+        throw std::invalid_argument("The stored transform does not match the channels of the image.");
     }
+    this->data_transf.clear();
+    this->disk_transf.clear();
+    this->mapped_transf.reset();
+    this->full_transform = file->isFull();
+    if (file->getPrecision() == SpectrumFile::Precision::Double) {
+        this->mapped_transf = file;
+    } else {
+        for (int c = 0; c < file->getChannels(); c++) {
+            this->data_transf.push_back(file->read(c));
+        }
+    }
+}
 
-    // sizes
-    int rows = (int) this->data_transf.rows();
-    int cols = (int) this->data_transf.cols();
 
-    // apply filter, assuming the frequency domain is centered in the image
-    Eigen::ArrayXXcd output = this->data_transf;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            double distance = sqrt(pow(i - (rows - 1) / 2, 2) + pow(j - (cols - 1) / 2, 2));
-            if (distance >= cutoff * min(rows, cols) / 2) {
-                output(i, j) = 0;
-            }
+// Filter methods //
+
+/*!
+ * @brief Multiplies the transform by a radial mask.
+ * @details The mask is symmetric around the zero frequency, so it can be applied directly to the half spectrum. In
+ * memory, the sampled mask is taken from the mask cache and applied in place with a single element-wise product. In
+ * out-of-core mode, it is evaluated tile by tile instead, so that it is never held in memory in full, and shared
+ * scratch files are copied first so that the other copies of the image are left untouched. Likewise, spectra mapped
+ * from a file are filtered in place only if no other copy of the image uses them. In multi-channel
+ * mode, the same mask is applied to every channel.
+ * @param mask The mask to apply.
+ * @return
+ */
+void FourierImage::applyMask(const FrequencyMask& mask) {
+    for (auto& spectrum: this->disk_transf) {
+        // copies of the image share their spectra until they are modified
+        if (spectrum.use_count() > 1) {
+            spectrum = make_shared<OutOfCoreSpectrum>(*spectrum);
         }
+        spectrum->applyMask(mask);
+    }
+    if (!this->disk_transf.empty()) {
+        return;
+    }
+    // mapped spectra shared with other copies of the image are copied in memory before being modified
+    if (this->mapped_transf && this->mapped_transf.use_count() > 1) {
+        for (int c = 0; c < this->mapped_transf->getChannels(); c++) {
+            this->data_transf.emplace_back(this->mapped_transf->map(c));
+        }
+        this->mapped_transf.reset();
+    }
+    // column frequency of column 0 of the stored spectrum
+    int col_offset = this->full_transform ? -this->getWidth() / 2 : 0;
+    Eigen::Map<const Eigen::ArrayXXcd> first = this->getTransformView(0);
+    shared_ptr<const Eigen::ArrayXXd> sampled = FrequencyMask::get(mask, (int) first.rows(), (int) first.cols(),
+                                                                   col_offset);
+    for (auto& transform: this->data_transf) {
+        transform *= *sampled;
+    }
+    // mapped spectra owned by this image alone are filtered in place, in private copies of the pages of the file
+    for (int c = 0; this->mapped_transf && c < this->mapped_transf->getChannels(); c++) {
+        this->mapped_transf->map(c) *= *sampled;
     }
-    this->data_transf = output;
 }
 
+/*!
+ * @brief Builds the mask of a filter.
+ * @details Checks the parameters of the filter, and converts its relative cutoffs to frequency bins.
+ * @param filter Description of the filter.
+ * @return The mask of the filter.
+ */
+FrequencyMask FourierImage::makeMask(const FilterSpec& filter) const {
+    double half_min_dimension = min(this->getHeight(), this->getWidth()) / 2.;
+    switch (filter.type) {
+        case FilterSpec::Type::LowPass:
+        case FilterSpec::Type::HighPass:
+            // check if cutoff is valid
+            if (filter.cutoff1 < 0) {
+                throw std::invalid_argument("Invalid cutoff value.");
+            }
+            // filter around the zero frequency (center of the image)
+            if (filter.type == FilterSpec::Type::LowPass) {
+                return {0, filter.cutoff1 * half_min_dimension, filter.profile, filter.order};
+            }
+            return {filter.cutoff1 * half_min_dimension, numeric_limits<double>::infinity(), filter.profile,
+                    filter.order};
+        case FilterSpec::Type::BandPass:
+            // check if cutoffs are valid
+            if (filter.cutoff1 > filter.cutoff2) {
+                throw std::invalid_argument("Lower cutoff must be smaller than upper cutoff.");
+            }
+            if (filter.cutoff1 < 0 || filter.cutoff2 < 0) {
+                throw std::invalid_argument("Cutoffs must be positive.");
+            }
+            return {filter.cutoff1 * half_min_dimension, filter.cutoff2 * half_min_dimension, filter.profile,
+                    filter.order};
+        case FilterSpec::Type::Notch:
+            if (filter.cutoff1 < 0) {
+                throw std::invalid_argument("Invalid notch radius.");
+            }
+            return FrequencyMask::notch(filter.u, filter.v, filter.cutoff1, filter.profile, filter.order);
+    }
+    throw std::invalid_argument("Invalid filter type.");
+}
 
 /*!
- * @brief Applies a high pass filter.
- * @details Applies a high pass filter to the transform attribute.
- * @param cutoff The cutoff frequency of the filter. It's the radius of the circle that will be removed,
- * relative to the minimum dimension of the image.
+ * @brief Applies a filter.
+ * @details Applies the given filter to the transform attribute, in a single pass over the spectrum.
+ * @param filter Description of the filter.
  * @return
  */
-void FourierImage::applyHighPassFilter(double cutoff) {
+void FourierImage::applyFilter(const FilterSpec& filter) {
     // check if transform has been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
+    this->applyMask(this->makeMask(filter));
+}
 
-    // check if cutoff is valid
-    if (cutoff < 0) {
-        throw std::invalid_argument("Invalid cutoff value.");
-    }
+/*!
+ * @brief Applies a low pass filter.
+ * @details Applies a low pass filter to the transform attribute.
+ * @param cutoff The cutoff frequency of the filter. It's the radius of the circle that will be kept,
+ * relative to the minimum dimension of the image.
+ * @param profile Profile of the edge of the filter (ideal, Butterworth or Gaussian).
+ * @param order Order of the Butterworth profile.
+ * @return
+ */
+void FourierImage::applyLowPassFilter(double cutoff, FrequencyMask::Profile profile, int order) {
+    this->applyFilter(FilterSpec::lowPass(cutoff, profile, order));
+}
 
-    // sizes
-    int rows = (int) this->data_transf.rows();
-    int cols = (int) this->data_transf.cols();
 
-    // apply filter, assuming the frequency domain is centered in the image
-    Eigen::ArrayXXcd output = this->data_transf;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            double distance = sqrt(pow(i - (rows - 1) / 2, 2) + pow(j - (cols - 1) / 2, 2));
-            if (distance <= cutoff * min(rows, cols) / 2) {
-                output(i, j) = 0;
-            }
-        }
-    }
-    this->data_transf = output;
+/*!
+ * @brief Applies a high pass filter.
+ * @details Applies a high pass filter to the transform attribute.
+ * @param cutoff The cutoff frequency of the filter. It's the radius of the circle that will be removed,
+ * relative to the minimum dimension of the image.
+ * @param profile Profile of the edge of the filter (ideal, Butterworth or Gaussian).
+ * @param order Order of the Butterworth profile.
+ * @return
+ */
+void FourierImage::applyHighPassFilter(double cutoff, FrequencyMask::Profile profile, int order) {
+    this->applyFilter(FilterSpec::highPass(cutoff, profile, order));
 }
 
 
 /*!
  * @brief Applies a band pass filter.
- * @details Applies a band pass filter to the transform attribute.
+ * @details Applies a band pass filter to the transform attribute, in a single pass over the spectrum (the smooth
+ * profiles multiply the low and high pass masks into one).
  * @param cutoff1 The first cutoff frequency of the filter. It's the radius of the inner circle that will be removed,
  * relative to the minimum dimension of the image.
  * @param cutoff2 The second cutoff frequency of the filter. It's the radius of the outer circle that will be removed,
  * relative to the minimum dimension of the image.
+ * @param profile Profile of the edge of the filter (ideal, Butterworth or Gaussian).
+ * @param order Order of the Butterworth profile.
+ * @return
+ */
+void FourierImage::applyBandPassFilter(double cutoff1, double cutoff2, FrequencyMask::Profile profile, int order) {
+    this->applyFilter(FilterSpec::bandPass(cutoff1, cutoff2, profile, order));
+}
+
+
+/*!
+ * @brief Applies a notch filter.
+ * @details Removes the frequencies around (u, v) and its symmetric (-u, -v), e.g. to remove periodic noise.
+ * @param u Row frequency of the center of the notch, in frequency bins.
+ * @param v Column frequency of the center of the notch, in frequency bins.
+ * @param radius Radius of the notch, in frequency bins.
+ * @param profile Profile of the edge of the filter (ideal, Butterworth or Gaussian).
+ * @param order Order of the Butterworth profile.
  * @return
  */
-void FourierImage::applyBandPassFilter(double cutoff1, double cutoff2) {
+void FourierImage::applyNotchFilter(double u, double v, double radius, FrequencyMask::Profile profile, int order) {
+    this->applyFilter(FilterSpec::notch(u, v, radius, profile, order));
+}
+
+
+/*!
+ * @brief Applies a bank of filters to the transform.
+ * @details Each filter is applied to the current transform (which is not modified), and all the inverse transforms
+ * are computed in a single batch: the spectrum of each channel is shared by all filters, and each mask is applied while
+ * the spectrum is loaded into the working buffers of its inverse transform. The memory used is about one spectrum per
+ * filter and channel. Not available in out-of-core mode.
+ * @param filters Descriptions of the filters.
+ * @param show_progress Whether to show the progress of the computation.
+ * @return One filtered image per filter, in the same order, with one channel per channel of the transform (and the
+ * alpha channel of the image, unchanged, in multi-channel mode).
+ */
+vector<Image> FourierImage::applyFilterBank(const vector<FilterSpec>& filters, bool show_progress) const {
     // check if transform has been applied
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         throw std::runtime_error("No transform has been applied to the image.");
     }
-    // check if cutoffs are valid
-    if (cutoff1 > cutoff2) {
-        throw std::invalid_argument("Lower cutoff must be smaller than upper cutoff.");
+    if (!this->disk_transf.empty()) {
+        throw std::runtime_error("Filter banks are not available in out-of-core mode.");
     }
-    if (cutoff1 < 0 || cutoff2 < 0) {
-        throw std::invalid_argument("Cutoffs must be positive.");
+
+    int channels = this->getTransformChannels();
+    int col_offset = this->full_transform ? -this->getWidth() / 2 : 0;
+    vector<Eigen::Map<const Eigen::ArrayXXcd>> inputs;
+    vector<shared_ptr<const Eigen::ArrayXXd>> masks;
+    for (const auto& filter: filters) {
+        Eigen::Map<const Eigen::ArrayXXcd> first = this->getTransformView(0);
+        shared_ptr<const Eigen::ArrayXXd> mask = FrequencyMask::get(this->makeMask(filter), (int) first.rows(),
+                                                                    (int) first.cols(), col_offset);
+        for (int c = 0; c < channels; c++) {
+            inputs.push_back(this->getTransformView(c));
+            masks.push_back(mask);
+        }
+    }
+
+    vector<Eigen::ArrayXXd> outputs;
+    if (this->full_transform) {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            outputs.push_back(dft2(inputs[i] * *masks[i], true, show_progress).real());
+        }
+    } else {
+        outputs = maskedIrdft2(inputs, masks, this->getWidth(), show_progress);
     }
-    // apply high pass filter
-    this->applyHighPassFilter(cutoff1);
 
-    // apply low pass filter
-    this->applyLowPassFilter(cutoff2);
+    vector<Image> results;
+    for (size_t f = 0; f < filters.size(); f++) {
+        vector<Eigen::ArrayXXd> filtered;
+        for (int c = 0; c < channels; c++) {
+            filtered.push_back(normalize(outputs[f * channels + c]));
+        }
+        if (this->hasAlpha() && channels == this->getColorChannels()) {
+            filtered.push_back(this->getData(3));
+        }
+        results.emplace_back(filtered);
+    }
+    return results;
 }
 
 /*!
@@ -254,7 +656,7 @@ void FourierImage::applyBandPassFilter(double cutoff1, double cutoff2) {
  */
 void FourierImage::show(const string& window_name){
     // check if FT has been computed
-    if (this->data_transf.size() == 0) {
+    if (!this->hasTransform()) {
         // show image
         this->showImage(window_name);
     } else {
@@ -8,38 +8,129 @@
 
 #include "Image.hpp"
 #include "operations.hpp"
+#include "OutOfCoreSpectrum.hpp"
+#include "FrequencyMask.hpp"
+#include "SpectrumFile.hpp"
+#include <memory>
+/*!
+ * @brief Description of a frequency-domain filter, as used by FourierImage::applyFilterBank.
+ * @details Low, high and band pass cutoffs are relative to the minimum dimension of the image, as in the filter methods
+ * of FourierImage. Notch filters are given in frequency bins.
+ */
+struct FilterSpec {
+    /**
+     * @brief Type of filter.
+     */
+    enum class Type {
+        LowPass,  ///< Keeps the frequencies below cutoff1.
+        HighPass, ///< Removes the frequencies below cutoff1.
+        BandPass, ///< Keeps the frequencies between cutoff1 and cutoff2.
+        Notch     ///< Removes the frequencies within cutoff1 bins of (u, v) and (-u, -v).
+    };
+
+    /*! Type of filter.*/
+    Type type = Type::LowPass;
+    /*! Cutoff of low and high pass filters, lower cutoff of band pass filters, or radius of notch filters.*/
+    double cutoff1 = 0;
+    /*! Upper cutoff of band pass filters.*/
+    double cutoff2 = 0;
+    /*! Row frequency of the center of notch filters.*/
+    double u = 0;
+    /*! Column frequency of the center of notch filters.*/
+    double v = 0;
+    /*! Profile of the edges of the filter.*/
+    FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal;
+    /*! Order of the Butterworth profile.*/
+    int order = 2;
+
+    static FilterSpec lowPass(double cutoff, FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal,
+                              int order = 2);
+    static FilterSpec highPass(double cutoff, FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal,
+                               int order = 2);
+    static FilterSpec bandPass(double cutoff1, double cutoff2,
+                               FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal, int order = 2);
+    static FilterSpec notch(double u, double v, double radius,
+                            FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal, int order = 2);
+};
+
 /*!
  * @brief The FourierImage class
  * @details This class inherits from the Image class and adds methods to perform Fourier Transformations on the image.
  * It also contains methods to perform inverse Fourier Transformations. The Fourier Transformations are performed using
  * DFT (Discrete Fourier Transform) and DFT2 (2D Discrete Fourier Transform).
  * The frequency domain is centered in the middle of the image.
+ * Since images are real, their transform is Hermitian, and only the non-redundant half of it (non-negative column
+ * frequencies) is computed and stored. Filters and the inverse transform work directly on the half spectrum, and the
+ * full spectrum is only expanded by the getters.
+ * Color images are converted to grayscale before the transform, unless the multi-channel mode is enabled (see
+ * setMultiChannel), in which case each channel has its own spectrum and the filters preserve color.
+ * Several filters can be applied to the same transform at once with applyFilterBank, which leaves the transform
+ * untouched and returns one filtered image per filter.
+ * Transforms can be saved to a file and loaded back (see saveTransform and loadTransform), without recomputing them.
+ * For images whose spectrum does not fit in memory, enableOutOfCore makes the transform live in a memory-mapped
+ * scratch file instead (see OutOfCoreSpectrum), and the filters and the inverse transform then work on it a block at a
+ * time.
  */
 class FourierImage : public Image {
 private:
-    /*! Contains the Fourier Transform of the data.*/
-    Eigen::ArrayXXcd data_transf;
+    /*! Contains the Fourier Transform of the data, one spectrum per transformed channel. Each one is the half spectrum
+     * computed by rdft2, unless a full spectrum was given with setTransform.*/
+    vector<Eigen::ArrayXXcd> data_transf;
+    /*! Whether data_transf holds the full spectrum instead of the half spectrum.*/
+    bool full_transform = false;
+    /*! Disk-backed half spectra, used instead of data_transf in out-of-core mode. Copies of the image share them until
+     * one of them is filtered.*/
+    vector<shared_ptr<OutOfCoreSpectrum>> disk_transf;
+    /*! Spectra mapped from a file by loadTransform, used instead of data_transf. Copies of the image share them until
+     * one of them is filtered.*/
+    shared_ptr<SpectrumFile> mapped_transf;
+    /*! Path of the scratch files used in out-of-core mode (a unique suffix is appended to it).*/
+    string scratch_path;
+    /*! Number of bytes of the spectrum allowed in memory in out-of-core mode. Zero disables the out-of-core mode.*/
+    size_t ram_budget = 0;
+    /*! Whether all channels are transformed, instead of the grayscale image.*/
+    bool multi_channel = false;
+
+    [[nodiscard]] bool hasTransform() const;
+    [[nodiscard]] Eigen::Map<const Eigen::ArrayXXcd> getTransformView(int channel) const;
+    [[nodiscard]] FrequencyMask makeMask(const FilterSpec& filter) const;
+    void applyMask(const FrequencyMask& mask);
 
 public:
     using Image::Image; // use constructor inheritance
     explicit FourierImage(const Image& image) : Image(image){};
+    explicit FourierImage(Image&& image) : Image(std::move(image)){};
     void applyTransform(bool show_progress = false);
     FourierImage applyInverseTransform(bool show_progress = false);
+    void enableOutOfCore(const string& path, size_t budget);
+    [[nodiscard]] bool isOutOfCore() const;
+    void setMultiChannel(bool enable);
+    [[nodiscard]] bool isMultiChannel() const;
 
     // Getters
-    [[nodiscard]] Eigen::ArrayXXcd getTransform() const;
-    [[nodiscard]] Eigen::ArrayXXd getMagnitude(bool log=false) const;
-    [[nodiscard]] Eigen::ArrayXXd getPhase() const;
-    [[nodiscard]] Eigen::ArrayXXd getReal() const;
-    [[nodiscard]] Eigen::ArrayXXd getImaginary() const;
+    [[nodiscard]] int getTransformChannels() const;
+    [[nodiscard]] Eigen::ArrayXXcd getTransform(int channel = 0) const;
+    [[nodiscard]] Eigen::ArrayXXd getMagnitude(bool log=false, int channel = 0) const;
+    [[nodiscard]] Eigen::ArrayXXd getPhase(int channel = 0) const;
+    [[nodiscard]] Eigen::ArrayXXd getReal(int channel = 0) const;
+    [[nodiscard]] Eigen::ArrayXXd getImaginary(int channel = 0) const;
+    void saveTransform(const string& path, bool single_precision = false) const;
 
     // setters
     void setTransform(const Eigen::ArrayXXcd& transform);
+    void loadTransform(const string& path);
 
     // filter methods
-    void applyLowPassFilter(double cutoff);
-    void applyHighPassFilter(double cutoff);
-    void applyBandPassFilter(double cutoff1, double cutoff2);
+    void applyLowPassFilter(double cutoff, FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal,
+                            int order = 2);
+    void applyHighPassFilter(double cutoff, FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal,
+                             int order = 2);
+    void applyBandPassFilter(double cutoff1, double cutoff2,
+                             FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal, int order = 2);
+    void applyNotchFilter(double u, double v, double radius,
+                          FrequencyMask::Profile profile = FrequencyMask::Profile::Ideal, int order = 2);
+    void applyFilter(const FilterSpec& filter);
+    [[nodiscard]] vector<Image> applyFilterBank(const vector<FilterSpec>& filters, bool show_progress = false) const;
 
     // override show method
     void show(const string& window_name = "window");
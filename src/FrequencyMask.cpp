@@ -0,0 +1,248 @@
+//
+// Radial frequency-domain masks for the Fourier filters.
+//
+
+#include "FrequencyMask.hpp"
+#include "ThreadPool.hpp"
+#include <cmath>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+// Masks are as large as the spectra they are applied to, so the cache is bounded by bytes: only the most recently used
+// masks that fit in the budget are kept.
+static const size_t DEFAULT_MASK_CACHE_BUDGET = (size_t) 256 << 20;
+
+// Process-wide mask cache, keyed by (rows, cols, col_offset, keep_from, keep_to, profile, order, center_u, center_v),
+// most recent first.
+typedef tuple<int, int, int, double, double, int, int, double, double> MaskKey;
+static list<pair<MaskKey, shared_ptr<const Eigen::ArrayXXd>>> mask_cache;
+static size_t mask_cache_bytes = 0;
+static size_t mask_cache_budget = DEFAULT_MASK_CACHE_BUDGET;
+static mutex mask_cache_mutex;
+
+/*!
+ * @brief Removes the least recently used masks until the cache fits in its budget.
+ * @details The cache mutex must be held.
+ * @return
+ */
+static void evictMasks() {
+    while (mask_cache_bytes > mask_cache_budget) {
+        mask_cache_bytes -= mask_cache.back().second->size() * sizeof(double);
+        mask_cache.pop_back();
+    }
+}
+
+/*!
+ * @brief Constructor for FrequencyMask
+ * @param keep_from Inner radius of the kept ring, in frequency bins. Zero for a low pass filter.
+ * @param keep_to Outer radius of the kept ring, in frequency bins. Infinity for a high pass filter.
+ * @param profile Profile of the edges of the ring.
+ * @param order Order of the Butterworth profile (ignored by the other profiles). Must be positive.
+ */
+FrequencyMask::FrequencyMask(double keep_from, double keep_to, Profile profile, int order) {
+    if (keep_from < 0 || keep_to < keep_from) {
+        throw invalid_argument("Invalid mask radii.");
+    }
+    if (order < 1) {
+        throw invalid_argument("Butterworth order must be positive.");
+    }
+    this->keep_from = keep_from;
+    this->keep_to = keep_to;
+    this->profile = profile;
+    this->order = order;
+}
+
+/*!
+ * @brief Creates a notch mask.
+ * @details A notch removes the frequencies within 'radius' of (u, v), and of its symmetric (-u, -v) so that the
+ * filtered image stays real. It is used to remove periodic noise, which shows as isolated peaks in the spectrum.
+ * @param u Row frequency of the center of the notch, in frequency bins.
+ * @param v Column frequency of the center of the notch, in frequency bins.
+ * @param radius Radius of the notch, in frequency bins.
+ * @param profile Profile of the edge of the notch.
+ * @param order Order of the Butterworth profile.
+ * @return The notch mask.
+ */
+FrequencyMask FrequencyMask::notch(double u, double v, double radius, Profile profile, int order) {
+    FrequencyMask mask(radius, numeric_limits<double>::infinity(), profile, order);
+    mask.center_u = u;
+    mask.center_v = v;
+    return mask;
+}
+
+/*!
+ * @brief Simple inner radius getter.
+ * @return Inner radius of the kept ring.
+ */
+double FrequencyMask::getKeepFrom() const {
+    return this->keep_from;
+}
+
+/*!
+ * @brief Simple outer radius getter.
+ * @return Outer radius of the kept ring.
+ */
+double FrequencyMask::getKeepTo() const {
+    return this->keep_to;
+}
+
+/*!
+ * @brief Simple profile getter.
+ * @return Profile of the edges of the ring.
+ */
+FrequencyMask::Profile FrequencyMask::getProfile() const {
+    return this->profile;
+}
+
+/*!
+ * @brief Simple order getter.
+ * @return Order of the Butterworth profile.
+ */
+int FrequencyMask::getOrder() const {
+    return this->order;
+}
+
+/*!
+ * @brief Checks whether this is a notch mask.
+ * @return True if the mask is centered on a pair of non-zero frequencies.
+ */
+bool FrequencyMask::isNotch() const {
+    return this->center_u != 0 || this->center_v != 0;
+}
+
+/*!
+ * @brief Value of the radial profile of the mask at a given distance from its center.
+ * @details An edge at radius 0 (low pass) or infinity (high pass) does not attenuate anything.
+ * @param distance Distance to the center of the mask, in frequency bins.
+ * @return Gain of the mask, in [0, 1].
+ */
+double FrequencyMask::gain(double distance) const {
+    switch (this->profile) {
+        case Profile::Ideal:
+            return distance >= this->keep_from && distance < this->keep_to ? 1. : 0.;
+        case Profile::Butterworth: {
+            double low = isinf(this->keep_to) ? 1. : 1. / (1. + pow(distance / this->keep_to, 2 * this->order));
+            double high = this->keep_from == 0 ? 1. : 1. - 1. / (1. + pow(distance / this->keep_from, 2 * this->order));
+            return low * high;
+        }
+        case Profile::Gaussian: {
+            double low = isinf(this->keep_to) ? 1. : exp(-distance * distance / (2 * this->keep_to * this->keep_to));
+            double high = this->keep_from == 0 ? 1. :
+                          1. - exp(-distance * distance / (2 * this->keep_from * this->keep_from));
+            return low * high;
+        }
+    }
+    return 0.;
+}
+
+/*!
+ * @brief Value of the mask at a given frequency.
+ * @param u Row frequency.
+ * @param v Column frequency.
+ * @return Gain of the mask, in [0, 1].
+ */
+double FrequencyMask::gain(double u, double v) const {
+    if (!this->isNotch()) {
+        return this->gain(sqrt(u * u + v * v));
+    }
+    double du = u - this->center_u;
+    double dv = v - this->center_v;
+    double su = u + this->center_u;
+    double sv = v + this->center_v;
+    return this->gain(sqrt(du * du + dv * dv)) * this->gain(sqrt(su * su + sv * sv));
+}
+
+/*!
+ * @brief Samples the mask on a centered spectrum.
+ * @details Rows are centered (row i is the frequency i - rows/2), and column j is the frequency j + col_offset, so the
+ * same mask can be sampled on a half spectrum (col_offset = 0) or on a full one (col_offset = -width/2).
+ * @param rows Number of rows of the spectrum.
+ * @param cols Number of columns of the spectrum.
+ * @param col_offset Frequency of the first column.
+ * @return Mask with the shape of the spectrum.
+ */
+Eigen::ArrayXXd FrequencyMask::sample(int rows, int cols, int col_offset) const {
+    Eigen::ArrayXXd mask(rows, cols);
+    ThreadPool::global().parallelFor(0, cols, [&](int, int j) {
+        double v = j + col_offset;
+        for (int i = 0; i < rows; i++) {
+            mask(i, j) = this->gain(i - rows / 2, v);
+        }
+    });
+    return mask;
+}
+
+/*!
+ * @brief Gets a sampled mask from the process-wide cache.
+ * @details Returns the cached mask for the given spectrum shape, sampling it on the first request (see sample). Masks
+ * larger than the cache budget (see setCacheBudget) are sampled on every request. This method is thread-safe.
+ * @param mask Description of the mask.
+ * @param rows Number of rows of the spectrum.
+ * @param cols Number of columns of the spectrum.
+ * @param col_offset Frequency of the first column.
+ * @return Shared pointer to the sampled mask.
+ */
+shared_ptr<const Eigen::ArrayXXd> FrequencyMask::get(const FrequencyMask& mask, int rows, int cols, int col_offset) {
+    MaskKey key(rows, cols, col_offset, mask.keep_from, mask.keep_to, (int) mask.profile,
+                mask.profile == Profile::Butterworth ? mask.order : 0, mask.center_u, mask.center_v);
+    {
+        lock_guard<mutex> lock(mask_cache_mutex);
+        for (auto it = mask_cache.begin(); it != mask_cache.end(); it++) {
+            if (it->first == key) {
+                mask_cache.splice(mask_cache.begin(), mask_cache, it);
+                return it->second;
+            }
+        }
+    }
+    // sample outside the lock, since it runs on the thread pool
+    auto sampled = make_shared<const Eigen::ArrayXXd>(mask.sample(rows, cols, col_offset));
+    lock_guard<mutex> lock(mask_cache_mutex);
+    mask_cache.emplace_front(key, sampled);
+    mask_cache_bytes += sampled->size() * sizeof(double);
+    evictMasks();
+    return sampled;
+}
+
+/*!
+ * @brief Number of masks in the cache.
+ * @return The number of cached masks.
+ */
+size_t FrequencyMask::cacheSize() {
+    lock_guard<mutex> lock(mask_cache_mutex);
+    return mask_cache.size();
+}
+
+/*!
+ * @brief Removes all masks from the cache.
+ * @details Masks still referenced elsewhere stay valid until they are released.
+ */
+void FrequencyMask::clearCache() {
+    lock_guard<mutex> lock(mask_cache_mutex);
+    mask_cache.clear();
+    mask_cache_bytes = 0;
+}
+
+/*!
+ * @brief Number of bytes of the masks in the cache.
+ * @return The size of the cached masks, in bytes.
+ */
+size_t FrequencyMask::cacheBytes() {
+    lock_guard<mutex> lock(mask_cache_mutex);
+    return mask_cache_bytes;
+}
+
+/*!
+ * @brief Sets the maximum size of the cache.
+ * @details The least recently used masks are removed until the cache fits in the new budget. Masks still referenced
+ * elsewhere stay valid until they are released.
+ * @param bytes Number of bytes the cached masks can take. Zero disables the cache.
+ * @return
+ */
+void FrequencyMask::setCacheBudget(size_t bytes) {
+    lock_guard<mutex> lock(mask_cache_mutex);
+    mask_cache_budget = bytes;
+    evictMasks();
+}
@@ -0,0 +1,90 @@
+//
+// Radial frequency-domain masks for the Fourier filters.
+//
+
+#ifndef IMAGEPROCESSING_FREQUENCYMASK_HPP
+#define IMAGEPROCESSING_FREQUENCYMASK_HPP
+
+#include <Eigen/Eigen>
+#include <memory>
+
+using namespace std;
+
+/**
+ * @brief The FrequencyMask class
+ * @details Describes a radial mask that keeps the frequencies whose distance to the zero frequency is in a ring
+ * [keep_from, keep_to): a low pass filter has keep_from = 0, a high pass filter has keep_to = infinity, and a band pass
+ * filter has both. The edges of the ring can be ideal (the mask is 0 or 1) or smooth, with a Butterworth or Gaussian
+ * profile; the band pass mask is then the product of the low and high pass masks, so it is applied in a single pass.
+ * A notch mask (see FrequencyMask::notch) measures the distances from a pair of symmetric frequencies (u, v) and
+ * (-u, -v) instead of the zero frequency, and removes the frequencies close to either of them.
+ * Masks sampled on a spectrum are cached process-wide (see FrequencyMask::get), so that applying the same filter to
+ * several spectra of the same shape only computes the mask once. The cache is bounded by bytes (256 MB by default, see
+ * FrequencyMask::setCacheBudget).
+ */
+class FrequencyMask {
+public:
+    /**
+     * @brief Profile of the edges of the mask.
+     */
+    enum class Profile {
+        Ideal,       ///< Sharp edges: the mask is 1 inside the ring and 0 outside.
+        Butterworth, ///< 1 / (1 + (d / D)^(2n)) for the outer edge D, and its complement for the inner edge.
+        Gaussian     ///< exp(-d^2 / (2 D^2)) for the outer edge D, and its complement for the inner edge.
+    };
+
+private:
+    /**
+     * @var keep_from
+     * Inner radius of the kept ring, in frequency bins.
+     */
+    double keep_from;
+    /**
+     * @var keep_to
+     * Outer radius of the kept ring, in frequency bins.
+     */
+    double keep_to;
+    /**
+     * @var profile
+     * Profile of the edges of the ring.
+     */
+    Profile profile;
+    /**
+     * @var order
+     * Order of the Butterworth profile.
+     */
+    int order;
+    /**
+     * @var center_u
+     * Row frequency of the center of a notch mask (0 for radial masks).
+     */
+    double center_u = 0;
+    /**
+     * @var center_v
+     * Column frequency of the center of a notch mask (0 for radial masks).
+     */
+    double center_v = 0;
+
+public:
+    FrequencyMask(double keep_from, double keep_to, Profile profile = Profile::Ideal, int order = 2);
+    static FrequencyMask notch(double u, double v, double radius, Profile profile = Profile::Ideal, int order = 2);
+
+    [[nodiscard]] double getKeepFrom() const;
+    [[nodiscard]] double getKeepTo() const;
+    [[nodiscard]] Profile getProfile() const;
+    [[nodiscard]] int getOrder() const;
+    [[nodiscard]] bool isNotch() const;
+
+    [[nodiscard]] double gain(double distance) const;
+    [[nodiscard]] double gain(double u, double v) const;
+    [[nodiscard]] Eigen::ArrayXXd sample(int rows, int cols, int col_offset) const;
+
+    static shared_ptr<const Eigen::ArrayXXd> get(const FrequencyMask& mask, int rows, int cols, int col_offset);
+    static size_t cacheSize();
+    static size_t cacheBytes();
+    static void clearCache();
+    static void setCacheBudget(size_t bytes);
+};
+
+
+#endif //IMAGEPROCESSING_FREQUENCYMASK_HPP
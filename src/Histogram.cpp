@@ -139,6 +139,31 @@ void Histogram::setLogScale(bool log_scale) {
     this->log = log_scale;
 }
 
+/*!
+ * @brief Bin of a pixel value
+ * @param value Value of the pixel, in [0, 1]
+ * @return Index of the bin of the value, or -1 if it is outside the range of the histogram
+ */
+int Histogram::binOf(double value) const {
+    if (value < this->min_range || value > this->max_range) {
+        return -1;
+    }
+    int bin = (int) ((value - this->min_range) / (this->max_range - this->min_range) * this->bins);
+    return bin == this->bins ? bin - 1 : bin;
+}
+
+/*!
+ * @brief Histogram with all the bins empty
+ * @return A vector with the lower value of each bin, and a count of 0
+ */
+vector<vector<double>> Histogram::emptyHistogram() const {
+    vector<vector<double>> output;
+    for (int i = 0; i < this->bins; i++) {
+        output.push_back({this->min_range + i * (this->max_range - this->min_range) / this->bins, 0});
+    }
+    return output;
+}
+
 /*!
  * @brief Function to compute the histogram of an image
  * @details This function computes the histogram of an image and returns it as a vector.
@@ -147,26 +172,62 @@ void Histogram::setLogScale(bool log_scale) {
  * @param image Image to compute the histogram
  * @return Histogram of the image
  */
-vector<vector<double>> Histogram::computeHistogram(Image image) const {
-    vector<vector<double>> output;
+vector<vector<double>> Histogram::computeHistogram(const Image& image) const {
     if (image.getChannels() != 1) {
         cout << "CAUTION: Image is not grayscale. Converting to grayscale..." << endl;
-        image = image.reduceChannels();
+        return this->computeHistogram(image.reduceChannels());
     }
-    for (int i = 0; i < this->bins; i++) {
-        output.push_back({this->min_range + i * (this->max_range - this->min_range) / this->bins, 0});
+    vector<vector<double>> output = this->emptyHistogram();
+
+    // the counts do not depend on the order of the pixels, so they are read in the order of the buffer
+    const double* pixels = image.getBuffer();
+    Eigen::Index count = (Eigen::Index) image.getWidth() * image.getHeight();
+    for (Eigen::Index i = 0; i < count; i++) {
+        int bin = this->binOf(pixels[i]);
+        if (bin >= 0) {
+            output[bin][1] += 1;
+        }
     }
+    return output;
+}
 
-    for (int i = 0; i < image.getHeight(); i++) {
-        for (int j = 0; j < image.getWidth(); j++) {
-            double value = image(j, i, 0);
-            if (value >= this->min_range && value <= this->max_range) {
-                int bin = (int) ((value - this->min_range) / (this->max_range - this->min_range) * this->bins);
-                if (bin == this->bins) {
-                    bin--;
+/*!
+ * @brief Function to compute the histogram of an image with compact pixels
+ * @details See computeHistogram on Image objects; the bins are over the pixel values scaled to [0, 1]. The pixels of
+ * single-channel integer images are first counted for each of their possible values, without conversion, and the
+ * counts are then added to the bins. Other images are converted to gray levels in single precision.
+ * @param image Image to compute the histogram
+ * @return Histogram of the image
+ */
+template <typename T>
+vector<vector<double>> Histogram::computeHistogram(const TypedImage<T>& image) const {
+    vector<vector<double>> output = this->emptyHistogram();
+    double white = TypedImage<T>::maxValue();
+    if constexpr (is_integral_v<T>) {
+        if (image.getChannels() == 1) {
+            vector<long> counts((size_t) white + 1, 0);
+            const T* pixels = image.getBuffer();
+            Eigen::Index count = (Eigen::Index) image.getWidth() * image.getHeight();
+            for (Eigen::Index i = 0; i < count; i++) {
+                counts[pixels[i]]++;
+            }
+            for (size_t value = 0; value < counts.size(); value++) {
+                int bin = this->binOf(value / white);
+                if (bin >= 0 && counts[value] > 0) {
+                    output[bin][1] += counts[value];
                 }
-                output[bin][1] += 1;
             }
+            return output;
+        }
+    }
+    if (image.getChannels() != 1) {
+        cout << "CAUTION: Image is not grayscale. Converting to grayscale..." << endl;
+    }
+    Eigen::ArrayXXf levels = image.grayLevels();
+    for (Eigen::Index i = 0; i < levels.size(); i++) {
+        int bin = this->binOf(levels(i) / white);
+        if (bin >= 0) {
+            output[bin][1] += 1;
         }
     }
     return output;
@@ -225,4 +286,8 @@ void Histogram::getHistogram(const Image &image, bool show, const string &output
 
     fflush(gnuplotPipe);
     pclose(gnuplotPipe);
-}
\ No newline at end of file
+}
+
+template vector<vector<double>> Histogram::computeHistogram<uint8_t>(const TypedImage<uint8_t>& image) const;
+template vector<vector<double>> Histogram::computeHistogram<uint16_t>(const TypedImage<uint16_t>& image) const;
+template vector<vector<double>> Histogram::computeHistogram<float>(const TypedImage<float>& image) const;
@@ -6,6 +6,7 @@
 #define IMAGEPROCESSING_HISTOGRAM_HPP
 
 #include "Image.hpp"
+#include "TypedImage.hpp"
 #include <fstream>
 #include <Eigen/Eigen>
 
@@ -41,6 +42,9 @@ private:
      */
     bool log;
 
+    [[nodiscard]] int binOf(double value) const;
+    [[nodiscard]] vector<vector<double>> emptyHistogram() const;
+
 public:
     Histogram();
     explicit Histogram(int bins);
@@ -57,7 +61,9 @@ public:
     void setMaxRange(double max_range);
     void setLogScale(bool log_scale);
 
-    [[nodiscard]] vector<vector<double>> computeHistogram(Image image) const;
+    [[nodiscard]] vector<vector<double>> computeHistogram(const Image& image) const;
+    template <typename T>
+    [[nodiscard]] vector<vector<double>> computeHistogram(const TypedImage<T>& image) const;
 
     void getHistogram(const Image &image, bool show = false, const string &output = "") const;
 
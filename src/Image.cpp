@@ -7,26 +7,146 @@
 #include "Image.hpp"
 #include "location.hpp"
 
+/*!
+ * @brief Computes the strides of an image layout.
+ * @details The value of channel c at (x, y) is at y * row_stride + x * col_stride + c * channel_stride of the buffer
+ * (see ImageLayout).
+ * @param layout How the pixels are laid out in memory.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param channels The number of channels of the image.
+ * @param row_stride Set to the distance between two vertically adjacent pixels of a channel.
+ * @param col_stride Set to the distance between two horizontally adjacent pixels of a channel.
+ * @param channel_stride Set to the distance between two channels of a pixel.
+ * @return
+ */
+void layoutStrides(ImageLayout layout, int width, int height, int channels, Eigen::Index& row_stride,
+                   Eigen::Index& col_stride, Eigen::Index& channel_stride) {
+    Eigen::Index plane = (Eigen::Index) width * height;
+    switch (layout) {
+        case ImageLayout::PlanarColumnMajor:
+            row_stride = 1;
+            col_stride = height;
+            channel_stride = plane;
+            break;
+        case ImageLayout::PlanarRowMajor:
+            row_stride = width;
+            col_stride = 1;
+            channel_stride = plane;
+            break;
+        case ImageLayout::InterleavedColumnMajor:
+            row_stride = channels;
+            col_stride = (Eigen::Index) channels * height;
+            channel_stride = 1;
+            break;
+        case ImageLayout::InterleavedRowMajor:
+            row_stride = (Eigen::Index) channels * width;
+            col_stride = channels;
+            channel_stride = 1;
+            break;
+    }
+}
+
+/*!
+ * @brief Checks that a channel of a cv::Mat can be viewed with elements of type T.
+ * @param mat The matrix to be viewed.
+ * @param channel The channel to be viewed. Must be in [0, mat.channels()).
+ * @return
+ */
+template <typename T>
+static void checkCvChannel(const cv::Mat& mat, int channel) {
+    if (mat.depth() != cv::DataType<T>::depth) {
+        throw std::invalid_argument("The elements of the Mat do not have the type of the view");
+    }
+    if (channel < 0 || channel >= mat.channels()) {
+        throw std::invalid_argument(
+                "Channel selected is not valid, must be between 0 and " + to_string(mat.channels() - 1));
+    }
+}
+
+/*!
+ * @brief View of a channel of a cv::Mat.
+ * @details The view does not copy the channel: it maps the buffer of the Mat, as a height x width array, with the
+ * strides of its interleaved channels and of its rows (which may be padded). It is valid as long as the buffer of the
+ * Mat is alive.
+ * @param mat The matrix to be viewed. Its elements must be of type T (e.g. uchar for CV_8U).
+ * @param channel The channel to be viewed. Must be in [0, mat.channels()).
+ * @return View of the data of the given channel.
+ */
+template <typename T>
+CvChannelView<T> cvChannelView(cv::Mat& mat, int channel) {
+    checkCvChannel<T>(mat, channel);
+    return {mat.ptr<T>(0) + channel, mat.rows, mat.cols,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(mat.channels(), (Eigen::Index) (mat.step[0] / sizeof(T)))};
+}
+
+/*!
+ * @brief Read-only view of a channel of a cv::Mat.
+ * @details See the writable view.
+ * @param mat The matrix to be viewed. Its elements must be of type T (e.g. uchar for CV_8U).
+ * @param channel The channel to be viewed. Must be in [0, mat.channels()).
+ * @return Read-only view of the data of the given channel.
+ */
+template <typename T>
+ConstCvChannelView<T> cvChannelView(const cv::Mat& mat, int channel) {
+    checkCvChannel<T>(mat, channel);
+    return {mat.ptr<T>(0) + channel, mat.rows, mat.cols,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(mat.channels(), (Eigen::Index) (mat.step[0] / sizeof(T)))};
+}
+
+/*!
+ * @brief Copies the pixels of a cv::Mat into an image with the same dimensions, scaling them to [0, 1].
+ * @details When the image is laid out as the Mat (see ImageLayout::InterleavedRowMajor) and the Mat has no padding,
+ * all the values are converted in a single pass over both buffers. Otherwise each channel is converted through the
+ * views of the image and of the Mat.
+ * @param mat The matrix to be copied. Its elements must be of type T.
+ * @param white The value of a white pixel in the Mat.
+ * @param image The image to be written.
+ * @return
+ */
+template <typename T>
+static void copyFromCvMat(const cv::Mat& mat, double white, Image& image) {
+    if (image.getLayout() == ImageLayout::InterleavedRowMajor && mat.isContinuous()) {
+        Eigen::Index count = (Eigen::Index) mat.total() * mat.channels();
+        Eigen::Map<Eigen::ArrayXd>(image.getBuffer(), count) =
+                Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>(mat.ptr<T>(0), count).template cast<double>() /
+                white;
+        return;
+    }
+    for (int c = 0; c < image.getChannels(); c++) {
+        image.getChannelView(c) = cvChannelView<T>(mat, c).template cast<double>() / white;
+    }
+}
+
+/*!
+ * @brief Checks that pixel values are in [0, 1].
+ * @param data The values to be checked.
+ * @return
+ */
+static void checkPixelValues(const Eigen::Ref<const Eigen::ArrayXXd>& data) {
+    if (((data < 0) || (data > 1)).any()) {
+        throw std::invalid_argument("Pixel values must be between 0 and 1");
+    }
+}
+
 /*!
  * @brief Default constructor.
  * @details This constructor creates an empty image with dimensions (50 x 50 x 3).
  * The dimensions choice is arbitrary.
  */
 Image::Image() {
-    this->width = 50;
-    this->height = 50;
-    this->channels = 3;
-    this->data = vector<Eigen::ArrayXXd>(this->channels, Eigen::ArrayXXd::Zero(this->height, this->width));
+    this->allocate(50, 50, 3, ImageLayout::PlanarColumnMajor);
 }
 
 /*!
- * @brief Constructor from filename.
- * @details This constructor creates an image from a given filename. It
- * first tries to open the image assuming 'filename' is the absolute path.
- * If it fails, then it looks in the 'images' folder for it.
- * @param filename The filename of the image to be loaded.
+ * @brief Finds an image file.
+ * @details It first tries to open the file assuming 'filename' is the absolute path. If it fails, then it looks in the
+ * 'images' folder for it.
+ * @param filename The filename of the image.
+ * @param absolute_path Set to true if the file was found at 'filename', false if it was found in the 'images' folder.
+ * @return The path of the file.
  */
-Image::Image(string filename) {
+string findImageFile(string filename, bool& absolute_path) {
     // first try opening the file assuming the user gave the full path
     cout << "Trying to open " << filename << endl;
     ifstream file(filename);
@@ -35,10 +155,11 @@ Image::Image(string filename) {
         filename = loc + "/images/" + filename;
         cout << "File not found.\nTrying to open " << filename << endl;
         need_retry = true;
+        absolute_path = false;
     } else {
         cout << "File " << filename << " found." << endl;
         need_retry = false;
-        this->absolute_path = true;
+        absolute_path = true;
     }
     if (need_retry) {
         ifstream file_retry(filename);
@@ -51,39 +172,51 @@ Image::Image(string filename) {
         file_retry.close();
     }
     file.close();
-    this->path = filename;
-    cv::Mat image = cv::imread(filename);
+    return filename;
+}
+
+/*!
+ * @brief Decodes an image file as it is stored.
+ * @details The file is read with cv::IMREAD_UNCHANGED: the elements keep their depth (e.g. 16 bits for a 16-bit PNG or
+ * TIFF), and the channels their number (1 for grayscale, 4 with an alpha channel), in the BGR(A) order of OpenCV.
+ * @param path The path of the file.
+ * @return The pixels of the file.
+ */
+cv::Mat readImageFile(const string& path) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_UNCHANGED);
     if (image.empty()) {
         throw invalid_argument("Could not open the image.");
     }
-    this->width = image.cols;
-    this->height = image.rows;
-    this->channels = image.channels();
-    this->data = vector<Eigen::ArrayXXd>(this->channels, Eigen::ArrayXXd::Zero(this->height, this->width));
-    for (int i = 0; i < this->height; i++) {
-        for (int j = 0; j < this->width; j++) {
-            for (int k = 0; k < this->channels; k++) {
-                this->data[k](i, j) = image.at<cv::Vec3b>(i, j)[k] / 255.0;
-            }
-        }
-    }
+    return image;
+}
+
+/*!
+ * @brief Constructor from filename.
+ * @details This constructor creates an image from a given filename (see findImageFile). The file is decoded as it is
+ * stored (see readImageFile), and converted in one pass (see Image(const cv::Mat&, ImageLayout)): grayscale files give
+ * 1-channel images, files with an alpha channel 4-channel images, and 16-bit files keep their 16 bits of precision.
+ * @param filename The filename of the image to be loaded.
+ */
+Image::Image(string filename) {
+    this->path = findImageFile(std::move(filename), this->absolute_path);
+    this->fromCvMat(readImageFile(this->path), ImageLayout::PlanarColumnMajor);
 }
 
 /*!
  * @brief Constructor for empty image with given dimensions.
- * @details This constructor creates an empty image with given dimensions.
+ * @details This constructor creates an empty image with given dimensions, whose pixels are laid out as given.
+ * Interleaved layouts keep the channels of a pixel in the same cache line, for operations that combine them; planar
+ * layouts keep each channel contiguous, for operations applied channel by channel (e.g. the convolutions).
  * @param width The width of the image. Must be positive.
  * @param height The height of the image. Must be positive.
  * @param channels The number of channels of the image. Must be positive.
+ * @param layout How the pixels are laid out in memory.
  */
-Image::Image(int width, int height, int channels) {
+Image::Image(int width, int height, int channels, ImageLayout layout) {
     if (width <= 0 || height <= 0 || channels <= 0) {
         throw std::invalid_argument("Width, height and number of channels must be positive");
     }
-    this->width = width;
-    this->height = height;
-    this->channels = channels;
-    this->data = vector<Eigen::ArrayXXd>(this->channels, Eigen::ArrayXXd::Zero(this->height, this->width));
+    this->allocate(width, height, channels, layout);
     this->absolute_path = false;
 }
 
@@ -93,24 +226,18 @@ Image::Image(int width, int height, int channels) {
  * @param channels The number of channels of the image. Must be positive.
  * @param data The array to be replicated over all channels. Value must be between in [0, 1].
  */
-Image::Image(int channels, Eigen::ArrayXXd data) {
+Image::Image(int channels, const Eigen::Ref<const Eigen::ArrayXXd>& data) {
     if (channels <= 0) {
         throw std::invalid_argument("Number of channels must be positive");
     }
     if (data.cols() == 0 || data.rows() == 0) {
         throw std::invalid_argument("Data must not be empty");
     }
-    for (int j = 0; j < data.rows(); j++) {
-        for (int k = 0; k < data.cols(); k++) {
-            if (data(j, k) < 0 || data(j, k) > 1) {
-                throw std::invalid_argument("Pixel values must be between 0 and 1");
-            }
-        }
+    checkPixelValues(data);
+    this->allocate((int) data.cols(), (int) data.rows(), channels, ImageLayout::PlanarColumnMajor);
+    for (int c = 0; c < channels; c++) {
+        this->getChannelView(c) = data;
     }
-    this->width = data.cols();
-    this->height = data.rows();
-    this->channels = channels;
-    this->data = vector<Eigen::ArrayXXd>(this->channels, data);
 }
 
 /*!
@@ -120,7 +247,7 @@ Image::Image(int channels, Eigen::ArrayXXd data) {
  * @param channels The number of channels of the image. Must be positive.
  * @param data The array to be replicated over all channels. Value must be between in [0, 1].
  */
-Image::Image(Eigen::ArrayXXd data) : Image(1, std::move(data)) {}
+Image::Image(const Eigen::Ref<const Eigen::ArrayXXd>& data) : Image(1, data) {}
 
 /*!
  * @brief Constructor to construct an image from a vector of arrays.
@@ -129,7 +256,7 @@ Image::Image(Eigen::ArrayXXd data) : Image(1, std::move(data)) {}
  * across all channels.
  * @param data The vector of arrays to be used as the image data. Value must be between in [0, 1].
  */
-Image::Image(vector<Eigen::ArrayXXd> data) {
+Image::Image(const vector<Eigen::ArrayXXd>& data) {
     if (data.empty()) {
         throw std::invalid_argument("Data must not be empty");
     }
@@ -143,30 +270,102 @@ Image::Image(vector<Eigen::ArrayXXd> data) {
         if (i.cols() != first_width || i.rows() != first_height) {
             throw std::invalid_argument("Data must have the same dimensions along all channels");
         }
-        for (int j = 0; j < i.rows(); j++) {
-            for (int k = 0; k < i.cols(); k++) {
-                if (i(j, k) < 0 || i(j, k) > 1) {
-                    throw std::invalid_argument("Pixel values must be between 0 and 1");
-                }
-            }
-        }
+        checkPixelValues(i);
+    }
+    this->allocate((int) data[0].cols(), (int) data[0].rows(), (int) data.size(), ImageLayout::PlanarColumnMajor);
+    for (int c = 0; c < this->channels; c++) {
+        this->getChannelView(c) = data[c];
     }
-    this->width = data[0].cols();
-    this->height = data[0].rows();
-    this->channels = data.size();
-    this->data = data;
 }
 
 /*!
- * @brief Simple copy constructor.
- * @details This constructor creates a copy of the given image.
- * @param other The image to be copied.
+ * @brief Constructor converting an OpenCV Mat.
+ * @details The channels of the Mat are kept in their order (e.g. BGR for an image read by OpenCV). Integer elements
+ * are scaled from [0, 255] (CV_8U) or [0, 65535] (CV_16U) to [0, 1], and floating point elements (CV_32F, CV_64F) are
+ * kept as they are. The conversion is a single vectorized pass over the Mat (see copyFromCvMat); it is cheapest with
+ * the layout of the Mat, ImageLayout::InterleavedRowMajor.
+ * @param mat The matrix to be converted. Must not be empty.
+ * @param layout How the pixels are laid out in memory.
  */
-Image::Image(const Image &image) {
-    this->width = image.width;
-    this->height = image.height;
-    this->channels = image.channels;
-    this->data = image.data;
+Image::Image(const cv::Mat& mat, ImageLayout layout) {
+    this->fromCvMat(mat, layout);
+}
+
+/*!
+ * @brief Sets the dimensions and layout of the image, and allocates its buffer, filled with zeros.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param channels The number of channels of the image.
+ * @param layout How the pixels are laid out in memory.
+ * @return
+ */
+void Image::allocate(int width, int height, int channels, ImageLayout layout) {
+    this->width = width;
+    this->height = height;
+    this->channels = channels;
+    this->layout = layout;
+    layoutStrides(layout, width, height, channels, this->row_stride, this->col_stride, this->channel_stride);
+    this->buffer = Eigen::ArrayXd::Zero((Eigen::Index) width * height * channels);
+}
+
+/*!
+ * @brief Allocates the image with the dimensions of a cv::Mat, and copies its pixels.
+ * @details See Image(const cv::Mat&, ImageLayout).
+ * @param mat The matrix to be copied. Must not be empty.
+ * @param layout How the pixels are laid out in memory.
+ * @return
+ */
+void Image::fromCvMat(const cv::Mat& mat, ImageLayout layout) {
+    if (mat.empty()) {
+        throw std::invalid_argument("Data must not be empty");
+    }
+    this->allocate(mat.cols, mat.rows, mat.channels(), layout);
+    switch (mat.depth()) {
+        case CV_8U:
+            copyFromCvMat<uchar>(mat, 255, *this);
+            break;
+        case CV_16U:
+            copyFromCvMat<uint16_t>(mat, 65535, *this);
+            break;
+        case CV_32F:
+            copyFromCvMat<float>(mat, 1, *this);
+            break;
+        case CV_64F:
+            copyFromCvMat<double>(mat, 1, *this);
+            break;
+        default:
+            throw std::invalid_argument(
+                    "Elements of the Mat must be 8-bit or 16-bit unsigned integers, or floating point");
+    }
+    if (this->buffer.minCoeff() < 0 || this->buffer.maxCoeff() > 1) {
+        throw std::invalid_argument("Pixel values must be between 0 and 1");
+    }
+}
+
+/*!
+ * @brief Checks that a channel exists.
+ * @param channel The channel to be checked. Must be in [0, channels).
+ * @return
+ */
+void Image::checkChannel(int channel) const {
+    if (channel < 0 || channel >= this->channels) {
+        throw std::invalid_argument(
+                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
+    }
+}
+
+/*!
+ * @brief Checks that a pixel is inside the image.
+ * @param x 'x' coordinate of the pixel. Must be in [0, width).
+ * @param y 'y' coordinate of the pixel. Must be in [0, height).
+ * @return
+ */
+void Image::checkPixel(int x, int y) const {
+    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
+        throw std::invalid_argument(
+                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
+                to_string(this->height - 1) + ")");
+    }
 }
 
 /*!
@@ -196,13 +395,35 @@ int Image::getChannels() const {
     return this->channels;
 }
 
+/*!
+ * @brief Checks whether the image has an alpha channel.
+ * @details The fourth channel of a 4-channel image is its alpha channel (BGRA, as decoded by OpenCV). The filters leave
+ * it unchanged, and the grayscale conversion drops it (see reduceChannels).
+ * @return True if the image has 4 channels.
+ */
+bool Image::hasAlpha() const {
+    return this->channels == 4;
+}
+
+/*!
+ * @brief Number of color channels.
+ * @return The number of channels of the image, without the alpha channel (see hasAlpha).
+ */
+int Image::getColorChannels() const {
+    return this->hasAlpha() ? this->channels - 1 : this->channels;
+}
+
 /*!
  * @brief Simple data getter.
  * @details This getter returns the data of the image.
  * @return The data of the image.
  */
 vector<Eigen::ArrayXXd> Image::getData() const {
-    return this->data;
+    vector<Eigen::ArrayXXd> data;
+    for (int c = 0; c < this->channels; c++) {
+        data.emplace_back(this->getChannelView(c));
+    }
+    return data;
 }
 
 /*!
@@ -212,11 +433,102 @@ vector<Eigen::ArrayXXd> Image::getData() const {
  * @return The data of the image for the given channel.
  */
 Eigen::ArrayXXd Image::getData(int channel) const {
-    if (channel < 0 || channel >= this->channels) {
-        throw std::invalid_argument(
-                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
+    return this->getChannelView(channel);
+}
+
+/*!
+ * @brief View of the data of a single channel.
+ * @details Unlike getData, the view does not copy the channel. It follows the strides of the layout, so its rows and
+ * columns are only contiguous for the planar layouts. It is valid as long as the image is alive and its data is not
+ * replaced.
+ * @param channel The channel to be viewed. Must be in [0, channels).
+ * @return Read-only view of the data of the given channel.
+ */
+ConstChannelView Image::getChannelView(int channel) const {
+    this->checkChannel(channel);
+    return {this->buffer.data() + channel * this->channel_stride, this->height, this->width,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(this->col_stride, this->row_stride)};
+}
+
+/*!
+ * @brief Writable view of the data of a single channel.
+ * @details The view allows to write the pixels of the channel in place (e.g. as the output of a ConvolutionPlan),
+ * without copying it. It is valid as long as the image is alive and its data is not replaced. The values written must
+ * stay in [0, 1].
+ * @param channel The channel to be viewed. Must be in [0, channels).
+ * @return View of the data of the given channel.
+ */
+ChannelView Image::getChannelView(int channel) {
+    this->checkChannel(channel);
+    return {this->buffer.data() + channel * this->channel_stride, this->height, this->width,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(this->col_stride, this->row_stride)};
+}
+
+/*!
+ * @brief View of the data of a single channel, with contiguous columns.
+ * @details As getChannelView, but the rows of a column are adjacent in memory, as in an Eigen::ArrayXXd, so the view
+ * can be passed to the functions taking an Eigen::Ref<const Eigen::ArrayXXd> (e.g. applyConvolution) without a copy.
+ * This requires a row stride of 1, i.e. the ImageLayout::PlanarColumnMajor layout of the images created from arrays.
+ * @param channel The channel to be viewed. Must be in [0, channels).
+ * @return Read-only view of the data of the given channel.
+ */
+ConstColumnMajorView Image::getColumnMajorView(int channel) const {
+    this->checkChannel(channel);
+    if (this->row_stride != 1) {
+        throw std::invalid_argument("The columns of the channels of the image are not contiguous");
     }
-    return this->data[channel];
+    return {this->buffer.data() + channel * this->channel_stride, this->height, this->width,
+            Eigen::OuterStride<>(this->col_stride)};
+}
+
+/*!
+ * @brief Simple layout getter.
+ * @return How the pixels of the image are laid out in memory.
+ */
+ImageLayout Image::getLayout() const {
+    return this->layout;
+}
+
+/*!
+ * @brief Simple row stride getter.
+ * @return The distance in the buffer between two vertically adjacent pixels of a channel.
+ */
+Eigen::Index Image::getRowStride() const {
+    return this->row_stride;
+}
+
+/*!
+ * @brief Simple column stride getter.
+ * @return The distance in the buffer between two horizontally adjacent pixels of a channel.
+ */
+Eigen::Index Image::getColStride() const {
+    return this->col_stride;
+}
+
+/*!
+ * @brief Simple channel stride getter.
+ * @return The distance in the buffer between two channels of a pixel.
+ */
+Eigen::Index Image::getChannelStride() const {
+    return this->channel_stride;
+}
+
+/*!
+ * @brief Buffer getter.
+ * @details The buffer holds width * height * channels values, laid out as given by the layout and the strides.
+ * @return Pointer to the first value of the buffer.
+ */
+const double* Image::getBuffer() const {
+    return this->buffer.data();
+}
+
+/*!
+ * @brief Writable buffer getter.
+ * @details See the read-only getter. The values written must stay in [0, 1].
+ * @return Pointer to the first value of the buffer.
+ */
+double* Image::getBuffer() {
+    return this->buffer.data();
 }
 
 /*!
@@ -227,16 +539,10 @@ Eigen::ArrayXXd Image::getData(int channel) const {
  * @return The N-dimensional pixel at the given coordinates.
  */
 Eigen::ArrayXd Image::getPixel(int x, int y) const {
-    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
-        throw std::invalid_argument(
-                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
-                to_string(this->height - 1) + ")");
-    }
-    Eigen::ArrayXd pixel(this->channels);
-    for (int i = 0; i < this->channels; i++) {
-        pixel[i] = this->data[i](y, x);
-    }
-    return pixel;
+    this->checkPixel(x, y);
+    return Eigen::Map<const Eigen::ArrayXd, 0, Eigen::InnerStride<>>(
+            this->buffer.data() + y * this->row_stride + x * this->col_stride, this->channels,
+            Eigen::InnerStride<>(this->channel_stride));
 }
 
 /*!
@@ -248,16 +554,9 @@ Eigen::ArrayXd Image::getPixel(int x, int y) const {
  * @return The pixel at the given coordinates for the given channel.
  */
 double Image::getPixel(int x, int y, int channel) const {
-    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
-        throw std::invalid_argument(
-                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
-                to_string(this->height - 1) + ")");
-    }
-    if (channel < 0 || channel >= this->channels) {
-        throw std::invalid_argument(
-                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
-    }
-    return this->data[channel](y, x);
+    this->checkPixel(x, y);
+    this->checkChannel(channel);
+    return this->buffer(y * this->row_stride + x * this->col_stride + channel * this->channel_stride);
 }
 
 /*!
@@ -286,7 +585,7 @@ bool Image::usedAbsolutePath() const {
  * @param data The new data to be set.
  * @return
  */
-void Image::setData(vector<Eigen::ArrayXXd> new_data) {
+void Image::setData(const vector<Eigen::ArrayXXd>& new_data) {
     if (new_data.size() != this->channels) {
         throw std::invalid_argument("Number of channels in new data must match number of channels in image");
     }
@@ -294,41 +593,29 @@ void Image::setData(vector<Eigen::ArrayXXd> new_data) {
         if (i.rows() != this->height || i.cols() != this->width) {
             throw std::invalid_argument("Image dimensions do not match data dimensions");
         }
-        for (int j = 0; j < this->height; j++) {
-            for (int k = 0; k < this->width; k++) {
-                if (i(j, k) < 0 || i(j, k) > 1) {
-                    throw std::invalid_argument("Pixel values must be between 0 and 1");
-                }
-            }
-        }
+        checkPixelValues(i);
+    }
+    for (int c = 0; c < this->channels; c++) {
+        this->getChannelView(c) = new_data[c];
     }
-    this->data = new_data;
 }
 
 /*!
  * @brief Single channel data setter
  * @details This setter sets the data of the image to the given array for a single channel. The new data needs to be
- * consistent with the old data (same dimensions, valid channel), and it still needs to be in [0, 1].
+ * consistent with the old data (same dimensions, valid channel), and it still needs to be in [0, 1]. The data is
+ * written into the buffer of the image, and can be any array expression or view (e.g. a channel of another image).
  * @param data The new data to be set.
  * @param channel The channel to be set. Must be in [0, channels).
  * @return
  */
-void Image::setData(int channel, Eigen::ArrayXXd new_data) {
-    if (channel < 0 || channel >= this->channels) {
-        throw std::invalid_argument(
-                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
-    }
+void Image::setData(int channel, const Eigen::Ref<const Eigen::ArrayXXd>& new_data) {
+    this->checkChannel(channel);
     if (new_data.rows() != this->height || new_data.cols() != this->width) {
         throw std::invalid_argument("Image dimensions do not match data dimensions");
     }
-    for (int j = 0; j < this->height; j++) {
-        for (int k = 0; k < this->width; k++) {
-            if (new_data(j, k) < 0 || new_data(j, k) > 1) {
-                throw std::invalid_argument("Pixel values must be between 0 and 1");
-            }
-        }
-    }
-    this->data[channel] = new_data;
+    checkPixelValues(new_data);
+    this->getChannelView(channel) = new_data;
 }
 
 /*!
@@ -340,12 +627,8 @@ void Image::setData(int channel, Eigen::ArrayXXd new_data) {
  * @param pixel The new pixel to be set.
  * @return
  */
-void Image::setPixel(int x, int y, Eigen::ArrayXd pixel) {
-    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
-        throw std::invalid_argument(
-                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
-                to_string(this->height - 1) + ")");
-    }
+void Image::setPixel(int x, int y, const Eigen::ArrayXd& pixel) {
+    this->checkPixel(x, y);
     if (pixel.size() != this->channels) {
         throw std::invalid_argument("Pixel must have the same number of channels as the image");
     }
@@ -355,7 +638,7 @@ void Image::setPixel(int x, int y, Eigen::ArrayXd pixel) {
         }
     }
     for (int i = 0; i < this->channels; i++) {
-        this->data[i](y, x) = pixel[i];
+        this->buffer(y * this->row_stride + x * this->col_stride + i * this->channel_stride) = pixel[i];
     }
 }
 
@@ -370,19 +653,12 @@ void Image::setPixel(int x, int y, Eigen::ArrayXd pixel) {
  * @return
  */
 void Image::setPixel(int x, int y, int channel, double pixel) {
-    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
-        throw std::invalid_argument(
-                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
-                to_string(this->height - 1) + ")");
-    }
-    if (channel < 0 || channel >= this->channels) {
-        throw std::invalid_argument(
-                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
-    }
+    this->checkPixel(x, y);
+    this->checkChannel(channel);
     if (pixel < 0 || pixel > 1) {
         throw std::invalid_argument("Pixel values must be between 0 and 1");
     }
-    this->data[channel](y, x) = pixel;
+    this->buffer(y * this->row_stride + x * this->col_stride + channel * this->channel_stride) = pixel;
 }
 
 /*!
@@ -437,37 +713,69 @@ double Image::operator()(int x, int y, int channel) const {
 /*!
  * @brief Method to convert image to OpenCV Mat.
  * @details This method converts the image to an OpenCV Mat. The image is converted to 8-bit unsigned integer, with
- * values scaled to [0, 255].
+ * values scaled to [0, 255]. The conversion is a single pass over the image: over the whole buffer for the layout of
+ * the Mat (ImageLayout::InterleavedRowMajor), and through the channel views otherwise.
  * @return The image as an OpenCV Mat.
  */
 cv::Mat Image::toCvMat() {
     cv::Mat cv_image(this->height, this->width, CV_8UC(this->channels));
-    for (int i = 0; i < this->height; i++) {
-        for (int j = 0; j < this->width; j++) {
-            for (int k = 0; k < this->channels; k++) {
-                cv_image.at<cv::Vec3b>(i, j)[k] = this->data[k](i, j) * 255;
-            }
-        }
+    if (this->layout == ImageLayout::InterleavedRowMajor) {
+        Eigen::Map<Eigen::Array<uchar, Eigen::Dynamic, 1>>(cv_image.ptr<uchar>(0), this->buffer.size()) =
+                (this->buffer * 255).cast<uchar>();
+        return cv_image;
+    }
+    for (int c = 0; c < this->channels; c++) {
+        cvChannelView<uchar>(cv_image, c) = (this->getChannelView(c) * 255).cast<uchar>();
     }
     return cv_image;
 }
 
+/*!
+ * @brief Method to view the image as an OpenCV Mat, without copying it.
+ * @details The Mat maps the buffer of the image, as CV_64F elements with the channels of each pixel side by side, so
+ * the image must be laid out as ImageLayout::InterleavedRowMajor (see toLayout). Writing to the Mat writes to the
+ * image, and the values written must stay in [0, 1]. The Mat does not own the buffer: it is valid as long as the image
+ * is alive and its data is not replaced.
+ * @return The image as an OpenCV Mat sharing its buffer.
+ */
+cv::Mat Image::asCvMat() {
+    if (this->layout != ImageLayout::InterleavedRowMajor) {
+        throw std::invalid_argument("Only images laid out as InterleavedRowMajor can be viewed as a Mat");
+    }
+    return {this->height, this->width, CV_64FC(this->channels), this->buffer.data()};
+}
+
+/*!
+ * @brief Method to copy the image with another layout.
+ * @details The copy has the same pixels, laid out as given (see ImageLayout).
+ * @param new_layout How the pixels of the copy are laid out in memory.
+ * @return The copy of the image.
+ */
+Image Image::toLayout(ImageLayout new_layout) const {
+    Image image(this->width, this->height, this->channels, new_layout);
+    for (int c = 0; c < this->channels; c++) {
+        image.getChannelView(c) = this->getChannelView(c);
+    }
+    return image;
+}
+
 /*!
  * @brief Method to show image in a window.
  * @details This method shows the image in a window. If the image is grayscale, it is converted to 3 identical channels
- * to be displayed as RGB. If the image has channels other than 1 or 3, an exception is thrown.an
+ * to be displayed as RGB. The fourth channel of a 4-channel image is its alpha channel. If the image has channels other
+ * than 1, 3 or 4, an exception is thrown.
  * @param window_name The name of the window.
  * @return
  */
 void Image::show(const string &window_name) {
     cv::Mat image;
     if (this->channels == 1) {
-        Image expanded_image(3, this->data[0]);
+        Image expanded_image(3, this->getData(0));
         image = expanded_image.toCvMat();
-    } else if (this->channels == 3) {
+    } else if (this->channels == 3 || this->channels == 4) {
         image = this->toCvMat();
     } else {
-        throw std::invalid_argument("Image must have 1 or 3 channels for show to work");
+        throw std::invalid_argument("Image must have 1, 3 or 4 channels for show to work");
     }
     cv::namedWindow(window_name, cv::WINDOW_AUTOSIZE);
     cv::imshow(window_name, image);
@@ -477,18 +785,20 @@ void Image::show(const string &window_name) {
 /*!
  * @brief Method to save an image specifying the filename.
  * @details This method saves the image either using the absolute path or putting in the './output' directory.
+ * Grayscale images are saved with 3 identical channels, and the fourth channel of a 4-channel image is saved as its
+ * alpha channel.
  * @param filename The name of the file.
  * @return
  */
 void Image::save(string filename, bool absolute_path) {
     cv::Mat image;
     if (this->channels == 1) {
-        Image expanded_image(3, this->data[0]);
+        Image expanded_image(3, this->getData(0));
         image = expanded_image.toCvMat();
-    } else if (this->channels == 3) {
+    } else if (this->channels == 3 || this->channels == 4) {
         image = this->toCvMat();
     } else {
-        throw std::invalid_argument("Image must have 1 or 3 channels for show to work");
+        throw std::invalid_argument("Image must have 1, 3 or 4 channels for show to work");
     }
     if (this->absolute_path || absolute_path) {
         cv::imwrite(filename, image);
@@ -510,7 +820,7 @@ bool Image::operator==(const Image &image) const {
         return false;
     }
     for (int i = 0; i < this->channels; i++) {
-        if (!(this->data[i] == image.data[i]).all()) {
+        if (!(this->getChannelView(i) == image.getChannelView(i)).all()) {
             return false;
         }
     }
@@ -532,35 +842,38 @@ bool Image::operator!=(const Image &image) const {
  * @brief Method to get a reduced (i.e. single-channel) version of the image.
  * @details This method returns a reduced version of the image, with only one channel. If the image is already
  * single-channel, it returns a pointer to the same image. If the image has 3 channels, it performs a weighted mean
- * following a visual perception model (i.e. the human eye is more sensitive to green than red or blue). Otherwise,
- * it returns a simple mean of all the channels.
+ * following a visual perception model (i.e. the human eye is more sensitive to green than red or blue), and so it does
+ * with the color channels of a 4-channel image, whose fourth channel is alpha. Otherwise, it returns a simple mean of
+ * all the channels.
  * @return an Image object with only one channel.
  */
-Image Image::reduceChannels() {
+Image Image::reduceChannels() const {
     if (this->channels == 1) {
         return *this;
     }
     Eigen::ArrayXXd new_data = Eigen::ArrayXXd::Zero(this->height, this->width);
-    if (this->channels != 3) {
-        cerr << "Warning: For images with 3 channels, reduction to 1 channels is done by "
+    if (this->channels != 3 && this->channels != 4) {
+        cerr << "Warning: For images with 3 channels (or 4, with alpha), reduction to 1 channels is done by "
                 "perceptual conversion to grayscale. For images with " << this->channels
              << " channels, reduction to 1 channel is done by averaging all channels." << endl;
-        for (int i = 0; i < this->height; i++) {
-            for (int j = 0; j < this->width; j++) {
-                for (int k = 0; k < this->channels; k++) {
-                    new_data(i, j) += this->data[k](i, j);
-                }
-                new_data(i, j) /= this->channels;
-            }
+        for (int k = 0; k < this->channels; k++) {
+            new_data += this->getChannelView(k);
         }
+        new_data /= this->channels;
     } else {
-        for (int i = 0; i < this->height; i++) {
-            for (int j = 0; j < this->width; j++) {
-                // Formula for converting to grayscale from https://en.wikipedia.org/wiki/Grayscale#Converting_color_to_grayscale
-                new_data(i, j) =
-                        0.2126 * this->data[0](i, j) + 0.7152 * this->data[1](i, j) + 0.0722 * this->data[2](i, j);
-            }
-        }
+        // Formula for converting to grayscale from https://en.wikipedia.org/wiki/Grayscale#Converting_color_to_grayscale
+        // (the alpha channel of a 4-channel image is dropped)
+        new_data = 0.2126 * this->getChannelView(0) + 0.7152 * this->getChannelView(1) +
+                   0.0722 * this->getChannelView(2);
     }
     return Image(new_data);
 }
+
+template CvChannelView<uchar> cvChannelView<uchar>(cv::Mat& mat, int channel);
+template CvChannelView<uint16_t> cvChannelView<uint16_t>(cv::Mat& mat, int channel);
+template CvChannelView<float> cvChannelView<float>(cv::Mat& mat, int channel);
+template CvChannelView<double> cvChannelView<double>(cv::Mat& mat, int channel);
+template ConstCvChannelView<uchar> cvChannelView<uchar>(const cv::Mat& mat, int channel);
+template ConstCvChannelView<uint16_t> cvChannelView<uint16_t>(const cv::Mat& mat, int channel);
+template ConstCvChannelView<float> cvChannelView<float>(const cv::Mat& mat, int channel);
+template ConstCvChannelView<double> cvChannelView<double>(const cv::Mat& mat, int channel);
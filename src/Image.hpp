@@ -11,10 +11,59 @@
 
 using namespace std;
 
+/**
+ * @brief How the pixels of an Image are laid out in its buffer.
+ */
+enum class ImageLayout {
+    PlanarColumnMajor,      ///< Channel after channel, each one column-major (as an Eigen::ArrayXXd)
+    PlanarRowMajor,         ///< Channel after channel, each one row-major
+    InterleavedColumnMajor, ///< The channels of each pixel side by side, pixels in column-major order
+    InterleavedRowMajor     ///< The channels of each pixel side by side, pixels in row-major order (as a cv::Mat)
+};
+
+void layoutStrides(ImageLayout layout, int width, int height, int channels, Eigen::Index& row_stride,
+                   Eigen::Index& col_stride, Eigen::Index& channel_stride);
+
+/**
+ * @brief View of a channel of an Image, whatever its layout (see Image::getChannelView).
+ */
+typedef Eigen::Map<Eigen::ArrayXXd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> ChannelView;
+/**
+ * @brief Read-only view of a channel of an Image, whatever its layout (see Image::getChannelView).
+ */
+typedef Eigen::Map<const Eigen::ArrayXXd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> ConstChannelView;
+/**
+ * @brief Read-only view of a channel of an Image whose columns are contiguous (see Image::getColumnMajorView). Unlike a
+ * ConstChannelView, it binds to an Eigen::Ref<const Eigen::ArrayXXd> without a copy.
+ */
+typedef Eigen::Map<const Eigen::ArrayXXd, 0, Eigen::OuterStride<>> ConstColumnMajorView;
+
+/**
+ * @brief View of a channel of a cv::Mat whose elements are of type T (see cvChannelView).
+ */
+template <typename T>
+using CvChannelView = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>, 0,
+        Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+/**
+ * @brief Read-only view of a channel of a cv::Mat whose elements are of type T (see cvChannelView).
+ */
+template <typename T>
+using ConstCvChannelView = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>, 0,
+        Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+string findImageFile(string filename, bool& absolute_path);
+cv::Mat readImageFile(const string& path);
+
+template <typename T>
+CvChannelView<T> cvChannelView(cv::Mat& mat, int channel);
+template <typename T>
+ConstCvChannelView<T> cvChannelView(const cv::Mat& mat, int channel);
+
 /**
  * @brief The Image class
  * @details This class provides basic functionalities for
- * image storage and manipulation.
+ * image storage and manipulation. The pixels of all channels are stored in a single aligned buffer, laid out as
+ * given by an ImageLayout: the value of channel c at (x, y) is at y * row_stride + x * col_stride + c * channel_stride.
  */
 class Image {
 private:
@@ -34,10 +83,30 @@ private:
      */
     int channels;
     /**
-     * @var data
-     * Vector of Eigen matrices containing the image data, where each matrix is a channel.
+     * @var layout
+     * How the pixels are laid out in the buffer.
+     */
+    ImageLayout layout;
+    /**
+     * @var row_stride
+     * Distance in the buffer between two vertically adjacent pixels of a channel.
+     */
+    Eigen::Index row_stride;
+    /**
+     * @var col_stride
+     * Distance in the buffer between two horizontally adjacent pixels of a channel.
+     */
+    Eigen::Index col_stride;
+    /**
+     * @var channel_stride
+     * Distance in the buffer between two channels of a pixel.
      */
-    vector<Eigen::ArrayXXd> data;
+    Eigen::Index channel_stride;
+    /**
+     * @var buffer
+     * Pixels of all the channels, laid out as given by layout.
+     */
+    Eigen::ArrayXd buffer;
     /**
      * @var absolute_path
      * If the image is loaded from a file, this variable states whether the path provided was absolute or relative.
@@ -49,28 +118,49 @@ private:
      */
     string path;
 
+    void allocate(int width, int height, int channels, ImageLayout layout);
+    void fromCvMat(const cv::Mat& mat, ImageLayout layout);
+    void checkChannel(int channel) const;
+    void checkPixel(int x, int y) const;
+
 public:
     Image();
     explicit Image(string filename);
-    Image(int width, int height, int channels);
-    Image(int channels, Eigen::ArrayXXd data);
-    explicit Image(Eigen::ArrayXXd data);
-    explicit Image(vector<Eigen::ArrayXXd> data);
-    Image(const Image& image);
+    Image(int width, int height, int channels, ImageLayout layout = ImageLayout::PlanarColumnMajor);
+    Image(int channels, const Eigen::Ref<const Eigen::ArrayXXd>& data);
+    explicit Image(const Eigen::Ref<const Eigen::ArrayXXd>& data);
+    explicit Image(const vector<Eigen::ArrayXXd>& data);
+    explicit Image(const cv::Mat& mat, ImageLayout layout = ImageLayout::PlanarColumnMajor);
+    Image(const Image& image) = default;
+    Image(Image&& image) = default;
+
+    Image& operator=(const Image& image) = default;
+    Image& operator=(Image&& image) = default;
 
     [[nodiscard]] int getWidth() const;
     [[nodiscard]] int getHeight() const;
     [[nodiscard]] int getChannels() const;
+    [[nodiscard]] bool hasAlpha() const;
+    [[nodiscard]] int getColorChannels() const;
     [[nodiscard]] vector<Eigen::ArrayXXd> getData() const;
     [[nodiscard]] Eigen::ArrayXXd getData(int channel) const;
+    [[nodiscard]] ConstChannelView getChannelView(int channel) const;
+    [[nodiscard]] ChannelView getChannelView(int channel);
+    [[nodiscard]] ConstColumnMajorView getColumnMajorView(int channel) const;
+    [[nodiscard]] ImageLayout getLayout() const;
+    [[nodiscard]] Eigen::Index getRowStride() const;
+    [[nodiscard]] Eigen::Index getColStride() const;
+    [[nodiscard]] Eigen::Index getChannelStride() const;
+    [[nodiscard]] const double* getBuffer() const;
+    [[nodiscard]] double* getBuffer();
     [[nodiscard]] Eigen::ArrayXd getPixel(int x, int y) const;
     [[nodiscard]] double getPixel(int x, int y, int channel) const;
     [[nodiscard]] string getPath() const;
     [[nodiscard]] bool usedAbsolutePath() const;
 
-    void setData(vector<Eigen::ArrayXXd> new_data);
-    void setData(int channel, Eigen::ArrayXXd data);
-    void setPixel(int x, int y, Eigen::ArrayXd pixel);
+    void setData(const vector<Eigen::ArrayXXd>& new_data);
+    void setData(int channel, const Eigen::Ref<const Eigen::ArrayXXd>& data);
+    void setPixel(int x, int y, const Eigen::ArrayXd& pixel);
     void setPixel(int x, int y, int channel, double value);
 
     Eigen::ArrayXXd operator()(int channel) const;
@@ -82,7 +172,9 @@ public:
     virtual void show(const string& window_name = "window");
     void save(string filename, bool absolute_path = false);
     cv::Mat toCvMat();
-    Image reduceChannels();
+    cv::Mat asCvMat();
+    [[nodiscard]] Image toLayout(ImageLayout new_layout) const;
+    [[nodiscard]] Image reduceChannels() const;
 };
 
 
@@ -0,0 +1,444 @@
+//
+// Disk-backed half spectrum, for images whose transform does not fit in memory.
+//
+
+#include "OutOfCoreSpectrum.hpp"
+#include "FFTPlan.hpp"
+#include "ThreadPool.hpp"
+#include "operations.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Tile dimensions are multiples of this, so that tiles are large enough to make file accesses efficient.
+static const int TILE_GRANULARITY = 32;
+
+/*!
+ * @brief Creates an anonymous scratch file of the given size.
+ * @details The file gets a unique name next to the given path, and is unlinked right away: it is removed when its
+ * descriptor is closed (even if the program crashes), and several scratch files can share the same path.
+ * @param path Path from which the name of the file is derived.
+ * @param bytes Size of the file. The file is sparse, so no disk space is used until it is written.
+ * @return File descriptor of the open file.
+ */
+static int openScratchFile(const string& path, size_t bytes) {
+    string name = path + ".XXXXXX";
+    int file = mkstemp(name.data());
+    if (file < 0) {
+        throw runtime_error("Could not create scratch file " + path);
+    }
+    unlink(name.c_str());
+    if (ftruncate(file, (off_t) bytes) != 0) {
+        close(file);
+        throw runtime_error("Could not resize scratch file " + path);
+    }
+    return file;
+}
+
+/*!
+ * @brief Chooses a tile dimension.
+ * @param budget_elements Number of elements the tile dimension can take.
+ * @param size Size of the spectrum along the tile dimension.
+ * @return The largest multiple of TILE_GRANULARITY within the budget, but not above the size of the spectrum.
+ */
+static int tileDimension(size_t budget_elements, int size) {
+    size_t padded_size = (size + TILE_GRANULARITY - 1) / TILE_GRANULARITY * TILE_GRANULARITY;
+    size_t dimension = budget_elements / TILE_GRANULARITY * TILE_GRANULARITY;
+    return (int) max((size_t) TILE_GRANULARITY, min(dimension, padded_size));
+}
+
+/*!
+ * @brief Constructor for OutOfCoreSpectrum
+ * @details Creates the scratch file and chooses the tile sizes. Half of the RAM budget goes to each pass: the row pass
+ * maps one row of tiles, and the column pass gathers one column of tiles in memory. The tiles never get smaller than
+ * 32 x 32, so very small budgets are exceeded.
+ * @param path Path of the scratch file. A unique suffix is appended to it, so existing files are never overwritten.
+ * @param rows Number of rows of the image.
+ * @param cols Number of columns of the image.
+ * @param ram_budget Approximate number of bytes of the spectrum that can be in memory at the same time.
+ */
+OutOfCoreSpectrum::OutOfCoreSpectrum(const string& path, int rows, int cols, size_t ram_budget) {
+    if (rows <= 0 || cols <= 0) {
+        throw invalid_argument("Spectrum dimensions must be positive");
+    }
+    this->path = path;
+    this->rows = rows;
+    this->cols = cols;
+    int half_cols = cols / 2 + 1;
+    size_t pass_budget = ram_budget / 2 / sizeof(complex<double>);
+    this->tile_rows = tileDimension(pass_budget / half_cols, rows);
+    this->tile_cols = tileDimension(pass_budget / rows, half_cols);
+    this->file = openScratchFile(path, (size_t) this->getTileGridRows() * this->getTileGridCols() *
+                                       this->getTileSize() * sizeof(complex<double>));
+}
+
+/*!
+ * @brief Copy constructor for OutOfCoreSpectrum
+ * @details Copies the spectrum into a new scratch file, with the same tiling, one row of tiles at a time. The copy and
+ * the original can then be modified independently.
+ * @param other Spectrum to copy.
+ */
+OutOfCoreSpectrum::OutOfCoreSpectrum(const OutOfCoreSpectrum& other) {
+    this->path = other.path;
+    this->rows = other.rows;
+    this->cols = other.cols;
+    this->tile_rows = other.tile_rows;
+    this->tile_cols = other.tile_cols;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+    this->file = openScratchFile(this->path, (size_t) grid_rows * grid_cols * this->getTileSize() *
+                                             sizeof(complex<double>));
+
+    try {
+        for (int tr = 0; tr < grid_rows; tr++) {
+            size_t first = (size_t) tr * grid_cols;
+            const complex<double>* source = other.mapTiles(other.file, first, grid_cols);
+            complex<double>* destination = this->mapTiles(this->file, first, grid_cols);
+            copy_n(source, grid_cols * this->getTileSize(), destination);
+            this->unmapTiles(destination, first, grid_cols);
+            other.unmapTiles(const_cast<complex<double>*>(source), first, grid_cols);
+        }
+    } catch (...) {
+        close(this->file);
+        throw;
+    }
+}
+
+/*!
+ * @brief Destructor for OutOfCoreSpectrum
+ * @details Closes the scratch file, which removes it since it is already unlinked.
+ */
+OutOfCoreSpectrum::~OutOfCoreSpectrum() {
+    close(this->file);
+}
+
+/*!
+ * @brief Number of rows of tiles.
+ * @return Number of tiles along the rows of the spectrum.
+ */
+int OutOfCoreSpectrum::getTileGridRows() const {
+    return (this->rows + this->tile_rows - 1) / this->tile_rows;
+}
+
+/*!
+ * @brief Number of columns of tiles.
+ * @return Number of tiles along the columns of the half spectrum.
+ */
+int OutOfCoreSpectrum::getTileGridCols() const {
+    return (this->cols / 2 + 1 + this->tile_cols - 1) / this->tile_cols;
+}
+
+/*!
+ * @brief Number of elements of a tile.
+ * @return tile_rows * tile_cols.
+ */
+size_t OutOfCoreSpectrum::getTileSize() const {
+    return (size_t) this->tile_rows * this->tile_cols;
+}
+
+/*!
+ * @brief Maps consecutive tiles of a scratch file in memory.
+ * @param file_descriptor Scratch file (with the same tiling as this spectrum).
+ * @param first_tile Index of the first tile, in row of tiles order.
+ * @param count Number of tiles to map.
+ * @return Pointer to the first element of the first tile. It must be released with unmapTiles.
+ */
+complex<double>* OutOfCoreSpectrum::mapTiles(int file_descriptor, size_t first_tile, size_t count) const {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t offset = first_tile * this->getTileSize() * sizeof(complex<double>);
+    size_t misalignment = offset % page;
+    size_t bytes = count * this->getTileSize() * sizeof(complex<double>) + misalignment;
+    void* region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor,
+                        (off_t) (offset - misalignment));
+    if (region == MAP_FAILED) {
+        throw runtime_error("Could not map scratch file " + this->path);
+    }
+    return (complex<double>*) ((char*) region + misalignment);
+}
+
+/*!
+ * @brief Releases tiles mapped with mapTiles.
+ * @details Modified pages are left to the operating system, which writes them back to the file.
+ * @param tiles Pointer returned by mapTiles.
+ * @param first_tile Index of the first tile, as given to mapTiles.
+ * @param count Number of tiles, as given to mapTiles.
+ * @return
+ */
+void OutOfCoreSpectrum::unmapTiles(complex<double>* tiles, size_t first_tile, size_t count) const {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t misalignment = first_tile * this->getTileSize() * sizeof(complex<double>) % page;
+    munmap((char*) tiles - misalignment, count * this->getTileSize() * sizeof(complex<double>) + misalignment);
+}
+
+/*!
+ * @brief Transforms all columns of a tiled spectrum.
+ * @details Processes one column of tiles at a time: the tiles are gathered in a buffer, the columns of the buffer are
+ * transformed in parallel, and the result is scattered to the destination file.
+ * @param source Scratch file to read.
+ * @param destination Scratch file to write. Can be the same as source.
+ * @param inverse Whether to compute the inverse transform.
+ * @param show_progress Whether to print progress.
+ * @return
+ */
+void OutOfCoreSpectrum::transformColumns(int source, int destination, bool inverse, bool show_progress) const {
+    int half_cols = this->cols / 2 + 1;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+    shared_ptr<const FFTPlan> plan = FFTPlan::get(this->rows, inverse);
+    Eigen::ArrayXXcd buffer(this->rows, this->tile_cols);
+    auto progress = progressPrinter(show_progress, "column tiles");
+
+    for (int tc = 0; tc < grid_cols; tc++) {
+        int width = min(this->tile_cols, half_cols - tc * this->tile_cols);
+        for (int tr = 0; tr < grid_rows; tr++) {
+            int height = min(this->tile_rows, this->rows - tr * this->tile_rows);
+            size_t index = (size_t) tr * grid_cols + tc;
+            complex<double>* tile = this->mapTiles(source, index, 1);
+            for (int c = 0; c < width; c++) {
+                copy_n(tile + (size_t) c * this->tile_rows, height, &buffer(tr * this->tile_rows, c));
+            }
+            this->unmapTiles(tile, index, 1);
+        }
+
+        ThreadPool::global().parallelFor(0, width, [&](int, int c) {
+            centeredTransform(*plan, buffer.col(c).data());
+        });
+
+        for (int tr = 0; tr < grid_rows; tr++) {
+            int height = min(this->tile_rows, this->rows - tr * this->tile_rows);
+            size_t index = (size_t) tr * grid_cols + tc;
+            complex<double>* tile = this->mapTiles(destination, index, 1);
+            for (int c = 0; c < width; c++) {
+                copy_n(&buffer(tr * this->tile_rows, c), height, tile + (size_t) c * this->tile_rows);
+            }
+            this->unmapTiles(tile, index, 1);
+        }
+        if (progress) {
+            progress(tc + 1, grid_cols);
+        }
+    }
+}
+
+/*!
+ * @brief Simple rows getter.
+ * @return Number of rows of the image.
+ */
+int OutOfCoreSpectrum::getRows() const {
+    return this->rows;
+}
+
+/*!
+ * @brief Simple cols getter.
+ * @return Number of columns of the image.
+ */
+int OutOfCoreSpectrum::getCols() const {
+    return this->cols;
+}
+
+/*!
+ * @brief Simple tile rows getter.
+ * @return Number of rows of a tile.
+ */
+int OutOfCoreSpectrum::getTileRows() const {
+    return this->tile_rows;
+}
+
+/*!
+ * @brief Simple tile cols getter.
+ * @return Number of columns of a tile.
+ */
+int OutOfCoreSpectrum::getTileCols() const {
+    return this->tile_cols;
+}
+
+/*!
+ * @brief Simple path getter.
+ * @return Path given to the constructor, from which the name of the scratch file is derived.
+ */
+const string& OutOfCoreSpectrum::getPath() const {
+    return this->path;
+}
+
+/*!
+ * @brief Computes the half spectrum of a real image into the scratch file.
+ * @details The result is the same as rdft2. First, each row of tiles is mapped, and the real rows of the image are
+ * transformed into it two at a time (see realPairTransform). Then the columns are transformed one column of tiles at a
+ * time.
+ * @param input Real image, with the dimensions given to the constructor.
+ * @param show_progress Whether to print progress.
+ * @return
+ */
+void OutOfCoreSpectrum::forward(const Eigen::Ref<const Eigen::ArrayXXd>& input, bool show_progress) {
+    if (input.rows() != this->rows || input.cols() != this->cols) {
+        throw invalid_argument("Input dimensions do not match the spectrum");
+    }
+    int M = this->cols;
+    int half_cols = M / 2 + 1;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+    ThreadPool& pool = ThreadPool::global();
+    shared_ptr<const FFTPlan> plan = FFTPlan::get(M, false);
+    vector<Eigen::ArrayXXd> rows_buffers(pool.getNumThreads(), Eigen::ArrayXXd(M, 2));
+    vector<Eigen::ArrayXXcd> spectra_buffers(pool.getNumThreads(), Eigen::ArrayXXcd(half_cols, 2));
+    vector<Eigen::ArrayXcd> buffers(pool.getNumThreads(), Eigen::ArrayXcd(M));
+    auto progress = progressPrinter(show_progress, "row tiles");
+
+    for (int tr = 0; tr < grid_rows; tr++) {
+        int i0 = tr * this->tile_rows;
+        int height = min(this->tile_rows, this->rows - i0);
+        size_t first = (size_t) tr * grid_cols;
+        complex<double>* band = this->mapTiles(this->file, first, grid_cols);
+
+        pool.parallelFor(0, (height + 1) / 2, [&](int worker, int pair) {
+            int r = 2 * pair;
+            int count = min(2, height - r);
+            Eigen::ArrayXXd& real_rows = rows_buffers[worker];
+            Eigen::ArrayXXcd& spectra = spectra_buffers[worker];
+            for (int q = 0; q < count; q++) {
+                real_rows.col(q) = input.row(i0 + r + q).transpose();
+            }
+            realPairTransform(*plan, real_rows.col(0).data(), count == 2 ? real_rows.col(1).data() : nullptr,
+                              spectra.col(0).data(), count == 2 ? spectra.col(1).data() : nullptr,
+                              buffers[worker].data());
+            for (int q = 0; q < count; q++) {
+                for (int k = 0; k < half_cols; k++) {
+                    band[(k / this->tile_cols) * this->getTileSize() + (size_t) (k % this->tile_cols) * this->tile_rows
+                         + r + q] = spectra(k, q);
+                }
+            }
+        });
+
+        this->unmapTiles(band, first, grid_cols);
+        if (progress) {
+            progress(tr + 1, grid_rows);
+        }
+    }
+
+    this->transformColumns(this->file, this->file, false, show_progress);
+}
+
+/*!
+ * @brief Computes the real image from the half spectrum in the scratch file.
+ * @details The result is the same as irdft2. The columns are transformed into a second, temporary scratch file (so
+ * the spectrum is kept), and the rows are then computed from it one row of tiles at a time.
+ * @param show_progress Whether to print progress.
+ * @return Real image, with the dimensions given to the constructor.
+ */
+Eigen::ArrayXXd OutOfCoreSpectrum::inverse(bool show_progress) const {
+    int M = this->cols;
+    int half_cols = M / 2 + 1;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+    ThreadPool& pool = ThreadPool::global();
+    shared_ptr<const FFTPlan> plan = FFTPlan::get(M, true);
+    vector<Eigen::ArrayXXcd> spectra_buffers(pool.getNumThreads(), Eigen::ArrayXXcd(half_cols, 2));
+    vector<Eigen::ArrayXXd> rows_buffers(pool.getNumThreads(), Eigen::ArrayXXd(M, 2));
+    vector<Eigen::ArrayXcd> buffers(pool.getNumThreads(), Eigen::ArrayXcd(M));
+    Eigen::ArrayXXd output(this->rows, M);
+
+    int temporary = openScratchFile(this->path, (size_t) grid_rows * grid_cols * this->getTileSize() *
+                                                sizeof(complex<double>));
+
+    try {
+        this->transformColumns(this->file, temporary, true, show_progress);
+
+        auto progress = progressPrinter(show_progress, "row tiles");
+        for (int tr = 0; tr < grid_rows; tr++) {
+            int i0 = tr * this->tile_rows;
+            int height = min(this->tile_rows, this->rows - i0);
+            size_t first = (size_t) tr * grid_cols;
+            const complex<double>* band = this->mapTiles(temporary, first, grid_cols);
+
+            pool.parallelFor(0, (height + 1) / 2, [&](int worker, int pair) {
+                int r = 2 * pair;
+                int count = min(2, height - r);
+                Eigen::ArrayXXcd& spectra = spectra_buffers[worker];
+                Eigen::ArrayXXd& real_rows = rows_buffers[worker];
+                for (int q = 0; q < count; q++) {
+                    for (int k = 0; k < half_cols; k++) {
+                        spectra(k, q) = band[(k / this->tile_cols) * this->getTileSize() +
+                                             (size_t) (k % this->tile_cols) * this->tile_rows + r + q];
+                    }
+                }
+                realPairInverseTransform(*plan, spectra.col(0).data(), count == 2 ? spectra.col(1).data() : nullptr,
+                                         real_rows.col(0).data(), count == 2 ? real_rows.col(1).data() : nullptr,
+                                         buffers[worker].data());
+                for (int q = 0; q < count; q++) {
+                    output.row(i0 + r + q) = real_rows.col(q).transpose();
+                }
+            });
+
+            this->unmapTiles(const_cast<complex<double>*>(band), first, grid_cols);
+            if (progress) {
+                progress(tr + 1, grid_rows);
+            }
+        }
+    } catch (...) {
+        close(temporary);
+        throw;
+    }
+    close(temporary);
+    return output;
+}
+
+/*!
+ * @brief Multiplies the spectrum by a radial mask.
+ * @details The mask is evaluated one tile at a time, so it is never sampled on the whole spectrum.
+ * @param mask The mask to apply.
+ * @return
+ */
+void OutOfCoreSpectrum::applyMask(const FrequencyMask& mask) {
+    int half_cols = this->cols / 2 + 1;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+
+    for (int tr = 0; tr < grid_rows; tr++) {
+        int i0 = tr * this->tile_rows;
+        int height = min(this->tile_rows, this->rows - i0);
+        for (int tc = 0; tc < grid_cols; tc++) {
+            int k0 = tc * this->tile_cols;
+            int width = min(this->tile_cols, half_cols - k0);
+            size_t index = (size_t) tr * grid_cols + tc;
+            complex<double>* tile = this->mapTiles(this->file, index, 1);
+            ThreadPool::global().parallelFor(0, width, [&](int, int c) {
+                double v = k0 + c;
+                complex<double>* column = tile + (size_t) c * this->tile_rows;
+                for (int r = 0; r < height; r++) {
+                    double u = i0 + r - this->rows / 2;
+                    column[r] *= mask.gain(u, v);
+                }
+            });
+            this->unmapTiles(tile, index, 1);
+        }
+    }
+}
+
+/*!
+ * @brief Reads the whole half spectrum in memory.
+ * @return Half spectrum, with the same layout as rdft2.
+ */
+Eigen::ArrayXXcd OutOfCoreSpectrum::load() const {
+    int half_cols = this->cols / 2 + 1;
+    int grid_rows = this->getTileGridRows();
+    int grid_cols = this->getTileGridCols();
+    Eigen::ArrayXXcd output(this->rows, half_cols);
+
+    for (int tr = 0; tr < grid_rows; tr++) {
+        int i0 = tr * this->tile_rows;
+        int height = min(this->tile_rows, this->rows - i0);
+        for (int tc = 0; tc < grid_cols; tc++) {
+            int k0 = tc * this->tile_cols;
+            int width = min(this->tile_cols, half_cols - k0);
+            size_t index = (size_t) tr * grid_cols + tc;
+            complex<double>* tile = this->mapTiles(this->file, index, 1);
+            for (int c = 0; c < width; c++) {
+                copy_n(tile + (size_t) c * this->tile_rows, height, &output(i0, k0 + c));
+            }
+            this->unmapTiles(tile, index, 1);
+        }
+    }
+    return output;
+}
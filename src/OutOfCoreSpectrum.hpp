@@ -0,0 +1,86 @@
+//
+// Disk-backed half spectrum, for images whose transform does not fit in memory.
+//
+
+#ifndef IMAGEPROCESSING_OUTOFCORESPECTRUM_HPP
+#define IMAGEPROCESSING_OUTOFCORESPECTRUM_HPP
+
+#include <Eigen/Eigen>
+#include <complex>
+#include <string>
+#include "FrequencyMask.hpp"
+
+using namespace std;
+
+/**
+ * @brief The OutOfCoreSpectrum class
+ * @details Holds the half spectrum of a real image (same layout and centering as rdft2) in a memory-mapped scratch
+ * file, so that only a configurable amount of it is in memory at any time.
+ * The file is split in tiles of tile_rows x tile_cols elements (column-major inside a tile), stored row of tiles after
+ * row of tiles. The 2D transform is computed in the usual two steps, and the tiled layout plays the role of the
+ * transposes of the four-step algorithm: a row of tiles is one contiguous block of the file, and a column of tiles is a
+ * set of contiguous tiles, so both passes only map large contiguous regions. The tile sizes are chosen so that the
+ * buffers of each pass fit in the RAM budget.
+ * The scratch file gets a unique name and is unlinked as soon as it is created, so it never outlives the object.
+ * Copying the object copies the spectrum into a new scratch file.
+ */
+class OutOfCoreSpectrum {
+private:
+    /**
+     * @var path
+     * Path from which the name of the scratch file is derived.
+     */
+    string path;
+    /**
+     * @var file
+     * File descriptor of the scratch file.
+     */
+    int file = -1;
+    /**
+     * @var rows
+     * Number of rows of the image (and of the spectrum).
+     */
+    int rows;
+    /**
+     * @var cols
+     * Number of columns of the image. The spectrum has cols/2 + 1 columns.
+     */
+    int cols;
+    /**
+     * @var tile_rows
+     * Number of rows of a tile.
+     */
+    int tile_rows;
+    /**
+     * @var tile_cols
+     * Number of columns of a tile.
+     */
+    int tile_cols;
+
+    [[nodiscard]] int getTileGridRows() const;
+    [[nodiscard]] int getTileGridCols() const;
+    [[nodiscard]] size_t getTileSize() const;
+    complex<double>* mapTiles(int file_descriptor, size_t first_tile, size_t count) const;
+    void unmapTiles(complex<double>* tiles, size_t first_tile, size_t count) const;
+    void transformColumns(int source, int destination, bool inverse, bool show_progress) const;
+
+public:
+    OutOfCoreSpectrum(const string& path, int rows, int cols, size_t ram_budget);
+    OutOfCoreSpectrum(const OutOfCoreSpectrum& other);
+    OutOfCoreSpectrum& operator=(const OutOfCoreSpectrum&) = delete;
+    ~OutOfCoreSpectrum();
+
+    [[nodiscard]] int getRows() const;
+    [[nodiscard]] int getCols() const;
+    [[nodiscard]] int getTileRows() const;
+    [[nodiscard]] int getTileCols() const;
+    [[nodiscard]] const string& getPath() const;
+
+    void forward(const Eigen::Ref<const Eigen::ArrayXXd>& input, bool show_progress = false);
+    [[nodiscard]] Eigen::ArrayXXd inverse(bool show_progress = false) const;
+    void applyMask(const FrequencyMask& mask);
+    [[nodiscard]] Eigen::ArrayXXcd load() const;
+};
+
+
+#endif //IMAGEPROCESSING_OUTOFCORESPECTRUM_HPP
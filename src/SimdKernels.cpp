@@ -0,0 +1,495 @@
+//
+// Vectorized inner loops of the convolutions, chosen at runtime from the instruction sets of the processor.
+//
+
+#include "SimdKernels.hpp"
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IMAGEPROCESSING_X86
+#include <immintrin.h>
+#endif
+
+// Kernel implementations, for one element type
+template <typename T>
+using WeightedSumKernel = void (*)(const T* const*, const T*, int, T*, int);
+
+/*!
+ * @brief Portable implementation of weightedSum.
+ * @details Also finishes the tails of the vectorized implementations.
+ * @param sources Pointers to the input streams.
+ * @param weights Weight of each stream.
+ * @param count Number of streams.
+ * @param output Output stream.
+ * @param begin First element to compute.
+ * @param length One past the last element to compute.
+ * @return
+ */
+template <typename T>
+static void weightedSumScalar(const T* const* sources, const T* weights, int count, T* output, int begin, int length) {
+    for (int i = begin; i < length; i++) {
+        T sum = 0;
+        for (int t = 0; t < count; t++) {
+            sum += weights[t] * sources[t][i];
+        }
+        output[i] = sum;
+    }
+}
+
+template <typename T>
+static void weightedSumScalar(const T* const* sources, const T* weights, int count, T* output, int length) {
+    weightedSumScalar(sources, weights, count, output, 0, length);
+}
+
+/*!
+ * @brief Portable implementation of weightedSum for a fixed number of streams.
+ * @details The loop over the streams is unrolled, and the weights and stream pointers are kept in local variables.
+ * @param sources Pointers to the input streams.
+ * @param weights Weight of each stream.
+ * @param count Number of streams, equal to Taps.
+ * @param output Output stream.
+ * @param length Number of elements to compute.
+ * @return
+ */
+template <int Taps, typename T>
+static void weightedSumFixedScalar(const T* const* sources, const T* weights, [[maybe_unused]] int count, T* output,
+                                   int length) {
+    assert(count == Taps);
+    T weight[Taps];
+    const T* source[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = weights[t];
+        source[t] = sources[t];
+    }
+    for (int i = 0; i < length; i++) {
+        T sum = 0;
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum += weight[t] * source[t][i];
+        }
+        output[i] = sum;
+    }
+}
+
+#ifdef IMAGEPROCESSING_X86
+
+// Each implementation keeps two vector accumulators per block of output, so that consecutive multiply-adds are
+// independent, and loads each input stream once per block.
+
+__attribute__((target("sse4.1")))
+static void weightedSumSSE4(const double* const* sources, const double* weights, int count, double* output,
+                            int length) {
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+        for (int t = 0; t < count; t++) {
+            __m128d weight = _mm_set1_pd(weights[t]);
+            sum0 = _mm_add_pd(sum0, _mm_mul_pd(weight, _mm_loadu_pd(sources[t] + i)));
+            sum1 = _mm_add_pd(sum1, _mm_mul_pd(weight, _mm_loadu_pd(sources[t] + i + 2)));
+        }
+        _mm_storeu_pd(output + i, sum0);
+        _mm_storeu_pd(output + i + 2, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+__attribute__((target("sse4.1")))
+static void weightedSumSSE4(const float* const* sources, const float* weights, int count, float* output, int length) {
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (int t = 0; t < count; t++) {
+            __m128 weight = _mm_set1_ps(weights[t]);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(weight, _mm_loadu_ps(sources[t] + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(weight, _mm_loadu_ps(sources[t] + i + 4)));
+        }
+        _mm_storeu_ps(output + i, sum0);
+        _mm_storeu_ps(output + i + 4, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+__attribute__((target("avx2,fma")))
+static void weightedSumAVX2(const double* const* sources, const double* weights, int count, double* output,
+                            int length) {
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+        for (int t = 0; t < count; t++) {
+            __m256d weight = _mm256_set1_pd(weights[t]);
+            sum0 = _mm256_fmadd_pd(weight, _mm256_loadu_pd(sources[t] + i), sum0);
+            sum1 = _mm256_fmadd_pd(weight, _mm256_loadu_pd(sources[t] + i + 4), sum1);
+        }
+        _mm256_storeu_pd(output + i, sum0);
+        _mm256_storeu_pd(output + i + 4, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+__attribute__((target("avx2,fma")))
+static void weightedSumAVX2(const float* const* sources, const float* weights, int count, float* output, int length) {
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        for (int t = 0; t < count; t++) {
+            __m256 weight = _mm256_set1_ps(weights[t]);
+            sum0 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(sources[t] + i), sum0);
+            sum1 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(sources[t] + i + 8), sum1);
+        }
+        _mm256_storeu_ps(output + i, sum0);
+        _mm256_storeu_ps(output + i + 8, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+__attribute__((target("avx512f")))
+static void weightedSumAVX512(const double* const* sources, const double* weights, int count, double* output,
+                              int length) {
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m512d sum0 = _mm512_setzero_pd();
+        __m512d sum1 = _mm512_setzero_pd();
+        for (int t = 0; t < count; t++) {
+            __m512d weight = _mm512_set1_pd(weights[t]);
+            sum0 = _mm512_fmadd_pd(weight, _mm512_loadu_pd(sources[t] + i), sum0);
+            sum1 = _mm512_fmadd_pd(weight, _mm512_loadu_pd(sources[t] + i + 8), sum1);
+        }
+        _mm512_storeu_pd(output + i, sum0);
+        _mm512_storeu_pd(output + i + 8, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+__attribute__((target("avx512f")))
+static void weightedSumAVX512(const float* const* sources, const float* weights, int count, float* output,
+                              int length) {
+    int i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m512 sum0 = _mm512_setzero_ps();
+        __m512 sum1 = _mm512_setzero_ps();
+        for (int t = 0; t < count; t++) {
+            __m512 weight = _mm512_set1_ps(weights[t]);
+            sum0 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(sources[t] + i), sum0);
+            sum1 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(sources[t] + i + 16), sum1);
+        }
+        _mm512_storeu_ps(output + i, sum0);
+        _mm512_storeu_ps(output + i + 16, sum1);
+    }
+    weightedSumScalar(sources, weights, count, output, i, length);
+}
+
+// Fixed numbers of streams (the 3, 5 and 7 tap 1D passes, and the 3x3, 5x5 and 7x7 direct kernels): the loop over the
+// streams is unrolled, and the broadcast weights are computed once per call instead of once per block, so that they
+// stay in vector registers (AVX-512 has 32 of them, AVX2 and SSE4 16, beyond which the largest kernels spill a few).
+
+template <int Taps>
+__attribute__((target("sse4.1")))
+static void weightedSumFixedSSE4(const double* const* sources, const double* weights, [[maybe_unused]] int count,
+                                 double* output, int length) {
+    assert(count == Taps);
+    __m128d weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm_set1_pd(weights[t]);
+    }
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm_add_pd(sum0, _mm_mul_pd(weight[t], _mm_loadu_pd(sources[t] + i)));
+            sum1 = _mm_add_pd(sum1, _mm_mul_pd(weight[t], _mm_loadu_pd(sources[t] + i + 2)));
+        }
+        _mm_storeu_pd(output + i, sum0);
+        _mm_storeu_pd(output + i + 2, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+template <int Taps>
+__attribute__((target("sse4.1")))
+static void weightedSumFixedSSE4(const float* const* sources, const float* weights, [[maybe_unused]] int count,
+                                 float* output, int length) {
+    assert(count == Taps);
+    __m128 weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm_set1_ps(weights[t]);
+    }
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(weight[t], _mm_loadu_ps(sources[t] + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(weight[t], _mm_loadu_ps(sources[t] + i + 4)));
+        }
+        _mm_storeu_ps(output + i, sum0);
+        _mm_storeu_ps(output + i + 4, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+template <int Taps>
+__attribute__((target("avx2,fma")))
+static void weightedSumFixedAVX2(const double* const* sources, const double* weights, [[maybe_unused]] int count,
+                                 double* output, int length) {
+    assert(count == Taps);
+    __m256d weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm256_set1_pd(weights[t]);
+    }
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm256_fmadd_pd(weight[t], _mm256_loadu_pd(sources[t] + i), sum0);
+            sum1 = _mm256_fmadd_pd(weight[t], _mm256_loadu_pd(sources[t] + i + 4), sum1);
+        }
+        _mm256_storeu_pd(output + i, sum0);
+        _mm256_storeu_pd(output + i + 4, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+template <int Taps>
+__attribute__((target("avx2,fma")))
+static void weightedSumFixedAVX2(const float* const* sources, const float* weights, [[maybe_unused]] int count,
+                                 float* output, int length) {
+    assert(count == Taps);
+    __m256 weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm256_set1_ps(weights[t]);
+    }
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm256_fmadd_ps(weight[t], _mm256_loadu_ps(sources[t] + i), sum0);
+            sum1 = _mm256_fmadd_ps(weight[t], _mm256_loadu_ps(sources[t] + i + 8), sum1);
+        }
+        _mm256_storeu_ps(output + i, sum0);
+        _mm256_storeu_ps(output + i + 8, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+template <int Taps>
+__attribute__((target("avx512f")))
+static void weightedSumFixedAVX512(const double* const* sources, const double* weights, [[maybe_unused]] int count,
+                                   double* output, int length) {
+    assert(count == Taps);
+    __m512d weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm512_set1_pd(weights[t]);
+    }
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m512d sum0 = _mm512_setzero_pd();
+        __m512d sum1 = _mm512_setzero_pd();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm512_fmadd_pd(weight[t], _mm512_loadu_pd(sources[t] + i), sum0);
+            sum1 = _mm512_fmadd_pd(weight[t], _mm512_loadu_pd(sources[t] + i + 8), sum1);
+        }
+        _mm512_storeu_pd(output + i, sum0);
+        _mm512_storeu_pd(output + i + 8, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+template <int Taps>
+__attribute__((target("avx512f")))
+static void weightedSumFixedAVX512(const float* const* sources, const float* weights, [[maybe_unused]] int count,
+                                   float* output, int length) {
+    assert(count == Taps);
+    __m512 weight[Taps];
+    for (int t = 0; t < Taps; t++) {
+        weight[t] = _mm512_set1_ps(weights[t]);
+    }
+    int i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m512 sum0 = _mm512_setzero_ps();
+        __m512 sum1 = _mm512_setzero_ps();
+#pragma GCC unroll 64
+        for (int t = 0; t < Taps; t++) {
+            sum0 = _mm512_fmadd_ps(weight[t], _mm512_loadu_ps(sources[t] + i), sum0);
+            sum1 = _mm512_fmadd_ps(weight[t], _mm512_loadu_ps(sources[t] + i + 16), sum1);
+        }
+        _mm512_storeu_ps(output + i, sum0);
+        _mm512_storeu_ps(output + i + 16, sum1);
+    }
+    weightedSumScalar(sources, weights, Taps, output, i, length);
+}
+
+#endif
+
+/*!
+ * @brief Finds the fastest instruction set supported by the processor.
+ * @details Uses CPUID (through the compiler builtins), so a single binary runs on any processor of the architecture.
+ * @return The fastest supported level, or SimdLevel::Scalar on other architectures.
+ */
+SimdLevel detectSimdLevel() {
+#ifdef IMAGEPROCESSING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE4;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Level used by the kernels, detected once
+static atomic<SimdLevel>& currentLevel() {
+    static atomic<SimdLevel> level(detectSimdLevel());
+    return level;
+}
+
+/*!
+ * @brief Simple level getter.
+ * @return The instruction set used by the kernels.
+ */
+SimdLevel getSimdLevel() {
+    return currentLevel();
+}
+
+/*!
+ * @brief Chooses the instruction set used by the kernels.
+ * @details The default is the fastest one supported by the processor (see detectSimdLevel). Slower levels can be
+ * selected, e.g. to compare the implementations.
+ * @param level Instruction set. Must be supported by the processor.
+ * @return
+ */
+void setSimdLevel(SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        throw invalid_argument("Instruction set not supported by this processor: " + simdLevelName(level));
+    }
+    currentLevel() = level;
+}
+
+/*!
+ * @brief Name of an instruction set.
+ * @param level Instruction set.
+ * @return Its name.
+ */
+string simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::SSE4:
+            return "SSE4.1";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::AVX512:
+            return "AVX-512";
+    }
+    return "unknown";
+}
+
+/*!
+ * @brief Chooses the implementation of a kernel with a fixed number of streams for the current level.
+ * @return Pointer to the implementation.
+ */
+template <typename T, int Taps>
+static WeightedSumKernel<T> weightedSumFixedKernel() {
+#ifdef IMAGEPROCESSING_X86
+    switch (getSimdLevel()) {
+        case SimdLevel::AVX512:
+            return weightedSumFixedAVX512<Taps>;
+        case SimdLevel::AVX2:
+            return weightedSumFixedAVX2<Taps>;
+        case SimdLevel::SSE4:
+            return weightedSumFixedSSE4<Taps>;
+        default:
+            break;
+    }
+#endif
+    return weightedSumFixedScalar<Taps, T>;
+}
+
+/*!
+ * @brief Chooses the implementation of a kernel for the current level.
+ * @details The numbers of streams of the 3, 5 and 7 tap kernels, in one (3, 5, 7) and two (9, 25, 49) dimensions, have
+ * a specialized implementation.
+ * @param count Number of streams.
+ * @return Pointer to the implementation.
+ */
+template <typename T>
+static WeightedSumKernel<T> weightedSumKernel(int count) {
+    switch (count) {
+        case 3:
+            return weightedSumFixedKernel<T, 3>();
+        case 5:
+            return weightedSumFixedKernel<T, 5>();
+        case 7:
+            return weightedSumFixedKernel<T, 7>();
+        case 9:
+            return weightedSumFixedKernel<T, 9>();
+        case 25:
+            return weightedSumFixedKernel<T, 25>();
+        case 49:
+            return weightedSumFixedKernel<T, 49>();
+        default:
+            break;
+    }
+#ifdef IMAGEPROCESSING_X86
+    switch (getSimdLevel()) {
+        case SimdLevel::AVX512:
+            return weightedSumAVX512;
+        case SimdLevel::AVX2:
+            return weightedSumAVX2;
+        case SimdLevel::SSE4:
+            return weightedSumSSE4;
+        default:
+            break;
+    }
+#endif
+    return weightedSumScalar<T>;
+}
+
+/*!
+ * @brief Weighted sum of several streams: output[i] = sum of weights[t] * sources[t][i].
+ * @details The inner loop of the convolutions: the streams are input columns (horizontal pass and direct kernels) or
+ * shifted segments of the same column (vertical pass), so each output column is computed with a single pass over its
+ * elements, keeping the sums in vector registers across all the taps. The kernels of size 3, 5 and 7 have unrolled
+ * implementations, chosen from the number of streams.
+ * @param sources Pointers to the input streams, with at least length elements each.
+ * @param weights Weight of each stream.
+ * @param count Number of streams.
+ * @param output Output stream, with at least length elements. Must not overlap the inputs.
+ * @param length Number of elements to compute.
+ * @return
+ */
+void weightedSum(const double* const* sources, const double* weights, int count, double* output, int length) {
+    weightedSumKernel<double>(count)(sources, weights, count, output, length);
+}
+
+/*!
+ * @brief Weighted sum of several streams, in single precision.
+ * @details See weightedSum for doubles. Vectors hold twice as many floats.
+ * @param sources Pointers to the input streams, with at least length elements each.
+ * @param weights Weight of each stream.
+ * @param count Number of streams.
+ * @param output Output stream, with at least length elements. Must not overlap the inputs.
+ * @param length Number of elements to compute.
+ * @return
+ */
+void weightedSum(const float* const* sources, const float* weights, int count, float* output, int length) {
+    weightedSumKernel<float>(count)(sources, weights, count, output, length);
+}
@@ -0,0 +1,30 @@
+//
+// Vectorized inner loops of the convolutions, chosen at runtime from the instruction sets of the processor.
+//
+
+#ifndef IMAGEPROCESSING_SIMDKERNELS_HPP
+#define IMAGEPROCESSING_SIMDKERNELS_HPP
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Instruction sets of the vectorized kernels, from the slowest to the fastest.
+ */
+enum class SimdLevel {
+    Scalar, ///< Plain C++, for any processor.
+    SSE4,   ///< 128-bit vectors (SSE4.1).
+    AVX2,   ///< 256-bit vectors, with fused multiply-adds (AVX2 and FMA).
+    AVX512  ///< 512-bit vectors (AVX-512F).
+};
+
+SimdLevel detectSimdLevel();
+SimdLevel getSimdLevel();
+void setSimdLevel(SimdLevel level);
+string simdLevelName(SimdLevel level);
+
+void weightedSum(const double* const* sources, const double* weights, int count, double* output, int length);
+void weightedSum(const float* const* sources, const float* weights, int count, float* output, int length);
+
+#endif //IMAGEPROCESSING_SIMDKERNELS_HPP
@@ -0,0 +1,244 @@
+//
+// Binary, memory-mappable storage for Fourier spectra.
+//
+
+#include "SpectrumFile.hpp"
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char SPECTRUM_MAGIC[8] = {'I', 'P', 'S', 'P', 'E', 'C', 'T', 'R'};
+static const uint32_t SPECTRUM_VERSION = 1;
+static const uint32_t SPECTRUM_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(SpectrumFile::Header) == 64, "The spectrum file header must be 64 bytes");
+
+/*!
+ * @brief Constructor for SpectrumFile
+ * @details Maps a spectrum file in memory, privately, and checks its header.
+ * @param path Path of the file.
+ */
+SpectrumFile::SpectrumFile(const string& path) {
+    this->path = path;
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw runtime_error("Could not open spectrum file " + path);
+    }
+    struct stat status{};
+    if (fstat(file, &status) != 0 || (size_t) status.st_size < sizeof(Header)) {
+        close(file);
+        throw runtime_error("Invalid spectrum file " + path);
+    }
+    this->region_size = status.st_size;
+    // private mapping: pages are copied on write, so the spectra can be filtered in place without changing the file
+    void* region = mmap(nullptr, this->region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (region == MAP_FAILED) {
+        throw runtime_error("Could not map spectrum file " + path);
+    }
+    this->region = (char*) region;
+    memcpy(&this->header, this->region, sizeof(Header));
+
+    const Header& h = this->header;
+    string error;
+    if (memcmp(h.magic, SPECTRUM_MAGIC, sizeof(SPECTRUM_MAGIC)) != 0) {
+        error = "not a spectrum file";
+    } else if (h.version != SPECTRUM_VERSION) {
+        error = "unsupported version";
+    } else if (h.byte_order != SPECTRUM_BYTE_ORDER) {
+        error = "unsupported byte order";
+    } else if (h.precision != Precision::Double && h.precision != Precision::Float) {
+        error = "unsupported precision";
+    } else if (h.centering != Centering::Centered) {
+        error = "unsupported centering convention";
+    } else if (h.channels == 0 || h.channels > INT_MAX || h.rows == 0 || h.rows > INT_MAX || h.cols == 0 ||
+               h.cols > INT_MAX) {
+        error = "invalid dimensions";
+    } else if (h.stored_cols != (h.full ? h.cols : h.cols / 2 + 1)) {
+        error = "inconsistent dimensions";
+    } else {
+        // the dimensions are bounded, so a spectrum fits in 64 bits, but all channels may not: the size is divided
+        size_t element_size = 2 * (size_t) h.precision;
+        size_t elements = (this->region_size - sizeof(Header)) / element_size;
+        if ((this->region_size - sizeof(Header)) % element_size != 0 || elements % h.channels != 0 ||
+            elements / h.channels != h.rows * h.stored_cols) {
+            error = "unexpected file size";
+        }
+    }
+    if (!error.empty()) {
+        munmap(this->region, this->region_size);
+        throw runtime_error("Invalid spectrum file " + path + ": " + error);
+    }
+}
+
+/*!
+ * @brief Destructor for SpectrumFile
+ * @details Unmaps the file. Views returned by map become invalid.
+ */
+SpectrumFile::~SpectrumFile() {
+    munmap(this->region, this->region_size);
+}
+
+/*!
+ * @brief Builds the header of a spectrum file.
+ * @param rows Number of rows of the image.
+ * @param cols Number of columns of the image.
+ * @param channels Number of spectra.
+ * @param full Whether the full spectra are stored, instead of the half spectra of a real image.
+ * @param precision Precision of the stored values.
+ * @return The header.
+ */
+SpectrumFile::Header SpectrumFile::makeHeader(int rows, int cols, int channels, bool full, Precision precision) {
+    Header header{};
+    memcpy(header.magic, SPECTRUM_MAGIC, sizeof(SPECTRUM_MAGIC));
+    header.version = SPECTRUM_VERSION;
+    header.byte_order = SPECTRUM_BYTE_ORDER;
+    header.precision = precision;
+    header.centering = Centering::Centered;
+    header.full = full;
+    header.channels = channels;
+    header.rows = rows;
+    header.cols = cols;
+    header.stored_cols = full ? cols : cols / 2 + 1;
+    return header;
+}
+
+/*!
+ * @brief Creates a spectrum file and writes its header.
+ * @details The spectra must then be written with append, in order.
+ * @param path Path of the file. It is overwritten if it exists.
+ * @param header Header of the file (see makeHeader).
+ * @return Stream to which the spectra are appended.
+ */
+ofstream SpectrumFile::create(const string& path, const Header& header) {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file) {
+        throw runtime_error("Could not create spectrum file " + path);
+    }
+    file.write((const char*) &header, sizeof(Header));
+    return file;
+}
+
+/*!
+ * @brief Appends one spectrum to a file created with create.
+ * @param file Stream returned by create.
+ * @param spectrum Spectrum to write, with the dimensions given in the header.
+ * @param precision Precision given in the header.
+ * @return
+ */
+void SpectrumFile::append(ofstream& file, const Eigen::Ref<const Eigen::ArrayXXcd>& spectrum, Precision precision) {
+    if (precision == Precision::Double) {
+        file.write((const char*) spectrum.data(), (streamsize) (spectrum.size() * sizeof(complex<double>)));
+    } else {
+        // convert one column at a time, to keep the buffer small
+        Eigen::ArrayXcf column(spectrum.rows());
+        for (Eigen::Index j = 0; j < spectrum.cols(); j++) {
+            column = spectrum.col(j).cast<complex<float>>();
+            file.write((const char*) column.data(), (streamsize) (column.size() * sizeof(complex<float>)));
+        }
+    }
+    if (!file) {
+        throw runtime_error("Could not write spectrum file");
+    }
+}
+
+/*!
+ * @brief Start of the data of a channel in the mapped file.
+ * @param channel Index of the channel.
+ * @return Pointer to the first value of the channel.
+ */
+char* SpectrumFile::channelData(int channel) const {
+    if (channel < 0 || channel >= this->getChannels()) {
+        throw invalid_argument("Invalid spectrum channel.");
+    }
+    size_t channel_size = this->header.rows * this->header.stored_cols * 2 * (size_t) this->header.precision;
+    return this->region + sizeof(Header) + channel * channel_size;
+}
+
+/*!
+ * @brief Simple header getter.
+ * @return Header of the file.
+ */
+const SpectrumFile::Header& SpectrumFile::getHeader() const {
+    return this->header;
+}
+
+/*!
+ * @brief Simple rows getter.
+ * @return Number of rows of the image.
+ */
+int SpectrumFile::getRows() const {
+    return (int) this->header.rows;
+}
+
+/*!
+ * @brief Simple cols getter.
+ * @return Number of columns of the image.
+ */
+int SpectrumFile::getCols() const {
+    return (int) this->header.cols;
+}
+
+/*!
+ * @brief Simple stored cols getter.
+ * @return Number of columns of each stored spectrum.
+ */
+int SpectrumFile::getStoredCols() const {
+    return (int) this->header.stored_cols;
+}
+
+/*!
+ * @brief Simple channels getter.
+ * @return Number of stored spectra.
+ */
+int SpectrumFile::getChannels() const {
+    return (int) this->header.channels;
+}
+
+/*!
+ * @brief Checks whether full spectra are stored.
+ * @return True for full spectra, false for half spectra.
+ */
+bool SpectrumFile::isFull() const {
+    return this->header.full != 0;
+}
+
+/*!
+ * @brief Simple precision getter.
+ * @return Precision of the stored values.
+ */
+SpectrumFile::Precision SpectrumFile::getPrecision() const {
+    return this->header.precision;
+}
+
+/*!
+ * @brief Views a stored spectrum in place.
+ * @details No data is read or copied: pages are loaded when accessed, and copied only when modified. Only double
+ * precision spectra can be mapped (see read for the others). The view is valid as long as this object.
+ * @param channel Index of the channel.
+ * @return Writable view of the spectrum.
+ */
+Eigen::Map<Eigen::ArrayXXcd> SpectrumFile::map(int channel) const {
+    if (this->header.precision != Precision::Double) {
+        throw runtime_error("Only double precision spectra can be mapped.");
+    }
+    return {(complex<double>*) this->channelData(channel), this->getRows(), this->getStoredCols()};
+}
+
+/*!
+ * @brief Reads a stored spectrum.
+ * @details Copies the spectrum, converting it to double precision if needed.
+ * @param channel Index of the channel.
+ * @return The spectrum.
+ */
+Eigen::ArrayXXcd SpectrumFile::read(int channel) const {
+    if (this->header.precision == Precision::Double) {
+        return this->map(channel);
+    }
+    return Eigen::Map<const Eigen::ArrayXXcf>((const complex<float>*) this->channelData(channel), this->getRows(),
+                                              this->getStoredCols()).cast<complex<double>>();
+}
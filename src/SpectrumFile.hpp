@@ -0,0 +1,108 @@
+//
+// Binary, memory-mappable storage for Fourier spectra.
+//
+
+#ifndef IMAGEPROCESSING_SPECTRUMFILE_HPP
+#define IMAGEPROCESSING_SPECTRUMFILE_HPP
+
+#include <Eigen/Eigen>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief The SpectrumFile class
+ * @details Reads and writes the spectra of a FourierImage in a compact binary format that can be memory-mapped.
+ * A file starts with a 64-byte header (see SpectrumFile::Header), followed by the spectrum of each channel, one after
+ * the other, in column-major order (the order used by Eigen), as interleaved (real, imaginary) pairs of doubles or
+ * floats in native byte order. The header records the dimensions, the precision and the centering convention, so that
+ * a file written with an incompatible convention is rejected instead of being misread.
+ * Opening a file maps it privately (copy-on-write): double precision spectra can be used in place, without being read
+ * or copied, and modifying them never changes the file.
+ */
+class SpectrumFile {
+public:
+    /**
+     * @brief Precision of the stored values.
+     */
+    enum class Precision : uint32_t {
+        Double = 8, ///< complex<double>, can be mapped without conversion.
+        Float = 4   ///< complex<float>, half the size, converted to double when read.
+    };
+
+    /**
+     * @brief Position of the zero frequency in the stored spectra.
+     */
+    enum class Centering : uint32_t {
+        /// Row i is the frequency i - rows/2. Column j is the frequency j for half spectra, and j - cols/2 for full
+        /// spectra. This is the convention of dft2 and rdft2.
+        Centered = 1
+    };
+
+    /**
+     * @brief Header of a spectrum file, 64 bytes on disk.
+     */
+    struct Header {
+        char magic[8];         ///< "IPSPECTR".
+        uint32_t version;      ///< Format version, currently 1.
+        uint32_t byte_order;   ///< 0x01020304 written in native byte order, to detect foreign files.
+        Precision precision;   ///< Size of each real or imaginary value.
+        Centering centering;   ///< Position of the zero frequency.
+        uint32_t full;         ///< 1 if the full spectrum is stored, 0 for the half spectrum of a real image.
+        uint32_t channels;     ///< Number of stored spectra.
+        uint64_t rows;         ///< Number of rows of the image (and of each spectrum).
+        uint64_t cols;         ///< Number of columns of the image.
+        uint64_t stored_cols;  ///< Number of columns of each stored spectrum (cols/2 + 1 for half spectra).
+        uint64_t reserved;     ///< Padding, zero.
+    };
+
+private:
+    /**
+     * @var path
+     * Path of the mapped file.
+     */
+    string path;
+    /**
+     * @var header
+     * Header of the mapped file.
+     */
+    Header header{};
+    /**
+     * @var region
+     * Start of the mapped file.
+     */
+    char* region = nullptr;
+    /**
+     * @var region_size
+     * Size of the mapped file, in bytes.
+     */
+    size_t region_size = 0;
+
+    [[nodiscard]] char* channelData(int channel) const;
+
+public:
+    explicit SpectrumFile(const string& path);
+    SpectrumFile(const SpectrumFile&) = delete;
+    SpectrumFile& operator=(const SpectrumFile&) = delete;
+    ~SpectrumFile();
+
+    static Header makeHeader(int rows, int cols, int channels, bool full, Precision precision);
+    static ofstream create(const string& path, const Header& header);
+    static void append(ofstream& file, const Eigen::Ref<const Eigen::ArrayXXcd>& spectrum, Precision precision);
+
+    [[nodiscard]] const Header& getHeader() const;
+    [[nodiscard]] int getRows() const;
+    [[nodiscard]] int getCols() const;
+    [[nodiscard]] int getStoredCols() const;
+    [[nodiscard]] int getChannels() const;
+    [[nodiscard]] bool isFull() const;
+    [[nodiscard]] Precision getPrecision() const;
+
+    [[nodiscard]] Eigen::Map<Eigen::ArrayXXcd> map(int channel) const;
+    [[nodiscard]] Eigen::ArrayXXcd read(int channel) const;
+};
+
+
+#endif //IMAGEPROCESSING_SPECTRUMFILE_HPP
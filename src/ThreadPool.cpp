@@ -0,0 +1,234 @@
+//
+// Thread pool shared by the parallel image operations.
+//
+
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Process-wide pool, created on first use.
+static unique_ptr<ThreadPool> global_pool;
+static mutex global_pool_mutex;
+static int global_pool_threads = 0;
+
+// Set on the worker threads, so that nested parallel loops run serially instead of waiting for busy workers.
+static thread_local bool inside_pool = false;
+
+// How often the thread waiting for a parallel loop samples its progress.
+static const chrono::milliseconds PROGRESS_INTERVAL(200);
+
+/**
+ * @brief State of a parallel loop, shared by the workers running it and owned by the thread waiting for it.
+ */
+struct LoopState {
+    const function<void(int, int)>* body; ///< Body of the loop.
+    int end;                               ///< One past the last index of the loop.
+    int chunk;                             ///< Number of iterations taken at once by a worker.
+    atomic<int> next;                      ///< First iteration of the next chunk.
+    atomic<int> done;                      ///< Number of iterations done.
+    atomic<bool> failed;                   ///< Set when an iteration throws.
+    exception_ptr error;                   ///< First exception thrown by an iteration.
+    int running;                           ///< Number of workers still running the loop.
+    mutex finished_mutex;                  ///< Mutex protecting error and running.
+    condition_variable finished;           ///< Notified when the last worker is done.
+
+    /*!
+     * @brief Runs chunks of iterations until the loop is done, on the given worker.
+     * @param worker Index of the worker.
+     * @return
+     */
+    void run(int worker) {
+        try {
+            int start;
+            while (!failed && (start = next.fetch_add(chunk)) < end) {
+                int stop = min(start + chunk, end);
+                for (int i = start; i < stop; i++) {
+                    (*body)(worker, i);
+                }
+                done += stop - start;
+            }
+        } catch (...) {
+            lock_guard<mutex> error_lock(finished_mutex);
+            if (!failed.exchange(true)) {
+                error = current_exception();
+            }
+        }
+        lock_guard<mutex> finished_lock(finished_mutex);
+        if (--running == 0) {
+            finished.notify_one();
+        }
+    }
+};
+
+/*!
+ * @brief Constructor for ThreadPool
+ * @details Starts the worker threads.
+ * @param num_threads Number of worker threads. If it is not positive, the number of hardware threads is used.
+ */
+ThreadPool::ThreadPool(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = (int) max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < num_threads; i++) {
+        this->workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+/*!
+ * @brief Destructor for ThreadPool
+ * @details Waits for the queued tasks to finish and joins the worker threads.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(this->tasks_mutex);
+        this->stopping = true;
+    }
+    this->tasks_available.notify_all();
+    for (auto &worker: this->workers) {
+        worker.join();
+    }
+}
+
+/*!
+ * @brief Main loop of a worker thread.
+ * @details Runs queued tasks until the pool is stopped and the queue is empty.
+ */
+void ThreadPool::workerLoop() {
+    inside_pool = true;
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(this->tasks_mutex);
+            this->tasks_available.wait(lock, [this]() { return this->stopping || this->queued_tasks > 0; });
+            if (this->queued_tasks == 0) {
+                return;
+            }
+            task = std::move(this->tasks[this->first_task]);
+            this->first_task = (this->first_task + 1) % this->tasks.size();
+            this->queued_tasks--;
+        }
+        task();
+    }
+}
+
+/*!
+ * @brief Adds a task at the end of the queue.
+ * @details The circular buffer of tasks doubles in size when it is full. Must be called with tasks_mutex locked.
+ * @param task Task to run on a worker.
+ * @return
+ */
+void ThreadPool::pushTask(function<void()> task) {
+    if (this->queued_tasks == this->tasks.size()) {
+        vector<function<void()>> grown(max((size_t) 8, 2 * this->tasks.size()));
+        for (size_t i = 0; i < this->queued_tasks; i++) {
+            grown[i] = std::move(this->tasks[(this->first_task + i) % this->tasks.size()]);
+        }
+        this->tasks.swap(grown);
+        this->first_task = 0;
+    }
+    this->tasks[(this->first_task + this->queued_tasks) % this->tasks.size()] = std::move(task);
+    this->queued_tasks++;
+}
+
+/*!
+ * @brief Simple getter for the number of worker threads.
+ * @return The number of worker threads.
+ */
+int ThreadPool::getNumThreads() const {
+    return (int) this->workers.size();
+}
+
+/*!
+ * @brief Runs the iterations of a loop in parallel.
+ * @details Calls body(worker, i) for every i in [begin, end), where worker is in [0, getNumThreads()) and identifies
+ * the worker running the iteration (two iterations with the same worker index never run at the same time). The call
+ * returns when all iterations are done. If an iteration throws, the remaining chunks are skipped and the first
+ * exception is rethrown here.
+ * Progress is counted with an atomic counter, which the calling thread samples at a low frequency to call
+ * progress(done, total) (and once more at the end), so the workers are never slowed down by the reporting.
+ * When called from inside a worker (nested loops), the iterations run serially on the calling thread.
+ * Once the pool has run a loop, the next ones do not allocate memory (body should be small enough for std::function
+ * to hold it without allocating, e.g. a lambda capturing up to two pointers).
+ * @param begin First index of the loop.
+ * @param end One past the last index of the loop.
+ * @param body Function called for each iteration.
+ * @param progress Optional function called with the number of iterations done and the total number of iterations.
+ * @return
+ */
+void ThreadPool::parallelFor(int begin, int end, const function<void(int, int)>& body,
+                             const function<void(int, int)>& progress) {
+    int total = end - begin;
+    if (total <= 0) {
+        return;
+    }
+    int num_workers = min(this->getNumThreads(), total);
+    if (num_workers <= 1 || inside_pool) {
+        for (int i = begin; i < end; i++) {
+            body(0, i);
+        }
+        if (progress) {
+            progress(total, total);
+        }
+        return;
+    }
+
+    // several chunks per worker, so that workers finishing early can take work from slower ones
+    LoopState state{};
+    state.body = &body;
+    state.end = end;
+    state.chunk = max(1, total / (num_workers * 8));
+    state.next = begin;
+    state.running = num_workers;
+
+    {
+        lock_guard<mutex> lock(this->tasks_mutex);
+        for (int worker = 0; worker < num_workers; worker++) {
+            // the task only holds a pointer and an index, which std::function stores without allocating memory
+            LoopState* loop = &state;
+            this->pushTask([loop, worker]() { loop->run(worker); });
+        }
+    }
+    this->tasks_available.notify_all();
+
+    unique_lock<mutex> lock(state.finished_mutex);
+    while (!state.finished.wait_for(lock, PROGRESS_INTERVAL, [&state]() { return state.running == 0; })) {
+        if (progress) {
+            lock.unlock();
+            progress(state.done, total);
+            lock.lock();
+        }
+    }
+    if (state.error) {
+        rethrow_exception(state.error);
+    }
+    if (progress) {
+        progress(total, total);
+    }
+}
+
+/*!
+ * @brief Gets the process-wide thread pool.
+ * @details The pool is created on first use, with the number of threads set by setGlobalThreads (all hardware threads
+ * by default).
+ * @return Reference to the global pool.
+ */
+ThreadPool& ThreadPool::global() {
+    lock_guard<mutex> lock(global_pool_mutex);
+    if (!global_pool) {
+        global_pool = make_unique<ThreadPool>(global_pool_threads);
+    }
+    return *global_pool;
+}
+
+/*!
+ * @brief Sets the number of threads of the process-wide thread pool.
+ * @details The global pool is recreated with the new size. It must not be called while the global pool is running a
+ * parallel loop.
+ * @param num_threads Number of worker threads. If it is not positive, the number of hardware threads is used.
+ */
+void ThreadPool::setGlobalThreads(int num_threads) {
+    lock_guard<mutex> lock(global_pool_mutex);
+    global_pool_threads = num_threads;
+    global_pool.reset();
+}
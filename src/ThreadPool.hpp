@@ -0,0 +1,82 @@
+//
+// Thread pool shared by the parallel image operations.
+//
+
+#ifndef IMAGEPROCESSING_THREADPOOL_HPP
+#define IMAGEPROCESSING_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief The ThreadPool class
+ * @details A fixed set of worker threads that run the iterations of parallel loops (see parallelFor). Iterations are
+ * handed out in chunks through an atomic counter, so uneven workloads are balanced between workers. Each iteration
+ * receives the index of the worker running it, which can be used to give each worker its own scratch buffers.
+ * A process-wide pool is available through ThreadPool::global, and its size can be configured with
+ * ThreadPool::setGlobalThreads.
+ */
+class ThreadPool {
+private:
+    /**
+     * @var workers
+     * Worker threads of the pool.
+     */
+    vector<thread> workers;
+    /**
+     * @var tasks
+     * Tasks waiting for a free worker, in a circular buffer that only grows, so that once the pool has run a loop with
+     * as many workers, queuing tasks does not allocate memory.
+     */
+    vector<function<void()>> tasks;
+    /**
+     * @var first_task
+     * Index in tasks of the next task to run.
+     */
+    size_t first_task = 0;
+    /**
+     * @var queued_tasks
+     * Number of tasks waiting in tasks.
+     */
+    size_t queued_tasks = 0;
+    /**
+     * @var tasks_mutex
+     * Mutex protecting the task queue.
+     */
+    mutex tasks_mutex;
+    /**
+     * @var tasks_available
+     * Condition variable used to wake the workers when a task is queued.
+     */
+    condition_variable tasks_available;
+    /**
+     * @var stopping
+     * Set when the pool is destroyed, to stop the workers.
+     */
+    bool stopping = false;
+
+    void workerLoop();
+    void pushTask(function<void()> task);
+
+public:
+    explicit ThreadPool(int num_threads = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    [[nodiscard]] int getNumThreads() const;
+
+    void parallelFor(int begin, int end, const function<void(int worker, int i)>& body,
+                     const function<void(int done, int total)>& progress = nullptr);
+
+    static ThreadPool& global();
+    static void setGlobalThreads(int num_threads);
+};
+
+
+#endif //IMAGEPROCESSING_THREADPOOL_HPP
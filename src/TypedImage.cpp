@@ -0,0 +1,567 @@
+//
+// Images stored with a compact pixel type (8-bit, 16-bit or single precision).
+//
+
+#include "TypedImage.hpp"
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+/*!
+ * @brief Value of a white pixel.
+ * @return The largest value of the type for integer pixels, or 1 for float pixels.
+ */
+template <typename T>
+T TypedImage<T>::maxValue() {
+    if constexpr (is_integral_v<T>) {
+        return numeric_limits<T>::max();
+    } else {
+        return 1;
+    }
+}
+
+/*!
+ * @brief Constructor for empty image with given dimensions.
+ * @details The pixels are set to 0 and laid out as given (see ImageLayout).
+ * @param width The width of the image. Must be positive.
+ * @param height The height of the image. Must be positive.
+ * @param channels The number of channels of the image. Must be positive.
+ * @param layout How the pixels are laid out in memory.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(int width, int height, int channels, ImageLayout layout) {
+    if (width <= 0 || height <= 0 || channels <= 0) {
+        throw std::invalid_argument("Width, height and number of channels must be positive");
+    }
+    this->width = width;
+    this->height = height;
+    this->channels = channels;
+    this->layout = layout;
+    layoutStrides(layout, width, height, channels, this->row_stride, this->col_stride, this->channel_stride);
+    this->buffer = Eigen::Array<T, Eigen::Dynamic, 1>::Zero((Eigen::Index) width * height * channels);
+    this->pixels = this->buffer.data();
+}
+
+/*!
+ * @brief Constructor converting an Image.
+ * @details The pixels of the image, in [0, 1], are scaled to [0, maxValue()] and rounded for integer pixels.
+ * @param image The image to be converted.
+ * @param layout How the pixels are laid out in memory.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(const Image& image, ImageLayout layout)
+        : TypedImage(image.getWidth(), image.getHeight(), image.getChannels(), layout) {
+    for (int c = 0; c < this->channels; c++) {
+        this->setChannel(c, (image.getChannelView(c).cast<float>() * (float) maxValue()).eval());
+    }
+}
+
+/*!
+ * @brief Reads an image file with elements of type T.
+ * @details The file is found (see findImageFile) and decoded as it is stored (see readImageFile). If its elements are
+ * not of type T, they are scaled to [0, TypedImage<T>::maxValue()] in one pass (see cv::Mat::convertTo), which rounds
+ * and saturates integer pixels.
+ * @param filename The filename of the image to be loaded.
+ * @return The pixels of the file, with the channels of each pixel side by side.
+ */
+template <typename T>
+static cv::Mat readTypedImageFile(const string& filename) {
+    bool absolute_path;
+    cv::Mat mat = readImageFile(findImageFile(filename, absolute_path));
+    if (mat.depth() == cv::DataType<T>::depth) {
+        return mat;
+    }
+    double white;
+    switch (mat.depth()) {
+        case CV_8U:
+            white = 255;
+            break;
+        case CV_16U:
+            white = 65535;
+            break;
+        case CV_32F:
+        case CV_64F:
+            white = 1;
+            break;
+        default:
+            throw std::invalid_argument(
+                    "Elements of the file must be 8-bit or 16-bit unsigned integers, or floating point");
+    }
+    cv::Mat converted;
+    mat.convertTo(converted, cv::DataType<T>::depth, (double) TypedImage<T>::maxValue() / white);
+    return converted;
+}
+
+/*!
+ * @brief Constructor from filename.
+ * @details The image wraps the decoded file (see readTypedImageFile and wrapCvMat), laid out as
+ * ImageLayout::InterleavedRowMajor, with the channels of the file (BGR order, 1 for grayscale, 4 with alpha). A file
+ * whose elements are of type T (e.g. a 16-bit PNG or TIFF for uint16_t pixels) is not copied nor converted.
+ * @param filename The filename of the image to be loaded.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(const string& filename) : TypedImage(readTypedImageFile<T>(filename)) {}
+
+/*!
+ * @brief Constructor sharing the buffer of a cv::Mat.
+ * @details See wrapCvMat.
+ * @param mat The matrix to be wrapped.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(const cv::Mat& mat) {
+    if (mat.empty()) {
+        throw std::invalid_argument("Data must not be empty");
+    }
+    if (mat.depth() != cv::DataType<T>::depth) {
+        throw std::invalid_argument("The elements of the Mat do not have the type of the pixels");
+    }
+    if (!mat.isContinuous()) {
+        throw std::invalid_argument("Only continuous Mats can be wrapped");
+    }
+    this->width = mat.cols;
+    this->height = mat.rows;
+    this->channels = mat.channels();
+    this->layout = ImageLayout::InterleavedRowMajor;
+    layoutStrides(this->layout, this->width, this->height, this->channels, this->row_stride, this->col_stride,
+                  this->channel_stride);
+    this->mat = mat;
+    this->pixels = (T*) this->mat.data;
+}
+
+/*!
+ * @brief Copy constructor.
+ * @details The copy owns its pixels, even if the image wraps a cv::Mat.
+ * @param image The image to be copied.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(const TypedImage& image) {
+    *this = image;
+}
+
+/*!
+ * @brief Move constructor.
+ * @details See the move assignment operator.
+ * @param image The image to be moved.
+ */
+template <typename T>
+TypedImage<T>::TypedImage(TypedImage&& image) noexcept {
+    *this = std::move(image);
+}
+
+/*!
+ * @brief Wraps a cv::Mat without copying it.
+ * @details The image shares the buffer of the Mat, as ImageLayout::InterleavedRowMajor: writing to one writes to the
+ * other. The image holds a reference to the Mat, so the buffer stays alive as long as the image does. Copies of the
+ * image own their pixels.
+ * @param mat The matrix to be wrapped. Must not be empty, must have no padding between its rows (see
+ * cv::Mat::isContinuous), and its elements must be of type T (CV_8U, CV_16U or CV_32F). Float elements must be in
+ * [0, 1].
+ * @return The image wrapping the Mat.
+ */
+template <typename T>
+TypedImage<T> TypedImage<T>::wrapCvMat(const cv::Mat& mat) {
+    return TypedImage<T>(mat);
+}
+
+/*!
+ * @brief Copy assignment operator.
+ * @details See the copy constructor.
+ * @param image The image to be copied.
+ * @return This image.
+ */
+template <typename T>
+TypedImage<T>& TypedImage<T>::operator=(const TypedImage& image) {
+    if (this == &image) {
+        return *this;
+    }
+    this->width = image.width;
+    this->height = image.height;
+    this->channels = image.channels;
+    this->layout = image.layout;
+    this->row_stride = image.row_stride;
+    this->col_stride = image.col_stride;
+    this->channel_stride = image.channel_stride;
+    this->buffer = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>(
+            image.pixels, (Eigen::Index) image.width * image.height * image.channels);
+    this->mat = cv::Mat();
+    this->pixels = this->buffer.data();
+    return *this;
+}
+
+/*!
+ * @brief Move assignment operator.
+ * @details Takes the pixels of the image (its buffer, or the cv::Mat it wraps) without copying them, and leaves it
+ * empty, so that the two images never share pixels.
+ * @param image The image to be moved.
+ * @return This image.
+ */
+template <typename T>
+TypedImage<T>& TypedImage<T>::operator=(TypedImage&& image) noexcept {
+    if (this == &image) {
+        return *this;
+    }
+    this->width = image.width;
+    this->height = image.height;
+    this->channels = image.channels;
+    this->layout = image.layout;
+    this->row_stride = image.row_stride;
+    this->col_stride = image.col_stride;
+    this->channel_stride = image.channel_stride;
+    this->buffer = std::move(image.buffer);
+    this->mat = std::move(image.mat);
+    this->pixels = this->mat.empty() ? this->buffer.data() : (T*) this->mat.data;
+
+    image.width = 0;
+    image.height = 0;
+    image.channels = 0;
+    image.buffer = Eigen::Array<T, Eigen::Dynamic, 1>();
+    image.mat = cv::Mat();
+    image.pixels = nullptr;
+    return *this;
+}
+
+/*!
+ * @brief Checks that a channel exists.
+ * @param channel The channel to be checked. Must be in [0, channels).
+ * @return
+ */
+template <typename T>
+void TypedImage<T>::checkChannel(int channel) const {
+    if (channel < 0 || channel >= this->channels) {
+        throw std::invalid_argument(
+                "Channel selected is not valid, must be between 0 and " + to_string(this->channels - 1));
+    }
+}
+
+/*!
+ * @brief Checks that a pixel is inside the image.
+ * @param x 'x' coordinate of the pixel. Must be in [0, width).
+ * @param y 'y' coordinate of the pixel. Must be in [0, height).
+ * @return
+ */
+template <typename T>
+void TypedImage<T>::checkPixel(int x, int y) const {
+    if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
+        throw std::invalid_argument(
+                "Pixel selected is not valid, must be between (0, 0) and (" + to_string(this->width - 1) + ", " +
+                to_string(this->height - 1) + ")");
+    }
+}
+
+/*!
+ * @brief Simple width getter.
+ * @return The width of the image.
+ */
+template <typename T>
+int TypedImage<T>::getWidth() const {
+    return this->width;
+}
+
+/*!
+ * @brief Simple height getter.
+ * @return The height of the image.
+ */
+template <typename T>
+int TypedImage<T>::getHeight() const {
+    return this->height;
+}
+
+/*!
+ * @brief Simple channels getter.
+ * @return The number of channels of the image.
+ */
+template <typename T>
+int TypedImage<T>::getChannels() const {
+    return this->channels;
+}
+
+/*!
+ * @brief Simple layout getter.
+ * @return How the pixels of the image are laid out in memory.
+ */
+template <typename T>
+ImageLayout TypedImage<T>::getLayout() const {
+    return this->layout;
+}
+
+/*!
+ * @brief Simple row stride getter.
+ * @return The distance in the buffer between two vertically adjacent pixels of a channel.
+ */
+template <typename T>
+Eigen::Index TypedImage<T>::getRowStride() const {
+    return this->row_stride;
+}
+
+/*!
+ * @brief Simple column stride getter.
+ * @return The distance in the buffer between two horizontally adjacent pixels of a channel.
+ */
+template <typename T>
+Eigen::Index TypedImage<T>::getColStride() const {
+    return this->col_stride;
+}
+
+/*!
+ * @brief Simple channel stride getter.
+ * @return The distance in the buffer between two channels of a pixel.
+ */
+template <typename T>
+Eigen::Index TypedImage<T>::getChannelStride() const {
+    return this->channel_stride;
+}
+
+/*!
+ * @brief Buffer getter.
+ * @details The buffer holds width * height * channels pixels, laid out as given by the layout and the strides.
+ * @return Pointer to the first pixel of the buffer.
+ */
+template <typename T>
+const T* TypedImage<T>::getBuffer() const {
+    return this->pixels;
+}
+
+/*!
+ * @brief Writable buffer getter.
+ * @details See the read-only getter. Float pixels written must stay in [0, 1].
+ * @return Pointer to the first pixel of the buffer.
+ */
+template <typename T>
+T* TypedImage<T>::getBuffer() {
+    return this->pixels;
+}
+
+/*!
+ * @brief Whether the image shares the buffer of a cv::Mat.
+ * @return True if the image was created by wrapCvMat, false if it owns its pixels.
+ */
+template <typename T>
+bool TypedImage<T>::wrapsCvMat() const {
+    return !this->mat.empty();
+}
+
+/*!
+ * @brief View of the data of a single channel.
+ * @details The view does not copy the channel, and follows the strides of the layout.
+ * @param channel The channel to be viewed. Must be in [0, channels).
+ * @return Read-only view of the data of the given channel.
+ */
+template <typename T>
+typename TypedImage<T>::ConstChannelView TypedImage<T>::getChannelView(int channel) const {
+    this->checkChannel(channel);
+    return {this->pixels + channel * this->channel_stride, this->height, this->width,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(this->col_stride, this->row_stride)};
+}
+
+/*!
+ * @brief Writable view of the data of a single channel.
+ * @details See the read-only view. Float pixels written must stay in [0, 1].
+ * @param channel The channel to be viewed. Must be in [0, channels).
+ * @return View of the data of the given channel.
+ */
+template <typename T>
+typename TypedImage<T>::ChannelView TypedImage<T>::getChannelView(int channel) {
+    this->checkChannel(channel);
+    return {this->pixels + channel * this->channel_stride, this->height, this->width,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(this->col_stride, this->row_stride)};
+}
+
+/*!
+ * @brief Simple pixel getter for a single channel.
+ * @param x 'x' coordinate of the pixel. Must be in [0, width).
+ * @param y 'y' coordinate of the pixel. Must be in [0, height).
+ * @param channel The channel to be returned. Must be in [0, channels).
+ * @return The pixel at the given coordinates for the given channel.
+ */
+template <typename T>
+T TypedImage<T>::getPixel(int x, int y, int channel) const {
+    this->checkPixel(x, y);
+    this->checkChannel(channel);
+    return this->pixels[y * this->row_stride + x * this->col_stride + channel * this->channel_stride];
+}
+
+/*!
+ * @brief Simple pixel setter for a single channel.
+ * @param x 'x' coordinate of the pixel. Must be in [0, width).
+ * @param y 'y' coordinate of the pixel. Must be in [0, height).
+ * @param channel The channel to be set. Must be in [0, channels).
+ * @param value The new value of the pixel. Must be in [0, maxValue()].
+ * @return
+ */
+template <typename T>
+void TypedImage<T>::setPixel(int x, int y, int channel, T value) {
+    this->checkPixel(x, y);
+    this->checkChannel(channel);
+    if constexpr (!is_integral_v<T>) {
+        if (value < 0 || value > 1) {
+            throw std::invalid_argument("Pixel values must be between 0 and 1");
+        }
+    }
+    this->pixels[y * this->row_stride + x * this->col_stride + channel * this->channel_stride] = value;
+}
+
+/*!
+ * @brief Sets a channel from single precision values.
+ * @details The values are in the units of the pixels (e.g. [0, 255] for 8-bit pixels). They are clamped to
+ * [0, maxValue()], and rounded for integer pixels.
+ * @param channel The channel to be set. Must be in [0, channels).
+ * @param values The new values of the channel, with the size of the image.
+ * @return
+ */
+template <typename T>
+void TypedImage<T>::setChannel(int channel, const Eigen::ArrayXXf& values) {
+    if (values.rows() != this->height || values.cols() != this->width) {
+        throw std::invalid_argument("Image dimensions do not match data dimensions");
+    }
+    ChannelView view = this->getChannelView(channel);
+    if constexpr (is_integral_v<T>) {
+        view = values.cwiseMax(0.f).cwiseMin((float) maxValue()).round().template cast<T>();
+    } else {
+        view = values.cwiseMax(0.f).cwiseMin(1.f).template cast<T>();
+    }
+}
+
+/*!
+ * @brief Overload == operator.
+ * @details Two images are equal if they have the same dimensions and pixels, whatever their layouts.
+ * @param image The image to be compared.
+ * @return True if the images are the same, false otherwise.
+ */
+template <typename T>
+bool TypedImage<T>::operator==(const TypedImage& image) const {
+    if (this->width != image.width || this->height != image.height || this->channels != image.channels) {
+        return false;
+    }
+    for (int c = 0; c < this->channels; c++) {
+        if (!(this->getChannelView(c) == image.getChannelView(c)).all()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * @brief Overload != operator.
+ * @param image The image to be compared.
+ * @return True if the images are different, false otherwise.
+ */
+template <typename T>
+bool TypedImage<T>::operator!=(const TypedImage& image) const {
+    return !(*this == image);
+}
+
+/*!
+ * @brief Gray levels of the image, in single precision.
+ * @details The channels are combined as in Image::reduceChannels: perceptual weights for 3 channels (and for the color
+ * channels of 4-channel images, whose fourth channel is alpha), mean otherwise.
+ * The levels are in the units of the pixels and are not rounded.
+ * @return The gray levels of the image.
+ */
+template <typename T>
+Eigen::ArrayXXf TypedImage<T>::grayLevels() const {
+    if (this->channels == 1) {
+        return this->getChannelView(0).template cast<float>();
+    }
+    if (this->channels == 3 || this->channels == 4) {
+        return 0.2126f * this->getChannelView(0).template cast<float>() +
+               0.7152f * this->getChannelView(1).template cast<float>() +
+               0.0722f * this->getChannelView(2).template cast<float>();
+    }
+    Eigen::ArrayXXf levels = Eigen::ArrayXXf::Zero(this->height, this->width);
+    for (int c = 0; c < this->channels; c++) {
+        levels += this->getChannelView(c).template cast<float>();
+    }
+    return levels / (float) this->channels;
+}
+
+/*!
+ * @brief Method to get a reduced (i.e. single-channel) version of the image.
+ * @details See grayLevels. The levels are rounded for integer pixels.
+ * @return an image with only one channel.
+ */
+template <typename T>
+TypedImage<T> TypedImage<T>::reduceChannels() const {
+    if (this->channels == 1) {
+        return *this;
+    }
+    TypedImage<T> reduced(this->width, this->height, 1, this->layout);
+    reduced.setChannel(0, this->grayLevels());
+    return reduced;
+}
+
+/*!
+ * @brief Method to copy the image with another layout.
+ * @param new_layout How the pixels of the copy are laid out in memory.
+ * @return The copy of the image.
+ */
+template <typename T>
+TypedImage<T> TypedImage<T>::toLayout(ImageLayout new_layout) const {
+    TypedImage<T> image(this->width, this->height, this->channels, new_layout);
+    for (int c = 0; c < this->channels; c++) {
+        image.getChannelView(c) = this->getChannelView(c);
+    }
+    return image;
+}
+
+/*!
+ * @brief Method to convert the image to an Image.
+ * @details The pixels are scaled to [0, 1], in double precision, with the same layout.
+ * @return The converted image.
+ */
+template <typename T>
+Image TypedImage<T>::toImage() const {
+    Image image(this->width, this->height, this->channels, this->layout);
+    for (int c = 0; c < this->channels; c++) {
+        image.getChannelView(c) = this->getChannelView(c).template cast<double>() / (double) maxValue();
+    }
+    return image;
+}
+
+/*!
+ * @brief Method to view the image as an OpenCV Mat, without copying it.
+ * @details The Mat shares the buffer of the image, with the channels of each pixel side by side, so the image must be
+ * laid out as ImageLayout::InterleavedRowMajor (see toLayout). For an image wrapping a Mat, that Mat is returned.
+ * Otherwise the Mat does not own the buffer, and is valid as long as the image is alive.
+ * @return The image as an OpenCV Mat sharing its buffer.
+ */
+template <typename T>
+cv::Mat TypedImage<T>::asCvMat() {
+    if (this->wrapsCvMat()) {
+        return this->mat;
+    }
+    if (this->layout != ImageLayout::InterleavedRowMajor) {
+        throw std::invalid_argument("Only images laid out as InterleavedRowMajor can be viewed as a Mat");
+    }
+    return {this->height, this->width, CV_MAKETYPE(cv::DataType<T>::depth, this->channels), this->pixels};
+}
+
+/*!
+ * @brief Converts the pixels of an image to another type.
+ * @details The pixels are scaled from [0, TypedImage<From>::maxValue()] to [0, TypedImage<To>::maxValue()], and
+ * rounded for integer pixels. The layout is kept.
+ * @param image The image to be converted.
+ * @return The converted image.
+ */
+template <typename To, typename From>
+TypedImage<To> convertPixels(const TypedImage<From>& image) {
+    TypedImage<To> converted(image.getWidth(), image.getHeight(), image.getChannels(), image.getLayout());
+    float scale = (float) TypedImage<To>::maxValue() / (float) TypedImage<From>::maxValue();
+    for (int c = 0; c < image.getChannels(); c++) {
+        converted.setChannel(c, (image.getChannelView(c).template cast<float>() * scale).eval());
+    }
+    return converted;
+}
+
+template class TypedImage<uint8_t>;
+template class TypedImage<uint16_t>;
+template class TypedImage<float>;
+
+template TypedImage<uint8_t> convertPixels<uint8_t, uint8_t>(const TypedImage<uint8_t>& image);
+template TypedImage<uint8_t> convertPixels<uint8_t, uint16_t>(const TypedImage<uint16_t>& image);
+template TypedImage<uint8_t> convertPixels<uint8_t, float>(const TypedImage<float>& image);
+template TypedImage<uint16_t> convertPixels<uint16_t, uint8_t>(const TypedImage<uint8_t>& image);
+template TypedImage<uint16_t> convertPixels<uint16_t, uint16_t>(const TypedImage<uint16_t>& image);
+template TypedImage<uint16_t> convertPixels<uint16_t, float>(const TypedImage<float>& image);
+template TypedImage<float> convertPixels<float, uint8_t>(const TypedImage<uint8_t>& image);
+template TypedImage<float> convertPixels<float, uint16_t>(const TypedImage<uint16_t>& image);
+template TypedImage<float> convertPixels<float, float>(const TypedImage<float>& image);
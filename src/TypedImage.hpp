@@ -0,0 +1,142 @@
+//
+// Images stored with a compact pixel type (8-bit, 16-bit or single precision).
+//
+
+#ifndef IMAGEPROCESSING_TYPEDIMAGE_HPP
+#define IMAGEPROCESSING_TYPEDIMAGE_HPP
+
+#include <Eigen/Eigen>
+#include <cstdint>
+#include "Image.hpp"
+
+using namespace std;
+
+/**
+ * @brief The TypedImage class
+ * @details Image whose pixels are stored as T: uint8_t, uint16_t or float. Integer pixels go from 0 (black) to the
+ * largest value of the type (white, see maxValue), and float pixels from 0 to 1, as the pixels of an Image. An 8-bit
+ * image takes 8 times less memory than an Image, and its kernels move 8 times less data. The pixels are laid out in a
+ * single buffer, as in an Image (see ImageLayout). The buffer is either owned by the image or, for an image wrapping a
+ * cv::Mat (see wrapCvMat), shared with the Mat without copying.
+ * Conversions to and from Image and between pixel types are explicit (see toImage and convertPixels), and the
+ * operations with a native path for these types (e.g. applySeparableConvolution, computeGradientMagnitude,
+ * applyThreshold, Denoiser::denoise and Histogram::computeHistogram) compute in single precision.
+ */
+template <typename T>
+class TypedImage {
+public:
+    /**
+     * @brief Array of the type of the pixels, with the shape of a channel.
+     */
+    typedef Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> Channel;
+    /**
+     * @brief View of a channel, whatever the layout (see getChannelView).
+     */
+    typedef Eigen::Map<Channel, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> ChannelView;
+    /**
+     * @brief Read-only view of a channel, whatever the layout (see getChannelView).
+     */
+    typedef Eigen::Map<const Channel, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> ConstChannelView;
+
+private:
+    /**
+     * @var width
+     * Width of the image.
+     */
+    int width;
+    /**
+     * @var height
+     * Height of the image.
+     */
+    int height;
+    /**
+     * @var channels
+     * Number of channels of the image.
+     */
+    int channels;
+    /**
+     * @var layout
+     * How the pixels are laid out in the buffer.
+     */
+    ImageLayout layout;
+    /**
+     * @var row_stride
+     * Distance in the buffer between two vertically adjacent pixels of a channel.
+     */
+    Eigen::Index row_stride;
+    /**
+     * @var col_stride
+     * Distance in the buffer between two horizontally adjacent pixels of a channel.
+     */
+    Eigen::Index col_stride;
+    /**
+     * @var channel_stride
+     * Distance in the buffer between two channels of a pixel.
+     */
+    Eigen::Index channel_stride;
+    /**
+     * @var buffer
+     * Pixels of all the channels, laid out as given by layout.
+     */
+    Eigen::Array<T, Eigen::Dynamic, 1> buffer;
+    /**
+     * @var mat
+     * Mat whose buffer holds the pixels, if the image wraps a cv::Mat (empty otherwise). It keeps the buffer alive.
+     */
+    cv::Mat mat;
+    /**
+     * @var pixels
+     * First pixel, in buffer or in the buffer of mat.
+     */
+    T* pixels;
+
+    explicit TypedImage(const cv::Mat& mat);
+
+    void checkChannel(int channel) const;
+    void checkPixel(int x, int y) const;
+
+public:
+    static T maxValue();
+
+    TypedImage(int width, int height, int channels, ImageLayout layout = ImageLayout::PlanarColumnMajor);
+    explicit TypedImage(const Image& image, ImageLayout layout = ImageLayout::PlanarColumnMajor);
+    explicit TypedImage(const string& filename);
+    TypedImage(const TypedImage& image);
+    TypedImage(TypedImage&& image) noexcept;
+    static TypedImage wrapCvMat(const cv::Mat& mat);
+
+    TypedImage& operator=(const TypedImage& image);
+    TypedImage& operator=(TypedImage&& image) noexcept;
+
+    [[nodiscard]] int getWidth() const;
+    [[nodiscard]] int getHeight() const;
+    [[nodiscard]] int getChannels() const;
+    [[nodiscard]] ImageLayout getLayout() const;
+    [[nodiscard]] Eigen::Index getRowStride() const;
+    [[nodiscard]] Eigen::Index getColStride() const;
+    [[nodiscard]] Eigen::Index getChannelStride() const;
+    [[nodiscard]] const T* getBuffer() const;
+    [[nodiscard]] T* getBuffer();
+    [[nodiscard]] bool wrapsCvMat() const;
+    [[nodiscard]] ConstChannelView getChannelView(int channel) const;
+    [[nodiscard]] ChannelView getChannelView(int channel);
+    [[nodiscard]] T getPixel(int x, int y, int channel) const;
+
+    void setPixel(int x, int y, int channel, T value);
+    void setChannel(int channel, const Eigen::ArrayXXf& values);
+
+    bool operator==(const TypedImage& image) const;
+    bool operator!=(const TypedImage& image) const;
+
+    [[nodiscard]] Eigen::ArrayXXf grayLevels() const;
+    [[nodiscard]] TypedImage reduceChannels() const;
+    [[nodiscard]] TypedImage toLayout(ImageLayout new_layout) const;
+    [[nodiscard]] Image toImage() const;
+    cv::Mat asCvMat();
+};
+
+template <typename To, typename From>
+TypedImage<To> convertPixels(const TypedImage<From>& image);
+
+
+#endif //IMAGEPROCESSING_TYPEDIMAGE_HPP
@@ -4,6 +4,11 @@
 
 #include <Eigen/Eigen>
 #include "operations.hpp"
+#include "FFTPlan.hpp"
+#include "ThreadPool.hpp"
+#include "ConvolutionCalibration.hpp"
+#include "SimdKernels.hpp"
+#include "ConvolutionPlan.hpp"
 
 
 /*!
@@ -26,81 +31,819 @@ template Eigen::ArrayXXd normalize<Eigen::Array<long double, Eigen::Dynamic, Eig
 // -------------------------------------- //
 // --- Default Convolution Operations --- //
 // -------------------------------------- //
+// Relative size of the second singular value of a kernel below which it is considered rank-1
+static const double SEPARABLE_TOLERANCE = 1e-12;
+// Number of blocks of an FFT convolution transformed in one batch
+static const int FFT_CONVOLUTION_BATCH = 16;
+// Number of rows computed by each task of the horizontal pass of the box filter
+static const int BOX_FILTER_ROWS = 64;
+// Number of rows computed by each task of the horizontal pass of the recursive Gaussian
+static const int RECURSIVE_GAUSSIAN_ROWS = 64;
+
 /*!
- * @brief Function to compute the convolution of an image with a kernel
- * @details This function computes the convolution of an image with a kernel. The kernel is assumed to be centered, and
- * it must be odd in size and squared. The image is padded with zeros so that the output image has the same size as the
- * input image.
- * @param input Input image in the form of an array
- * @param kernel Kernel to be used in the convolution
- * @return Output image in the form of an array
+ * @brief Function to split a kernel into a column kernel and a row kernel
+ * @details A kernel is separable if it is the outer product of a column kernel and a row kernel (i.e. it has rank 1),
+ * as the Gaussian, mean and Sobel kernels. The rank is found with a singular value decomposition of the kernel.
+ * @param kernel Kernel to split
+ * @param column_kernel Output column kernel, applied along the rows of the image
+ * @param row_kernel Output row kernel, applied along the columns of the image
+ * @return True if the kernel is separable, in which case kernel(k, l) = column_kernel(k) * row_kernel(l)
+ */
+bool separateKernel(const Eigen::ArrayXXd& kernel, Eigen::ArrayXd& column_kernel, Eigen::ArrayXd& row_kernel) {
+    if (kernel.size() == 0) {
+        return false;
+    }
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(kernel.matrix(), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::VectorXd& singular_values = svd.singularValues();
+    if (singular_values.size() > 1 && singular_values(1) > SEPARABLE_TOLERANCE * singular_values(0)) {
+        return false;
+    }
+    double scale = sqrt(singular_values(0));
+    column_kernel = svd.matrixU().col(0).array() * scale;
+    row_kernel = svd.matrixV().col(0).array() * scale;
+    return true;
+}
+
+/*!
+ * @brief Maps an index outside of the image to the pixel that replaces it
+ * @param index Row or column index, possibly outside of [0, size)
+ * @param size Number of rows or columns of the image
+ * @param border How the image is extended beyond its edges
+ * @return Index in [0, size), or -1 if the pixel is the constant border value
  */
-Eigen::ArrayXXd applyConvolution(Eigen::ArrayXXd input, Eigen::ArrayXXd kernel) {
-    if (kernel.rows() % 2 == 0 || kernel.cols() % 2 == 0) {
+static int borderIndex(int index, int size, BorderMode border) {
+    if (index >= 0 && index < size) {
+        return index;
+    }
+    switch (border) {
+        case BorderMode::Zero:
+        case BorderMode::Constant:
+            return -1;
+        case BorderMode::Replicate:
+            return index < 0 ? 0 : size - 1;
+        case BorderMode::Reflect: {
+            if (size == 1) {
+                return 0;
+            }
+            int period = 2 * (size - 1);
+            index = abs(index) % period;
+            return index < size ? index : period - index;
+        }
+        case BorderMode::Wrap:
+            return (index % size + size) % size;
+    }
+    return -1;
+}
+
+/*!
+ * @brief Checks that a kernel can be applied to an image
+ * @param rows Number of rows of the image
+ * @param cols Number of columns of the image
+ * @param kernel_rows Number of rows of the kernel
+ * @param kernel_cols Number of columns of the kernel
+ * @return
+ */
+void checkKernelSize(Eigen::Index rows, Eigen::Index cols, Eigen::Index kernel_rows, Eigen::Index kernel_cols) {
+    if (kernel_rows % 2 == 0 || kernel_cols % 2 == 0) {
         throw std::invalid_argument("Kernel size must be odd");
     }
-    if (kernel.rows() > input.rows() || kernel.cols() > input.cols()) {
+    if (kernel_rows > rows || kernel_cols > cols) {
         throw std::invalid_argument("Kernel size must be smaller than input size");
     }
-    if (kernel.rows() != kernel.cols()) {
-        throw std::invalid_argument("Kernel must be square");
+}
+
+/*!
+ * @brief Runs a convolution in parallel, by bands of output columns
+ * @details The output of each image is split in bands of CONVOLUTION_BAND columns, and all the bands of all the images
+ * are computed as independent tasks on the global thread pool (see ThreadPool::setGlobalThreads). The arrays are
+ * column-major, so a band is a contiguous block of the output, and it reads a contiguous block of the input, extended
+ * by the kernel radius on each side (its halo). The bands only write their own output columns, so they need no
+ * synchronization.
+ * @param images Number of images convolved (e.g. the channels of an image)
+ * @param cols Number of columns of each image
+ * @param band Function called as band(image, first column, one past the last column)
+ * @return
+ */
+static void convolveBands(int images, int cols, const function<void(int, int, int)>& band) {
+    int bands = (cols + CONVOLUTION_BAND - 1) / CONVOLUTION_BAND;
+    ThreadPool::global().parallelFor(0, images * bands, [&](int, int task) {
+        int j_begin = (task % bands) * CONVOLUTION_BAND;
+        band(task / bands, j_begin, min(j_begin + CONVOLUTION_BAND, cols));
+    });
+}
+
+/*!
+ * @brief Computes one output column of a separable convolution
+ * @details See applySeparableConvolution. The horizontal pass only computes the column needed by the vertical pass.
+ * Both passes run on the vectorized weightedSum. Once the buffers of scratch have grown to the size of the image and
+ * of the kernel, no memory is allocated.
+ * @param input Input image in the form of an array
+ * @param column_kernel Kernel applied along the rows of the image (vertical pass)
+ * @param row_kernel Kernel applied along the columns of the image (horizontal pass)
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param j Index of the output column
+ * @param scratch Buffers of the calling task
+ * @param output Output image, whose column j is written
+ * @return
+ */
+template <typename Scalar>
+static void separableColumnOf(const Eigen::Ref<const Eigen::Array<Scalar, Eigen::Dynamic, Eigen::Dynamic>>& input,
+                              const Eigen::Array<Scalar, Eigen::Dynamic, 1>& column_kernel,
+                              const Eigen::Array<Scalar, Eigen::Dynamic, 1>& row_kernel, BorderMode border,
+                              Scalar border_value, int j, BasicColumnScratch<Scalar>& scratch,
+                              Eigen::Ref<Eigen::Array<Scalar, Eigen::Dynamic, Eigen::Dynamic>> output) {
+    int input_rows = input.rows();
+    int input_cols = input.cols();
+    int row_radius = (row_kernel.size() - 1) / 2;
+    int column_radius = (column_kernel.size() - 1) / 2;
+    Scalar value = border == BorderMode::Constant ? border_value : 0;
+
+    // horizontal pass: whole input columns at a time, since the arrays are column-major
+    auto& horizontal = scratch.horizontal;
+    horizontal.resize(input_rows);
+    scratch.sources.clear();
+    scratch.weights.clear();
+    Scalar constant = 0;
+    bool interior = j >= row_radius && j < input_cols - row_radius;
+    for (int l = 0; l < row_kernel.size(); l++) {
+        int input_j = interior ? j + l - row_radius : borderIndex(j + l - row_radius, input_cols, border);
+        if (input_j >= 0) {
+            scratch.sources.push_back(input.col(input_j).data());
+            scratch.weights.push_back(row_kernel(l));
+        } else {
+            constant += row_kernel(l) * value;
+        }
+    }
+    weightedSum(scratch.sources.data(), scratch.weights.data(), (int) scratch.sources.size(), horizontal.data(),
+                input_rows);
+    if (constant != 0) {
+        horizontal += constant;
     }
 
+    // vertical pass: each kernel tap is a shifted segment of the column in the interior, without bounds checks
+    auto output_col = output.col(j);
+    int interior_rows = max(0, input_rows - 2 * column_radius);
+    scratch.sources.clear();
+    for (int k = 0; k < column_kernel.size(); k++) {
+        scratch.sources.push_back(horizontal.data() + k);
+    }
+    weightedSum(scratch.sources.data(), column_kernel.data(), (int) column_kernel.size(),
+                output_col.data() + column_radius, interior_rows);
+    // border rows: a row beyond the edges is constant after the horizontal pass
+    Scalar row_value = value * row_kernel.sum();
+    for (int i = 0; i < input_rows; i++) {
+        if (i == column_radius && interior_rows > 0) {
+            i += interior_rows - 1;
+            continue;
+        }
+        Scalar sum = 0;
+        for (int k = 0; k < column_kernel.size(); k++) {
+            int input_i = borderIndex(i + k - column_radius, input_rows, border);
+            sum += column_kernel(k) * (input_i >= 0 ? horizontal(input_i) : row_value);
+        }
+        output_col(i) = sum;
+    }
+}
+
+/*!
+ * @brief Computes one output column of a separable convolution
+ * @details See separableColumnOf.
+ * @return
+ */
+void separableColumn(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXd& column_kernel,
+                     const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value, int j,
+                     ColumnScratch& scratch, Eigen::Ref<Eigen::ArrayXXd> output) {
+    separableColumnOf<double>(input, column_kernel, row_kernel, border, border_value, j, scratch, output);
+}
+
+/*!
+ * @brief Computes one output column of a separable convolution, in single precision
+ * @details See separableColumnOf. Used by the convolutions of images with compact pixels (see TypedImage).
+ * @return
+ */
+void separableColumn(const Eigen::Ref<const Eigen::ArrayXXf>& input, const Eigen::ArrayXf& column_kernel,
+                     const Eigen::ArrayXf& row_kernel, BorderMode border, float border_value, int j,
+                     BasicColumnScratch<float>& scratch, Eigen::Ref<Eigen::ArrayXXf> output) {
+    separableColumnOf<float>(input, column_kernel, row_kernel, border, border_value, j, scratch, output);
+}
+
+/*!
+ * @brief Computes one output column of a direct convolution
+ * @details See applyConvolution. The interior rows are computed by the vectorized weightedSum, as k^2 shifted column
+ * segments without bounds checks, and only the border pixels are remapped. Once the buffers of scratch have grown to
+ * the size of the kernel, no memory is allocated.
+ * @param input Input image in the form of an array
+ * @param kernel Kernel to be used in the convolution
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param j Index of the output column
+ * @param scratch Buffers of the calling task
+ * @param output Output image, whose column j is written
+ * @return
+ */
+void directColumn(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel, BorderMode border,
+                  double border_value, int j, ColumnScratch& scratch, Eigen::Ref<Eigen::ArrayXXd> output) {
     int kernel_size = kernel.rows();
     int kernel_radius = (kernel_size - 1) / 2;
     int input_rows = input.rows();
     int input_cols = input.cols();
+    int interior_rows = max(0, input_rows - 2 * kernel_radius);
+    bool interior_col = j >= kernel_radius && j < input_cols - kernel_radius;
+    double value = border == BorderMode::Constant ? border_value : 0;
 
-    Eigen::ArrayXXd output = Eigen::ArrayXXd::Zero(input_rows, input_cols);
+    auto output_col = output.col(j);
+    // interior: O(k^2) per pixel
+    if (interior_col) {
+        scratch.sources.clear();
+        scratch.weights.clear();
+        for (int l = 0; l < kernel_size; l++) {
+            for (int k = 0; k < kernel_size; k++) {
+                scratch.sources.push_back(input.col(j + l - kernel_radius).data() + k);
+                scratch.weights.push_back(kernel(k, l));
+            }
+        }
+        weightedSum(scratch.sources.data(), scratch.weights.data(), (int) scratch.sources.size(),
+                    output_col.data() + kernel_radius, interior_rows);
+    }
 
-    // apply convolution: O(n^2 * k^2)
+    // border, remapping the pixels beyond the edges
     for (int i = 0; i < input_rows; i++) {
-        for (int j = 0; j < input_cols; j++) {
-            for (int k = 0; k < kernel_size; k++) {
-                for (int l = 0; l < kernel_size; l++) {
-                    int input_i = i + k - kernel_radius;
-                    int input_j = j + l - kernel_radius;
-                    // take into account zero padding for the edges
-                    if (input_i >= 0 && input_i < input_rows && input_j >= 0 && input_j < input_cols) {
-                        output(i, j) += input(input_i, input_j) * kernel(k, l);
-                    }
-                }
+        if (interior_col && i == kernel_radius && interior_rows > 0) {
+            i += interior_rows - 1;
+            continue;
+        }
+        double sum = 0;
+        for (int k = 0; k < kernel_size; k++) {
+            int input_i = borderIndex(i + k - kernel_radius, input_rows, border);
+            for (int l = 0; l < kernel_size; l++) {
+                int input_j = borderIndex(j + l - kernel_radius, input_cols, border);
+                sum += kernel(k, l) * (input_i >= 0 && input_j >= 0 ? input(input_i, input_j) : value);
+            }
+        }
+        output_col(i) = sum;
+    }
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with a separable kernel
+ * @details This function computes the convolution of an image with the kernel column_kernel * row_kernel^T, as two 1D
+ * passes: O(n^2 * k) instead of O(n^2 * k^2). As in applyConvolution, the kernels are centered, they must be odd in
+ * size, and the image is extended beyond its edges according to the border mode, so that the output image has the same
+ * size as the input image. Bands of output columns are computed in parallel (see ConvolutionPlan).
+ * @param input Input image in the form of an array
+ * @param column_kernel Kernel applied along the rows of the image (vertical pass)
+ * @param row_kernel Kernel applied along the columns of the image (horizontal pass)
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @return Output image in the form of an array
+ */
+Eigen::ArrayXXd applySeparableConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input,
+                                          const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel,
+                                          BorderMode border, double border_value) {
+    ConvolutionPlan plan((int) input.rows(), (int) input.cols(), column_kernel, row_kernel, border, border_value);
+    Eigen::ArrayXXd output(input.rows(), input.cols());
+    plan.execute(input, output);
+    return output;
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with a separable kernel
+ * @details See applySeparableConvolution on arrays. The bands of all channels are computed in parallel. Note: In order to
+ * return a valid image, the Image is normalized to [0,1] by default, from the range of each channel recorded during the
+ * convolution (see ConvolutionPlan::execute). The alpha channel, if any, is copied unchanged.
+ * @param input Input image in the form of an Image object (see Image.hpp)
+ * @param column_kernel Kernel applied along the rows of the image (vertical pass)
+ * @param row_kernel Kernel applied along the columns of the image (horizontal pass)
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param normalize_output Whether to normalize each channel to [0,1], or keep the raw convolution values
+ * @return Output image in the form of an Image object
+ */
+Image applySeparableConvolution(const Image& input, const Eigen::ArrayXd& column_kernel,
+                                const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value,
+                                bool normalize_output) {
+    ConvolutionPlan plan(input.getHeight(), input.getWidth(), column_kernel, row_kernel, border, border_value);
+    Image output(input.getWidth(), input.getHeight(), input.getChannels());
+    plan.execute(input, output, normalize_output);
+    return output;
+}
+
+/*!
+ * @brief Function to compute the convolution of a single precision array with a separable kernel
+ * @details See applySeparableConvolution on arrays. Bands of output columns are computed in parallel, each worker with
+ * its own buffers.
+ * @param input Input image in the form of an array
+ * @param column_kernel Kernel applied along the rows of the image (vertical pass)
+ * @param row_kernel Kernel applied along the columns of the image (horizontal pass)
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @return Output image in the form of an array
+ */
+static Eigen::ArrayXXf separableConvolutionFloat(const Eigen::ArrayXXf& input, const Eigen::ArrayXf& column_kernel,
+                                                 const Eigen::ArrayXf& row_kernel, BorderMode border,
+                                                 float border_value) {
+    checkKernelSize(input.rows(), input.cols(), column_kernel.size(), row_kernel.size());
+    Eigen::ArrayXXf output(input.rows(), input.cols());
+    ThreadPool& pool = ThreadPool::global();
+    vector<BasicColumnScratch<float>> scratch(pool.getNumThreads());
+    int cols = input.cols();
+    int bands = (cols + CONVOLUTION_BAND - 1) / CONVOLUTION_BAND;
+    pool.parallelFor(0, bands, [&](int worker, int band) {
+        int j_end = min((band + 1) * CONVOLUTION_BAND, cols);
+        for (int j = band * CONVOLUTION_BAND; j < j_end; j++) {
+            separableColumn(input, column_kernel, row_kernel, border, border_value, j, scratch[worker], output);
+        }
+    });
+    return output;
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with compact pixels with a separable kernel
+ * @details See applySeparableConvolution on arrays. Each channel is convolved in single precision, and the result is
+ * rounded and clamped to the range of the pixels. Unlike the convolution of an Image, the output is not normalized:
+ * a normalized kernel (e.g. a Gaussian) keeps the brightness of the image.
+ * @param input Input image (see TypedImage)
+ * @param column_kernel Kernel applied along the rows of the image (vertical pass)
+ * @param row_kernel Kernel applied along the columns of the image (horizontal pass)
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant, in the units of the pixels
+ * @return Output image, with the type and layout of the input
+ */
+template <typename T>
+TypedImage<T> applySeparableConvolution(const TypedImage<T>& input, const Eigen::ArrayXd& column_kernel,
+                                        const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value) {
+    Eigen::ArrayXf column_kernel_f = column_kernel.cast<float>();
+    Eigen::ArrayXf row_kernel_f = row_kernel.cast<float>();
+    TypedImage<T> output(input.getWidth(), input.getHeight(), input.getChannels(), input.getLayout());
+    for (int c = 0; c < input.getChannels(); c++) {
+        Eigen::ArrayXXf channel = input.getChannelView(c).template cast<float>();
+        output.setChannel(c, separableConvolutionFloat(channel, column_kernel_f, row_kernel_f, border,
+                                                       (float) border_value));
+    }
+    return output;
+}
+
+/*!
+ * @brief Function to compute the mean of each pixel over a square window (box filter)
+ * @details This function computes the same convolution as applyConvolution with a uniform size x size kernel (a mean
+ * filter), with running sums: a vertical pass along each column, then a horizontal pass across the columns, each one
+ * adding the pixel entering the window and subtracting the one leaving it. The cost per pixel does not depend on the
+ * size of the window. The result matches the convolution up to rounding errors. The columns of the vertical pass and
+ * blocks of BOX_FILTER_ROWS rows of the horizontal pass are computed in parallel.
+ * @param input Input image in the form of an array
+ * @param size Size of the window. Must be odd.
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @return Output image in the form of an array
+ */
+Eigen::ArrayXXd applyBoxFilter(const Eigen::Ref<const Eigen::ArrayXXd>& input, int size, BorderMode border,
+                               double border_value) {
+    if (size <= 0) {
+        throw std::invalid_argument("Kernel size must be positive");
+    }
+    checkKernelSize(input.rows(), input.cols(), size, size);
+    int radius = (size - 1) / 2;
+    int rows = input.rows();
+    int cols = input.cols();
+    double value = border == BorderMode::Constant ? border_value : 0;
+
+    // vertical pass: running sum along each column
+    Eigen::ArrayXXd vertical(rows, cols);
+    convolveBands(1, cols, [&](int, int j_begin, int j_end) {
+        for (int j = j_begin; j < j_end; j++) {
+            auto input_col = input.col(j);
+            auto pixel = [&](int i) {
+                int input_i = borderIndex(i, rows, border);
+                return input_i >= 0 ? input_col(input_i) : value;
+            };
+            double sum = 0;
+            for (int i = -radius; i <= radius; i++) {
+                sum += pixel(i);
+            }
+            for (int i = 0; i < rows; i++) {
+                vertical(i, j) = sum;
+                sum += pixel(i + radius + 1) - pixel(i - radius);
             }
         }
+    });
+
+    // horizontal pass: running sum of the columns of the vertical pass, by blocks of rows; a column beyond the edges
+    // sums size constant pixels
+    Eigen::ArrayXXd output(rows, cols);
+    double column_value = value * size;
+    double scale = 1.0 / ((double) size * size);
+    int blocks = (rows + BOX_FILTER_ROWS - 1) / BOX_FILTER_ROWS;
+    ThreadPool::global().parallelFor(0, blocks, [&](int, int block) {
+        int i0 = block * BOX_FILTER_ROWS;
+        int block_rows = min(BOX_FILTER_ROWS, rows - i0);
+        Eigen::ArrayXd sum = Eigen::ArrayXd::Zero(block_rows);
+        auto accumulate = [&](int j, double sign) {
+            int input_j = borderIndex(j, cols, border);
+            if (input_j >= 0) {
+                sum += sign * vertical.col(input_j).segment(i0, block_rows);
+            } else {
+                sum += sign * column_value;
+            }
+        };
+        for (int j = -radius; j <= radius; j++) {
+            accumulate(j, 1);
+        }
+        for (int j = 0; j < cols; j++) {
+            output.col(j).segment(i0, block_rows) = sum * scale;
+            accumulate(j + radius + 1, 1);
+            accumulate(j - radius, -1);
+        }
+    });
+    return output;
+}
+
+/*!
+ * @brief Function to compute the mean of each pixel over a square window (box filter)
+ * @details See applyBoxFilter on arrays. Note: In order to return a valid image, the Image is normalized to [0,1]. The
+ * alpha channel, if any, is copied unchanged (see Image::hasAlpha).
+ * @param input Input image in the form of an Image object (see Image.hpp)
+ * @param size Size of the window. Must be odd.
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @return Output image in the form of an Image object
+ */
+Image applyBoxFilter(const Image& input, int size, BorderMode border, double border_value) {
+    auto filter = [&](const Eigen::Ref<const Eigen::ArrayXXd>& channel) {
+        return applyBoxFilter(channel, size, border, border_value);
+    };
+    Image output(input.getWidth(), input.getHeight(), input.getChannels());
+    for (int i = 0; i < input.getColorChannels(); i++) {
+        output.getChannelView(i) = normalize(applyToChannel(input, i, filter));
     }
+    if (input.hasAlpha()) {
+        output.getChannelView(3) = input.getChannelView(3);
+    }
+    return output;
+}
+
+/**
+ * @brief Coefficients of the recursive Gaussian filter, normalized by b0 (Young and van Vliet, 1995).
+ */
+struct RecursiveGaussianCoefficients {
+    double B;    ///< Weight of the input.
+    double b1;   ///< Weight of the previous output.
+    double b2;   ///< Weight of the output two steps before.
+    double b3;   ///< Weight of the output three steps before.
+    double M[9]; ///< Initial states of the anti-causal pass from the last causal ones (Triggs and Sdika, 2006).
+};
+
+/*!
+ * @brief Computes the coefficients of the recursive Gaussian filter
+ * @param sigma Standard deviation of the Gaussian. Must be at least 0.5.
+ * @return The coefficients of the filter
+ */
+static RecursiveGaussianCoefficients recursiveGaussianCoefficients(double sigma) {
+    if (sigma < 0.5) {
+        throw std::invalid_argument("Sigma of the recursive Gaussian must be at least 0.5");
+    }
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    RecursiveGaussianCoefficients c{};
+    double a1 = c.b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double a2 = c.b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double a3 = c.b3 = 0.422205 * q3 / b0;
+    c.B = 1 - (a1 + a2 + a3);
+
+    double scale = c.B / ((1 + a1 - a2 + a3) * (1 - a1 - a2 - a3) * (1 + a2 + (a1 - a3) * a3));
+    c.M[0] = scale * (-a3 * a1 + 1 - a3 * a3 - a2);
+    c.M[1] = scale * (a3 + a1) * (a2 + a3 * a1);
+    c.M[2] = scale * a3 * (a1 + a3 * a2);
+    c.M[3] = scale * (a1 + a3 * a2);
+    c.M[4] = -scale * (a2 - 1) * (a2 + a3 * a1);
+    c.M[5] = -scale * a3 * (a3 * a1 + a3 * a3 + a2 - 1);
+    c.M[6] = scale * (a3 * a1 + a2 + a1 * a1 - a2 * a2);
+    c.M[7] = scale * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3);
+    c.M[8] = scale * a3 * (a1 + a3 * a2);
+    return c;
+}
+
+/*!
+ * @brief Applies the recursive Gaussian filter along a line, in place
+ * @details A causal pass followed by an anti-causal pass, as if the line was extended by replicating its edges: the
+ * causal pass starts from the steady state of the first element, and the anti-causal one from the states that
+ * continue the causal pass over the replicated last element (Triggs and Sdika). Only the last output is initialized
+ * that way; the recursion computes the others.
+ * @param c Coefficients of the filter
+ * @param data First element of the line
+ * @param length Number of elements of the line
+ * @return
+ */
+static void recursiveGaussianLine(const RecursiveGaussianCoefficients& c, double* data, int length) {
+    double last = data[length - 1];
+    double w1 = data[0], w2 = w1, w3 = w1;
+    for (int i = 0; i < length; i++) {
+        double w = c.B * data[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = data[i] = w;
+    }
+    double d1 = w1 - last, d2 = w2 - last, d3 = w3 - last;
+    data[length - 1] = c.M[0] * d1 + c.M[1] * d2 + c.M[2] * d3 + last;
+    w1 = data[length - 1];
+    w2 = c.M[3] * d1 + c.M[4] * d2 + c.M[5] * d3 + last;
+    w3 = c.M[6] * d1 + c.M[7] * d2 + c.M[8] * d3 + last;
+    for (int i = length - 2; i >= 0; i--) {
+        double w = c.B * data[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = data[i] = w;
+    }
+}
+
+/*!
+ * @brief Applies the recursive Gaussian filter along the rows of a block of rows, in place
+ * @details Same recursion as recursiveGaussianLine, with the states holding a segment of a column, so that each step
+ * runs over contiguous elements of the column-major array.
+ * @param c Coefficients of the filter
+ * @param data Array filtered along its rows
+ * @param i0 First row of the block
+ * @param rows Number of rows of the block
+ * @return
+ */
+static void recursiveGaussianRows(const RecursiveGaussianCoefficients& c, Eigen::ArrayXXd& data, int i0, int rows) {
+    int cols = data.cols();
+    Eigen::ArrayXd last = data.col(cols - 1).segment(i0, rows);
+    Eigen::ArrayXd w1 = data.col(0).segment(i0, rows), w2 = w1, w3 = w1;
+    for (int j = 0; j < cols; j++) {
+        auto column = data.col(j).segment(i0, rows);
+        column = c.B * column + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        w3.swap(w2);
+        w2.swap(w1);
+        w1 = column;
+    }
+    Eigen::ArrayXd d1 = w1 - last, d2 = w2 - last, d3 = w3 - last;
+    w1 = c.M[0] * d1 + c.M[1] * d2 + c.M[2] * d3 + last;
+    w2 = c.M[3] * d1 + c.M[4] * d2 + c.M[5] * d3 + last;
+    w3 = c.M[6] * d1 + c.M[7] * d2 + c.M[8] * d3 + last;
+    data.col(cols - 1).segment(i0, rows) = w1;
+    for (int j = cols - 2; j >= 0; j--) {
+        auto column = data.col(j).segment(i0, rows);
+        column = c.B * column + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        w3.swap(w2);
+        w2.swap(w1);
+        w1 = column;
+    }
+}
 
+/*!
+ * @brief Function to compute a Gaussian blur with a recursive (IIR) filter
+ * @details This function approximates the convolution with a Gaussian of standard deviation sigma with the recursive
+ * filter of Young and van Vliet: a third order causal and anti-causal recursion along the columns, then along the rows.
+ * The cost per pixel does not depend on sigma, so it is meant for large sigmas, whose kernels would be too large for
+ * applyConvolution. The image is extended beyond its edges by replicating them. The columns, and then blocks of
+ * RECURSIVE_GAUSSIAN_ROWS rows, are filtered in parallel.
+ * @param input Input image in the form of an array
+ * @param sigma Standard deviation of the Gaussian, in pixels. Must be at least 0.5.
+ * @return Output image in the form of an array
+ */
+Eigen::ArrayXXd applyRecursiveGaussian(const Eigen::Ref<const Eigen::ArrayXXd>& input, double sigma) {
+    if (input.size() == 0) {
+        throw std::invalid_argument("Input cannot be empty");
+    }
+    RecursiveGaussianCoefficients c = recursiveGaussianCoefficients(sigma);
+    Eigen::ArrayXXd output = input;
+    int rows = output.rows();
+
+    // vertical pass, along each column
+    convolveBands(1, output.cols(), [&](int, int j_begin, int j_end) {
+        for (int j = j_begin; j < j_end; j++) {
+            recursiveGaussianLine(c, output.col(j).data(), rows);
+        }
+    });
+
+    // horizontal pass, by blocks of rows
+    int blocks = (rows + RECURSIVE_GAUSSIAN_ROWS - 1) / RECURSIVE_GAUSSIAN_ROWS;
+    ThreadPool::global().parallelFor(0, blocks, [&](int, int block) {
+        int i0 = block * RECURSIVE_GAUSSIAN_ROWS;
+        recursiveGaussianRows(c, output, i0, min(RECURSIVE_GAUSSIAN_ROWS, rows - i0));
+    });
     return output;
 }
 
+/*!
+ * @brief Function to compute a Gaussian blur with a recursive (IIR) filter
+ * @details See applyRecursiveGaussian on arrays. Note: In order to return a valid image, the Image is normalized to
+ * [0,1]. The alpha channel, if any, is copied unchanged (see Image::hasAlpha).
+ * @param input Input image in the form of an Image object (see Image.hpp)
+ * @param sigma Standard deviation of the Gaussian, in pixels. Must be at least 0.5.
+ * @return Output image in the form of an Image object
+ */
+Image applyRecursiveGaussian(const Image& input, double sigma) {
+    auto filter = [&](const Eigen::Ref<const Eigen::ArrayXXd>& channel) {
+        return applyRecursiveGaussian(channel, sigma);
+    };
+    Image output(input.getWidth(), input.getHeight(), input.getChannels());
+    for (int i = 0; i < input.getColorChannels(); i++) {
+        output.getChannelView(i) = normalize(applyToChannel(input, i, filter));
+    }
+    if (input.hasAlpha()) {
+        output.getChannelView(3) = input.getChannelView(3);
+    }
+    return output;
+}
+
+/*!
+ * @brief Function to apply an operation on arrays to a channel of an image
+ * @details Channels whose columns are contiguous (see Image::getColumnMajorView), as in the images created from arrays,
+ * are passed to the operation as views, without copies. The channels of other layouts are copied first.
+ * @param input Input image in the form of an Image object (see Image.hpp)
+ * @param channel Channel to be passed to the operation. Must be in [0, channels).
+ * @param operation Operation on arrays (e.g. applyConvolution)
+ * @return Result of the operation
+ */
+Eigen::ArrayXXd applyToChannel(const Image& input, int channel, const ArrayOperation& operation) {
+    if (input.getRowStride() == 1) {
+        return operation(input.getColumnMajorView(channel));
+    }
+    return operation(input.getData(channel));
+}
+
 /*!
  * @brief Function to compute the convolution of an image with a kernel
  * @details This function computes the convolution of an image with a kernel. The kernel is assumed to be centered, and
- * it must be odd in size and squared. The image is padded with zeros so that the output image has the same size as the
- * input image. Note: In order to return a valid image, the Image is normalized to [0,1].
- * @param input Input image in the form of an Image object (see Image.hpp)
+ * it must be odd in size and squared. The image is extended beyond its edges according to the border mode (zero
+ * padding by default) so that the output image has the same size as the input image. The interior of the image, where
+ * the kernel does not cross the edges, is computed without bounds checks, and only the border pixels are remapped.
+ * By default, the method is chosen from the size of the image and of the kernel (see ConvolutionCalibration):
+ * separable (rank-1) kernels are applied as two 1D passes (see applySeparableConvolution), and large kernels as a
+ * product of spectra (see applyFFTConvolution). Bands of output columns are computed in parallel. To convolve many
+ * images of the same size with the same kernel, a ConvolutionPlan avoids repeating this setup.
+ * @param input Input image in the form of an array
  * @param kernel Kernel to be used in the convolution
- * @return Output image in the form of an Image object
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param method How the convolution is computed
+ * @return Output image in the form of an array
+ */
+Eigen::ArrayXXd applyConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel,
+                                 BorderMode border, double border_value, ConvolutionMethod method) {
+    ConvolutionPlan plan((int) input.rows(), (int) input.cols(), kernel, border, border_value, method);
+    Eigen::ArrayXXd output(input.rows(), input.cols());
+    plan.execute(input, output);
+    return output;
+}
+
+/*!
+ * @brief Computes the spectrum of a kernel for applyFFTConvolution
+ * @details The kernel is flipped and zero-padded to the size of the blocks used for an image of the given size (see
+ * ConvolutionCalibration::fftBlockLength), so that the circular convolution of a block with it gives the correlation
+ * computed by applyConvolution, shifted by kernel_size - 1, without wrapping around for the output pixels of the block.
+ * @param kernel Kernel to be used in the convolution
+ * @param rows Number of rows of the images convolved
+ * @param cols Number of columns of the images convolved
+ * @return Half-spectrum of the padded kernel (see rdft2)
+ */
+Eigen::ArrayXXcd fftConvolutionKernelSpectrum(const Eigen::ArrayXXd& kernel, int rows, int cols) {
+    int kernel_size = kernel.rows();
+    int block_rows = ConvolutionCalibration::fftBlockLength(rows, kernel_size);
+    int block_cols = ConvolutionCalibration::fftBlockLength(cols, kernel_size);
+    Eigen::ArrayXXd kernel_block = Eigen::ArrayXXd::Zero(block_rows, block_cols);
+    kernel_block.topLeftCorner(kernel_size, kernel_size) = kernel.reverse();
+    return rdft2(kernel_block);
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with a kernel, in the frequency domain
+ * @details This function computes the same convolution as applyConvolution, as the product of the spectra of the image
+ * and of the kernel: O(n^2 log n), whatever the size of the kernel. The image is first extended by the kernel radius
+ * on each side according to the border mode. Small images are transformed in a single block; larger ones are split in
+ * overlapping blocks (overlap-save), so that the transforms stay small, and the blocks are transformed in batches
+ * (see rdft2). The result matches the direct convolution up to rounding errors.
+ * @param input Input image in the form of an array
+ * @param kernel Kernel to be used in the convolution
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @return Output image in the form of an array
+ */
+Eigen::ArrayXXd applyFFTConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel,
+                                    BorderMode border, double border_value) {
+    checkKernelSize(input.rows(), input.cols(), kernel.rows(), kernel.cols());
+    if (kernel.rows() != kernel.cols()) {
+        throw std::invalid_argument("Kernel must be square");
+    }
+    Eigen::ArrayXXcd kernel_spectrum = fftConvolutionKernelSpectrum(kernel, (int) input.rows(), (int) input.cols());
+    Eigen::ArrayXXd output(input.rows(), input.cols());
+    applyFFTConvolution(input, (int) kernel.rows(), kernel_spectrum, border, border_value, output);
+    return output;
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with a kernel, in the frequency domain
+ * @details See applyFFTConvolution. The spectrum of the kernel is given (see fftConvolutionKernelSpectrum), so that it
+ * is computed once for all the images of the same size (see ConvolutionPlan).
+ * @param input Input image in the form of an array
+ * @param kernel_size Size of the kernel
+ * @param kernel_spectrum Spectrum of the kernel, for images of the size of input
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param output Output image, with the size of input
+ * @return
  */
-Image applyConvolution(const Image& input, const Eigen::ArrayXXd& kernel) {
+void applyFFTConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, int kernel_size,
+                         const Eigen::ArrayXXcd& kernel_spectrum, BorderMode border, double border_value,
+                         Eigen::Ref<Eigen::ArrayXXd> output) {
+    int kernel_radius = (kernel_size - 1) / 2;
+    int input_rows = input.rows();
+    int input_cols = input.cols();
+    double value = border == BorderMode::Constant ? border_value : 0;
 
-    vector<Eigen::ArrayXXd> output = vector<Eigen::ArrayXXd>();
-    // apply the convolution independently to each channel
-    for (int i = 0; i < input.getChannels(); i++) {
-        output.push_back(applyConvolution(input.getData(i), kernel));
+    // extend the image beyond its edges
+    Eigen::ArrayXXd extended(input_rows + 2 * kernel_radius, input_cols + 2 * kernel_radius);
+    for (int j = 0; j < extended.cols(); j++) {
+        int input_j = borderIndex(j - kernel_radius, input_cols, border);
+        for (int i = 0; i < extended.rows(); i++) {
+            int input_i = borderIndex(i - kernel_radius, input_rows, border);
+            extended(i, j) = input_i >= 0 && input_j >= 0 ? input(input_i, input_j) : value;
+        }
     }
 
-    //normalize each channel to 0,1
-    for (int i = 0; i < input.getChannels(); i++) {
-        output[i] = normalize(output[i]);
+    int block_rows = ConvolutionCalibration::fftBlockLength(input_rows, kernel_size);
+    int block_cols = ConvolutionCalibration::fftBlockLength(input_cols, kernel_size);
+    int tile_rows = block_rows - kernel_size + 1;
+    int tile_cols = block_cols - kernel_size + 1;
+
+    vector<pair<int, int>> tiles;
+    for (int j0 = 0; j0 < input_cols; j0 += tile_cols) {
+        for (int i0 = 0; i0 < input_rows; i0 += tile_rows) {
+            tiles.emplace_back(i0, j0);
+        }
     }
 
-    return Image(output);
+    vector<Eigen::ArrayXXd> blocks;
+    for (size_t first = 0; first < tiles.size(); first += FFT_CONVOLUTION_BATCH) {
+        size_t count = min(tiles.size() - first, (size_t) FFT_CONVOLUTION_BATCH);
+        blocks.assign(count, Eigen::ArrayXXd::Zero(block_rows, block_cols));
+        for (size_t t = 0; t < count; t++) {
+            auto [i0, j0] = tiles[first + t];
+            int rows = min(block_rows, (int) extended.rows() - i0);
+            int cols = min(block_cols, (int) extended.cols() - j0);
+            blocks[t].topLeftCorner(rows, cols) = extended.block(i0, j0, rows, cols);
+        }
+        vector<Eigen::ArrayXXcd> spectra = rdft2(blocks);
+        for (auto& spectrum: spectra) {
+            spectrum *= kernel_spectrum;
+        }
+        blocks = irdft2(spectra, block_cols);
+        for (size_t t = 0; t < count; t++) {
+            auto [i0, j0] = tiles[first + t];
+            int rows = min(tile_rows, input_rows - i0);
+            int cols = min(tile_cols, input_cols - j0);
+            output.block(i0, j0, rows, cols) = blocks[t].block(kernel_size - 1, kernel_size - 1, rows, cols);
+        }
+    }
+}
+
+/*!
+ * @brief Function to compute the convolution of an image with a kernel
+ * @details This function computes the convolution of an image with a kernel. The kernel is assumed to be centered, and
+ * it must be odd in size and squared. The image is extended beyond its edges according to the border mode so that the
+ * output image has the same size as the input image. The bands of all channels are computed in parallel. Note: In
+ * order to return a valid image, the Image is normalized to [0,1] by default. The range of each channel is recorded
+ * while it is convolved, so normalizing only adds one in-place pass (see ConvolutionPlan::execute). The alpha channel,
+ * if any, is copied unchanged.
+ * @param input Input image in the form of an Image object (see Image.hpp)
+ * @param kernel Kernel to be used in the convolution
+ * @param border How the image is extended beyond its edges
+ * @param border_value Value of the pixels beyond the edges, for BorderMode::Constant
+ * @param method How the convolution is computed (see applyConvolution on arrays)
+ * @param normalize_output Whether to normalize each channel to [0,1], or keep the raw convolution values
+ * @return Output image in the form of an Image object
+ */
+Image applyConvolution(const Image& input, const Eigen::ArrayXXd& kernel, BorderMode border, double border_value,
+                       ConvolutionMethod method, bool normalize_output) {
+    ConvolutionPlan plan(input.getHeight(), input.getWidth(), kernel, border, border_value, method);
+    Image output(input.getWidth(), input.getHeight(), input.getChannels());
+    plan.execute(input, output, normalize_output);
+    return output;
 }
 
 // ------------------------------------ //
 // --- Gradient Specific Operations --- //
 // ------------------------------------ //
 
+/*!
+ * @brief Applies an operation on arrays to the gray levels of an image
+ * @details Single-channel images are passed without copies (see applyToChannel); other images are converted to
+ * grayscale first (see Image::reduceChannels).
+ * @param input Input image as an Image object
+ * @param operation Operation on arrays
+ * @return Result of the operation
+ */
+static Eigen::ArrayXXd applyToGrayLevels(const Image& input, const ArrayOperation& operation) {
+    if (input.getChannels() != 1) {
+        return applyToChannel(input.reduceChannels(), 0, operation);
+    }
+    return applyToChannel(input, 0, operation);
+}
+
 /*!
  * @brief Function to compute the gradient of an image along the x-axis
  * @details This function computes the x-axis gradient of an image. The gradient is computed using the Sobel operator.
@@ -108,20 +851,15 @@ Image applyConvolution(const Image& input, const Eigen::ArrayXXd& kernel) {
  * @return Output image as an Eigen::ArrayXXd
  */
 Eigen::ArrayXXd computeGradientX(const Image& input){
-    Image img_copy = input;
-    if (img_copy.getChannels() != 1) {
-        img_copy = img_copy.reduceChannels();
-    }
-
-    // initialize Sobel kernel, preserving pixel range
-    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Zero(3, 3);
-    kernel << -1, 0, 1,
-              -2, 0, 2,
-              -1, 0, 1;
+    // initialize Sobel kernel, preserving pixel range: [1, 2, 1]^T * [-1, 0, 1]
+    Eigen::ArrayXd column_kernel(3), row_kernel(3);
+    column_kernel << 1, 2, 1;
+    row_kernel << -1, 0, 1;
 
-    // apply convolution
-    Eigen::ArrayXXd output = applyConvolution(img_copy.getData(0), kernel);
-    return output;
+    // apply convolution, as two 1D passes, to the grayscale image
+    return applyToGrayLevels(input, [&](const Eigen::Ref<const Eigen::ArrayXXd>& gray) {
+        return applySeparableConvolution(gray, column_kernel, row_kernel);
+    });
 }
 
 /*!
@@ -131,22 +869,15 @@ Eigen::ArrayXXd computeGradientX(const Image& input){
  * @return Output image as an Eigen::ArrayXXd
  */
 Eigen::ArrayXXd computeGradientY(const Image& input){
-    Image img_copy = input;
+    // initialize Sobel kernel: [-1, 0, 1]^T * [1, 2, 1]
+    Eigen::ArrayXd column_kernel(3), row_kernel(3);
+    column_kernel << -1, 0, 1;
+    row_kernel << 1, 2, 1;
 
-    // convert to grayscale
-    if (img_copy.getChannels() != 1) {
-        img_copy = img_copy.reduceChannels();
-    }
-
-    // initialize Sobel kernel
-    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Zero(3, 3);
-    kernel << -1, -2, -1,
-               0,  0,  0,
-               1,  2,  1;
-
-    // apply convolution
-    Eigen::ArrayXXd output = applyConvolution(img_copy.getData(0), kernel);
-    return output;
+    // apply convolution, as two 1D passes, to the grayscale image
+    return applyToGrayLevels(input, [&](const Eigen::Ref<const Eigen::ArrayXXd>& gray) {
+        return applySeparableConvolution(gray, column_kernel, row_kernel);
+    });
 }
 
 /*!
@@ -157,16 +888,16 @@ Eigen::ArrayXXd computeGradientY(const Image& input){
  * @return Output image as an Eigen::ArrayXXd
  */
 Image computeGradientMagnitude(const Image& input){
+    // convert a color image to grayscale once for both directions
+    if (input.getChannels() != 1) {
+        return computeGradientMagnitude(input.reduceChannels());
+    }
+
     // compute gradient in x and y direction
     Eigen::ArrayXXd gradient_x = computeGradientX(input);
     Eigen::ArrayXXd gradient_y = computeGradientY(input);
 
-    Eigen::ArrayXXd output = Eigen::ArrayXXd::Zero(input.getHeight(), input.getWidth());
-    for (int i = 0; i < input.getHeight(); i++) {
-        for (int j = 0; j < input.getWidth(); j++) {
-            output(i, j) = sqrt(pow(gradient_x(i, j), 2) + pow(gradient_y(i, j), 2));
-        }
-    }
+    Eigen::ArrayXXd output = (gradient_x.square() + gradient_y.square()).sqrt();
 
     // normalize output to [0,1]
     output = normalize(output);
@@ -174,6 +905,33 @@ Image computeGradientMagnitude(const Image& input){
     return Image(output);
 }
 
+/*!
+ * @brief Function to compute the gradient magnitude of an image with compact pixels
+ * @details See computeGradientMagnitude on Image objects. The gray levels and the Sobel gradients are computed in
+ * single precision, and the magnitude is normalized to the range of the pixels.
+ * @param input Input image (see TypedImage)
+ * @return Single-channel output image, with the type and layout of the input
+ */
+template <typename T>
+TypedImage<T> computeGradientMagnitude(const TypedImage<T>& input) {
+    Eigen::ArrayXf smooth(3), derivative(3);
+    smooth << 1, 2, 1;
+    derivative << -1, 0, 1;
+    Eigen::ArrayXXf gray = input.grayLevels();
+    Eigen::ArrayXXf gradient_x = separableConvolutionFloat(gray, smooth, derivative, BorderMode::Zero, 0);
+    Eigen::ArrayXXf gradient_y = separableConvolutionFloat(gray, derivative, smooth, BorderMode::Zero, 0);
+    Eigen::ArrayXXf magnitude = (gradient_x.square() + gradient_y.square()).sqrt();
+
+    // normalize output to the range of the pixels (a flat magnitude, e.g. of a constant image, stays at zero)
+    float low = magnitude.minCoeff();
+    float high = magnitude.maxCoeff();
+    TypedImage<T> output(input.getWidth(), input.getHeight(), 1, input.getLayout());
+    if (high > low) {
+        output.setChannel(0, (magnitude - low) * ((float) TypedImage<T>::maxValue() / (high - low)));
+    }
+    return output;
+}
+
 /*!
  * @brief Function to compute the gradient direction of an image
  * @details This function computes the gradient magnitude of an image. The gradient along each direction is computed
@@ -186,15 +944,9 @@ Image computeGradientMagnitude(const Image& input){
     Eigen::ArrayXXd gradient_x = computeGradientX(input);
     Eigen::ArrayXXd gradient_y = computeGradientY(input);
 
-    // initialize output
-    Eigen::ArrayXXd output = Eigen::ArrayXXd::Zero(input.getHeight(), input.getWidth());
-
     // compute gradient direction
-    for (int i = 0; i < input.getHeight(); i++) {
-        for (int j = 0; j < input.getWidth(); j++) {
-            output(i, j) = atan2(gradient_y(i, j), gradient_x(i, j)) / (2 * M_PI) + 0.5;
-        }
-    }
+    Eigen::ArrayXXd output = gradient_y.binaryExpr(gradient_x, [](double y, double x) { return atan2(y, x); });
+    output = output / (2 * M_PI) + 0.5;
 
     return Image(output);
 }
@@ -207,21 +959,37 @@ Image computeGradientMagnitude(const Image& input){
  * @return Output image as an Image object
  */
 Image applyThreshold(const Image& input, double threshold) {
-    Image img_copy = input;
-    if (img_copy.getChannels() != 1) {
-        img_copy = img_copy.reduceChannels();
+    if (input.getChannels() != 1) {
+        return applyThreshold(input.reduceChannels(), threshold);
     }
-    Eigen::ArrayXXd img_data = img_copy.getData(0);
-    Eigen::ArrayXXd output = Eigen::ArrayXXd::Zero(input.getHeight(), input.getWidth());
+    Image output(input.getWidth(), input.getHeight(), 1);
+    output.getChannelView(0) = (input.getChannelView(0) > threshold).cast<double>();
+    return output;
+}
 
-    for (int i = 0; i < input.getHeight(); i++) {
-        for (int j = 0; j < input.getWidth(); j++) {
-            if (img_data(i, j) > threshold) {
-                output(i, j) = 1;
-            }
-        }
+/*!
+ * @brief Function to threshold an image with compact pixels
+ * @details See applyThreshold on Image objects. Single-channel images are compared in the type of their pixels,
+ * without conversion; the gray levels of other images are computed in single precision.
+ * @param input Input image (see TypedImage)
+ * @param threshold threshold value, relative to the range of the pixels (in [0, 1])
+ * @return Single-channel output image, with white pixels above the threshold and black pixels elsewhere
+ */
+template <typename T>
+TypedImage<T> applyThreshold(const TypedImage<T>& input, double threshold) {
+    T white = TypedImage<T>::maxValue();
+    double level = threshold * white;
+    TypedImage<T> output(input.getWidth(), input.getHeight(), 1, input.getLayout());
+    if (input.getChannels() != 1) {
+        output.setChannel(0, (input.grayLevels() > (float) level).template cast<float>() * (float) white);
+    } else if (level < 0) {
+        output.getChannelView(0).setConstant(white);
+    } else if (level < white) {
+        // for integers, pixel > level is pixel > floor(level)
+        T native_level = is_integral_v<T> ? (T) floor(level) : (T) level;
+        output.getChannelView(0) = (input.getChannelView(0) > native_level).template cast<T>() * white;
     }
-    return Image(output);
+    return output;
 }
 
 // ------------------------------------ //
@@ -229,54 +997,173 @@ Image applyThreshold(const Image& input, double threshold) {
 // ------------------------------------ //
 
 /*!
- * @brief Function to compute the Fourier transform of a 1D signal
- * @details This function computes the Fourier transform of a 1D complex double Eigen Array.
- * The frequency domain has its origin at the center of the array.
- * @param input Input signal
- * @param inverse Boolean to indicate whether to compute the inverse Fourier transform.
- * @return Output signal as an Eigen::ArrayXcd
+ * @brief Computes a centered 1D transform in place with the given plan.
+ * @details The frequency origin is moved between index 0 (used by the plan) and the center of the array (index N/2),
+ * and the inverse transform is normalized by 1/N.
+ * @param plan Plan for the length and direction of the transform
+ * @param data Signal to transform, with plan.getLength() elements
  */
-Eigen::ArrayXcd dft(Eigen::ArrayXcd input, bool inverse){
-    int N = input.size();
-    Eigen::ArrayXcd output = Eigen::ArrayXcd::Zero(N);
-
-    complex<double> omega;
-    // frequency domain origin is at the center of the array
-    int k_min = -N/2;
-    int k_max = N/2 - 1;
-    int n_min = 0;
-    int n_max = N - 1;
-    if (inverse){
-        n_min = -N/2;
-        n_max = N/2 - 1;
-        k_min = 0;
-        k_max = N - 1;
-    }
-
-    for (int k = k_min; k <= k_max; k++) {
-        for (int n = n_min; n <= n_max; n++) {
-            if (inverse) {
-                omega = exp(complex<double>(0, 2 * M_PI * (k*n)/ N));
-            } else {
-                omega = exp(complex<double>(0, -2 * M_PI * (k*n) / N));
-            }
-            output(k - k_min) += input(n-n_min) * omega;
+void centeredTransform(const FFTPlan& plan, complex<double>* data) {
+    int N = plan.getLength();
+    int shift = N / 2;
+    if (plan.isInverse()) {
+        // move the frequency origin from the center back to index 0
+        rotate(data, data + shift, data + N);
+        plan.execute(data);
+        for (int i = 0; i < N; i++) {
+            data[i] /= N;
         }
+    } else {
+        plan.execute(data);
+        // move the frequency origin to the center of the array
+        rotate(data, data + N - shift, data + N);
     }
+}
 
+/*!
+ * @brief Creates the progress callback of a parallel pass over rows or columns.
+ * @param show_progress Whether progress should be printed. If not, an empty callback is returned.
+ * @param what Name of the items being processed (e.g. "rows").
+ * @return Callback printing the number of items done, to be passed to ThreadPool::parallelFor.
+ */
+function<void(int, int)> progressPrinter(bool show_progress, const string& what) {
+    if (!show_progress) {
+        return nullptr;
+    }
+    return [what](int done, int total) {
+        cout << "\rComputing " << what << ": " << done << " of " << total << flush;
+        if (done == total) {
+            cout << endl;
+        }
+    };
+}
+
+// Number of rows transposed together by the row passes of the 2D transforms. In column-major storage, 16 consecutive
+// rows of a column share two or four cache lines, so each cache line read or written is used entirely.
+static const int ROW_BLOCK = 16;
 
+/*!
+ * @brief Transposes a block of rows of a column-major array into a buffer.
+ * @details Row i0 + r of the input becomes column r of the buffer, so that it can be transformed in contiguous memory.
+ * The loop reads ROW_BLOCK consecutive elements of each column at a time, instead of striding over the array once per
+ * row.
+ * @param input Input array
+ * @param i0 First row of the block
+ * @param count Number of rows in the block (at most ROW_BLOCK)
+ * @param buffer Buffer with at least (input.cols(), count) elements
+ */
+template <typename In, typename Out>
+static void transposeRowBlock(const Eigen::ArrayBase<In>& input, int i0, int count, Eigen::ArrayBase<Out>& buffer) {
+    for (int j = 0; j < input.cols(); j++) {
+        for (int r = 0; r < count; r++) {
+            buffer(j, r) = input(i0 + r, j);
+        }
+    }
+}
 
-    if (inverse) {
-        output /= N;
+/*!
+ * @brief Transposes a buffer back into a block of rows of a column-major array.
+ * @details Inverse of transposeRowBlock: column r of the buffer becomes row i0 + r of the output.
+ * @param buffer Buffer with at least (output.cols(), count) elements
+ * @param i0 First row of the block
+ * @param count Number of rows in the block (at most ROW_BLOCK)
+ * @param output Output array
+ */
+template <typename In, typename Out>
+static void transposeRowBlockBack(const Eigen::ArrayBase<In>& buffer, int i0, int count, Eigen::ArrayBase<Out>& output) {
+    for (int j = 0; j < output.cols(); j++) {
+        for (int r = 0; r < count; r++) {
+            output(i0 + r, j) = buffer(j, r);
+        }
     }
+}
 
-    return output;
+/*!
+ * @brief Computes the half spectra of two real rows with a single complex FFT.
+ * @details The rows a and b are packed as z = a + i*b, transformed, and separated using
+ * A(k) = (Z(k) + conj(Z(-k))) / 2 and B(k) = (Z(k) - conj(Z(-k))) / 2i. Only the frequencies 0 .. M/2 are written.
+ * @param plan Forward plan of length M
+ * @param a First real row, with M elements
+ * @param b Second real row, with M elements. Can be null, in which case only A is computed.
+ * @param A Output half spectrum of a, with M/2 + 1 elements
+ * @param B Output half spectrum of b, with M/2 + 1 elements (ignored if b is null)
+ * @param buffer Work buffer with M elements
+ */
+void realPairTransform(const FFTPlan& plan, const double* a, const double* b, complex<double>* A, complex<double>* B,
+                       complex<double>* buffer) {
+    int M = plan.getLength();
+    for (int j = 0; j < M; j++) {
+        buffer[j] = complex<double>(a[j], b ? b[j] : 0.);
+    }
+    plan.execute(buffer);
+    for (int k = 0; k < M / 2 + 1; k++) {
+        complex<double> z = buffer[k];
+        complex<double> z_conj = conj(buffer[(M - k) % M]);
+        A[k] = 0.5 * (z + z_conj);
+        if (b) {
+            B[k] = complex<double>(0, -0.5) * (z - z_conj);
+        }
+    }
+}
+
+/*!
+ * @brief Computes two real rows from their half spectra with a single complex inverse FFT.
+ * @details Inverse of realPairTransform. The missing frequencies are recovered by symmetry, the spectra are packed as
+ * Z = A + i*B, and ifft(Z) = a + i*b. The output is normalized by 1/M.
+ * @param plan Inverse plan of length M
+ * @param A Half spectrum of the first row, with M/2 + 1 elements
+ * @param B Half spectrum of the second row, with M/2 + 1 elements. Can be null, in which case only a is computed.
+ * @param a Output first real row, with M elements
+ * @param b Output second real row, with M elements (ignored if B is null)
+ * @param buffer Work buffer with M elements
+ */
+void realPairInverseTransform(const FFTPlan& plan, const complex<double>* A, const complex<double>* B, double* a,
+                              double* b, complex<double>* buffer) {
+    int M = plan.getLength();
+    int H = M / 2 + 1;
+    auto fullSpectrum = [M, H](const complex<double>* half, int k) -> complex<double> {
+        if (k == 0 || 2 * k == M) {
+            // bins that are their own symmetric must be real
+            return half[k].real();
+        }
+        return k < H ? half[k] : conj(half[M - k]);
+    };
+    for (int k = 0; k < M; k++) {
+        buffer[k] = fullSpectrum(A, k);
+        if (B) {
+            buffer[k] += complex<double>(0, 1) * fullSpectrum(B, k);
+        }
+    }
+    plan.execute(buffer);
+    for (int j = 0; j < M; j++) {
+        a[j] = buffer[j].real() / M;
+        if (B) {
+            b[j] = buffer[j].imag() / M;
+        }
+    }
+}
+
+/*!
+ * @brief Function to compute the Fourier transform of a 1D signal
+ * @details This function computes the Fourier transform of a 1D complex double Eigen Array, using a fast Fourier
+ * transform (O(N log N) for any length N). The plan for the length is taken from the FFTPlan cache.
+ * The frequency domain has its origin at the center of the array: output index m corresponds to frequency m - N/2.
+ * @param input Input signal
+ * @param inverse Boolean to indicate whether to compute the inverse Fourier transform.
+ * @return Output signal as an Eigen::ArrayXcd
+ */
+Eigen::ArrayXcd dft(Eigen::ArrayXcd input, bool inverse){
+    centeredTransform(*FFTPlan::get((int) input.size(), inverse), input.data());
+    return input;
 }
 
 /*!
  * @brief Function to compute the Fourier transform of a 2D signal
  * @details This function computes the Fourier transform of a 2D complex Eigen Array. It casts the output to a complex double.
- * The 2D DFT is computed by first computing the 1D DFT along each row, and then computing the 1D DFT along each column.
+ * The 2D DFT is computed by first computing the 1D DFT along each column, and then along each row. Every 1D transform
+ * runs on contiguous memory: columns are transformed in place, and rows are transformed in blocks of ROW_BLOCK rows,
+ * which are transposed into a per-worker buffer and back (a tiled transpose). Both passes run in parallel on the global
+ * thread pool.
  * @param input Input signal
  * @param inverse Boolean to indicate whether to compute the inverse Fourier transform.
  * @param show_progress Boolean to indicate whether to print progress.
@@ -285,32 +1172,303 @@ Eigen::ArrayXcd dft(Eigen::ArrayXcd input, bool inverse){
 Eigen::ArrayXXcd dft2(Eigen::ArrayXXcd input, bool inverse, bool show_progress){
     int N = input.rows();
     int M = input.cols();
-    Eigen::ArrayXXcd output = Eigen::ArrayXXcd::Zero(N, M);
-    Eigen::ArrayXcd row = Eigen::ArrayXcd::Zero(N);
-    Eigen::ArrayXcd col = Eigen::ArrayXcd::Zero(M);
+    ThreadPool& pool = ThreadPool::global();
+    vector<Eigen::ArrayXXcd> buffers(pool.getNumThreads(), Eigen::ArrayXXcd(M, ROW_BLOCK));
+    shared_ptr<const FFTPlan> row_plan = FFTPlan::get(M, inverse);
+    shared_ptr<const FFTPlan> col_plan = FFTPlan::get(N, inverse);
+
+    pool.parallelFor(0, M, [&](int, int j) {
+        centeredTransform(*col_plan, input.col(j).data());
+    }, progressPrinter(show_progress, "columns"));
+
+    int blocks = (N + ROW_BLOCK - 1) / ROW_BLOCK;
+    pool.parallelFor(0, blocks, [&](int worker, int block) {
+        Eigen::ArrayXXcd& buffer = buffers[worker];
+        int i0 = block * ROW_BLOCK;
+        int count = min(ROW_BLOCK, N - i0);
+        transposeRowBlock(input, i0, count, buffer);
+        for (int r = 0; r < count; r++) {
+            centeredTransform(*row_plan, buffer.col(r).data());
+        }
+        transposeRowBlockBack(buffer, i0, count, input);
+    }, progressPrinter(show_progress, "row blocks"));
 
-    for (int i = 0; i < N; i++){
-        if (show_progress) {
-            cout << "\rComputing row " << i << " of " << N << flush;
+    return input;
+}
+
+/*!
+ * @brief Computes the half spectra of several real 2D signals of the same size in one batch.
+ * @details Implementation of rdft2 for one or more signals (e.g. the channels of an image). The plans and the per-worker
+ * buffers are shared by all signals, and each pass is a single parallel loop over the blocks (or columns) of all
+ * signals, so the workers are only synchronized twice for the whole batch.
+ * @param inputs Pointers to the input signals. They must all have the same size.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Half spectra of the signals, in the same order.
+ */
+static vector<Eigen::ArrayXXcd> rdft2Batch(const vector<Eigen::Ref<const Eigen::ArrayXXd>>& inputs,
+                                           bool show_progress) {
+    int C = (int) inputs.size();
+    int N = C > 0 ? (int) inputs[0].rows() : 0;
+    int M = C > 0 ? (int) inputs[0].cols() : 0;
+    int H = M / 2 + 1;
+    for (const auto& input: inputs) {
+        if (input.rows() != N || input.cols() != M) {
+            throw std::invalid_argument("All signals of a batch must have the same size");
         }
-        row = input.row(i);
-        output.row(i) = dft(row, inverse);
     }
+    vector<Eigen::ArrayXXcd> outputs(C, Eigen::ArrayXXcd(N, H));
+    ThreadPool& pool = ThreadPool::global();
+    vector<Eigen::ArrayXXd> rows(pool.getNumThreads(), Eigen::ArrayXXd(M, ROW_BLOCK));
+    vector<Eigen::ArrayXXcd> spectra(pool.getNumThreads(), Eigen::ArrayXXcd(H, ROW_BLOCK));
+    vector<Eigen::ArrayXcd> buffers(pool.getNumThreads(), Eigen::ArrayXcd(M));
+    shared_ptr<const FFTPlan> row_plan = FFTPlan::get(M, false);
+    shared_ptr<const FFTPlan> col_plan = FFTPlan::get(N, false);
+
+    // two real rows are transformed at once (see realPairTransform)
+    int blocks = (N + ROW_BLOCK - 1) / ROW_BLOCK;
+    pool.parallelFor(0, C * blocks, [&](int worker, int item) {
+        const Eigen::Ref<const Eigen::ArrayXXd>& input = inputs[item / blocks];
+        Eigen::ArrayXXd& block_rows = rows[worker];
+        Eigen::ArrayXXcd& block_spectra = spectra[worker];
+        int i0 = (item % blocks) * ROW_BLOCK;
+        int count = min(ROW_BLOCK, N - i0);
+        transposeRowBlock(input, i0, count, block_rows);
+        for (int r = 0; r < count; r += 2) {
+            bool has_pair = r + 1 < count;
+            realPairTransform(*row_plan, block_rows.col(r).data(), has_pair ? block_rows.col(r + 1).data() : nullptr,
+                              block_spectra.col(r).data(), has_pair ? block_spectra.col(r + 1).data() : nullptr,
+                              buffers[worker].data());
+        }
+        transposeRowBlockBack(block_spectra, i0, count, outputs[item / blocks]);
+    }, progressPrinter(show_progress, "row blocks"));
+
+    // columns are contiguous in memory, so they are transformed in place
+    pool.parallelFor(0, C * H, [&](int, int item) {
+        centeredTransform(*col_plan, outputs[item / H].col(item % H).data());
+    }, progressPrinter(show_progress, "columns"));
 
-    if (show_progress) cout << endl;
+    return outputs;
+}
 
-    for (int j = 0; j < M; j++){
-        if (show_progress) {
-            cout << "\rComputing column " << j << " of " << M << flush;
+/*!
+ * @brief Function to compute the Fourier transform of a real 2D signal
+ * @details This function computes the Fourier transform of a real 2D Eigen Array, exploiting its Hermitian symmetry
+ * (F(-u, -v) = conj(F(u, v))). Only the non-redundant half of the spectrum is computed and returned: all the row
+ * frequencies (centered, as in dft2) and the non-negative column frequencies 0 .. cols/2. The row pass transforms two
+ * real rows with a single complex FFT, and the column pass only runs on the cols/2 + 1 columns that are kept, so the
+ * cost and memory are about half of dft2. Use expandHalfSpectrum to get the full spectrum.
+ * As in dft2, all 1D transforms run on contiguous memory, with rows going through tiled transposes.
+ * @param input Input signal
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Half spectrum as an Eigen::ArrayXXcd with (rows, cols/2 + 1) elements. Column j holds column frequency j.
+ */
+Eigen::ArrayXXcd rdft2(const Eigen::Ref<const Eigen::ArrayXXd>& input, bool show_progress){
+    return std::move(rdft2Batch({input}, show_progress)[0]);
+}
+
+/*!
+ * @brief Function to compute the Fourier transforms of several real 2D signals
+ * @details Same as rdft2 for each signal, but all signals (e.g. the channels of an image) are transformed in one batch
+ * that shares plans, buffers and parallel loops.
+ * @param inputs Input signals. They must all have the same size.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Half spectra of the signals, in the same order.
+ */
+vector<Eigen::ArrayXXcd> rdft2(const vector<Eigen::ArrayXXd>& inputs, bool show_progress){
+    vector<Eigen::Ref<const Eigen::ArrayXXd>> views;
+    for (const auto& input: inputs) {
+        views.emplace_back(input);
+    }
+    return rdft2Batch(views, show_progress);
+}
+
+/*!
+ * @brief Function to compute the Fourier transforms of several real 2D signals given as views
+ * @details Same as rdft2 on a vector of arrays, but the signals are read in place (e.g. the channels of an image, see
+ * Image::getColumnMajorView), without being copied.
+ * @param inputs Views of the input signals. They must all have the same size.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Half spectra of the signals, in the same order.
+ */
+vector<Eigen::ArrayXXcd> rdft2(const vector<Eigen::Ref<const Eigen::ArrayXXd>>& inputs, bool show_progress){
+    return rdft2Batch(inputs, show_progress);
+}
+
+/*!
+ * @brief Computes several real 2D signals from their half spectra in one batch.
+ * @details Implementation of irdft2 for one or more half spectra, sharing plans, buffers and parallel loops (see
+ * rdft2Batch). The inputs are copied column by column into the working spectra by the column pass, optionally
+ * multiplied by a mask on the way, so filtering costs no extra pass over the spectra.
+ * @param inputs Views of the half spectra. They must all have the same size.
+ * @param masks Masks to multiply the inputs by, one per input, or empty for no masks.
+ * @param cols Number of columns of the real signals.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Real signals, in the same order.
+ */
+static vector<Eigen::ArrayXXd> irdft2Batch(const vector<Eigen::Map<const Eigen::ArrayXXcd>>& inputs,
+                                           const vector<shared_ptr<const Eigen::ArrayXXd>>& masks, int cols,
+                                           bool show_progress) {
+    int C = (int) inputs.size();
+    int N = C > 0 ? (int) inputs[0].rows() : 0;
+    int M = cols;
+    int H = M / 2 + 1;
+    for (const auto& input: inputs) {
+        if (input.cols() != H) {
+            throw std::invalid_argument("Half spectrum must have cols/2 + 1 columns");
         }
-        col = output.col(j);
-        output.col(j) = dft(col, inverse);
+        if (input.rows() != N) {
+            throw std::invalid_argument("All signals of a batch must have the same size");
+        }
+    }
+    if (!masks.empty() && (int) masks.size() != C) {
+        throw std::invalid_argument("There must be one mask per half spectrum");
     }
-    if (show_progress){
-        cout << endl;
+    for (const auto& mask: masks) {
+        if (mask->rows() != N || mask->cols() != H) {
+            throw std::invalid_argument("Masks must have the size of the half spectra");
+        }
     }
+    vector<Eigen::ArrayXXcd> halves(C, Eigen::ArrayXXcd(N, H));
+    vector<Eigen::ArrayXXd> outputs(C, Eigen::ArrayXXd(N, M));
+    ThreadPool& pool = ThreadPool::global();
+    vector<Eigen::ArrayXXcd> spectra(pool.getNumThreads(), Eigen::ArrayXXcd(H, ROW_BLOCK));
+    vector<Eigen::ArrayXXd> rows(pool.getNumThreads(), Eigen::ArrayXXd(M, ROW_BLOCK));
+    vector<Eigen::ArrayXcd> buffers(pool.getNumThreads(), Eigen::ArrayXcd(M));
+    shared_ptr<const FFTPlan> row_plan = FFTPlan::get(M, true);
+    shared_ptr<const FFTPlan> col_plan = FFTPlan::get(N, true);
 
-    return output;
+    pool.parallelFor(0, C * H, [&](int, int item) {
+        int c = item / H;
+        int j = item % H;
+        if (masks.empty()) {
+            halves[c].col(j) = inputs[c].col(j);
+        } else {
+            halves[c].col(j) = inputs[c].col(j) * masks[c]->col(j);
+        }
+        centeredTransform(*col_plan, halves[c].col(j).data());
+    }, progressPrinter(show_progress, "columns"));
+
+    // two real rows are computed at once (see realPairInverseTransform)
+    int blocks = (N + ROW_BLOCK - 1) / ROW_BLOCK;
+    pool.parallelFor(0, C * blocks, [&](int worker, int item) {
+        Eigen::ArrayXXcd& block_spectra = spectra[worker];
+        Eigen::ArrayXXd& block_rows = rows[worker];
+        int i0 = (item % blocks) * ROW_BLOCK;
+        int count = min(ROW_BLOCK, N - i0);
+        transposeRowBlock(halves[item / blocks], i0, count, block_spectra);
+        for (int r = 0; r < count; r += 2) {
+            bool has_pair = r + 1 < count;
+            realPairInverseTransform(*row_plan, block_spectra.col(r).data(),
+                                     has_pair ? block_spectra.col(r + 1).data() : nullptr, block_rows.col(r).data(),
+                                     has_pair ? block_rows.col(r + 1).data() : nullptr, buffers[worker].data());
+        }
+        transposeRowBlockBack(block_rows, i0, count, outputs[item / blocks]);
+    }, progressPrinter(show_progress, "row blocks"));
+
+    return outputs;
 }
 
+/*!
+ * @brief Function to compute the inverse Fourier transform of a half spectrum
+ * @details This function is the inverse of rdft2: it takes the non-redundant half of a Hermitian spectrum and returns
+ * the real 2D signal. The missing column frequencies are recovered by symmetry, and two real rows are computed with a
+ * single complex inverse FFT. As in rdft2, all 1D transforms run on contiguous memory.
+ * @param input Half spectrum, with (rows, cols/2 + 1) elements (see rdft2)
+ * @param cols Number of columns of the real signal (needed because cols/2 + 1 does not determine its parity)
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Real signal as an Eigen::ArrayXXd with (rows, cols) elements
+ */
+Eigen::ArrayXXd irdft2(const Eigen::ArrayXXcd& input, int cols, bool show_progress){
+    return std::move(irdft2Batch({Eigen::Map<const Eigen::ArrayXXcd>(input.data(), input.rows(), input.cols())}, {},
+                                 cols, show_progress)[0]);
+}
+
+/*!
+ * @brief Function to compute the inverse Fourier transforms of several half spectra
+ * @details Same as irdft2 for each half spectrum, but all of them are transformed in one batch that shares plans,
+ * buffers and parallel loops.
+ * @param inputs Half spectra. They must all have the same size.
+ * @param cols Number of columns of the real signals.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Real signals, in the same order.
+ */
+vector<Eigen::ArrayXXd> irdft2(const vector<Eigen::ArrayXXcd>& inputs, int cols, bool show_progress){
+    vector<Eigen::Map<const Eigen::ArrayXXcd>> views;
+    for (const auto& input: inputs) {
+        views.emplace_back(input.data(), input.rows(), input.cols());
+    }
+    return irdft2Batch(views, {}, cols, show_progress);
+}
+
+/*!
+ * @brief Function to compute the inverse Fourier transforms of several half spectra held in external memory
+ * @details Same as the irdft2 overload taking arrays, for spectra that are not owned by Eigen arrays (e.g. spectra
+ * mapped from a file). The inputs are not modified.
+ * @param inputs Views of the half spectra. They must all have the same size.
+ * @param cols Number of columns of the real signals.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Real signals, in the same order.
+ */
+vector<Eigen::ArrayXXd> irdft2(const vector<Eigen::Map<const Eigen::ArrayXXcd>>& inputs, int cols, bool show_progress){
+    return irdft2Batch(inputs, {}, cols, show_progress);
+}
+
+/*!
+ * @brief Function to compute the inverse Fourier transforms of several masked half spectra
+ * @details Computes irdft2(inputs[i] * masks[i]) for every i in one batch, without modifying or copying the inputs
+ * beforehand: each mask is applied while its spectrum is loaded into the working buffers. The same input (or mask)
+ * can appear several times, e.g. to apply a bank of filters to one spectrum.
+ * @param inputs Views of the half spectra. They must all have the same size.
+ * @param masks Masks with the size of the half spectra, one per input.
+ * @param cols Number of columns of the real signals.
+ * @param show_progress Boolean to indicate whether to print progress.
+ * @return Real signals, in the same order.
+ */
+vector<Eigen::ArrayXXd> maskedIrdft2(const vector<Eigen::Map<const Eigen::ArrayXXcd>>& inputs,
+                                     const vector<shared_ptr<const Eigen::ArrayXXd>>& masks, int cols,
+                                     bool show_progress){
+    if (masks.size() != inputs.size()) {
+        throw std::invalid_argument("There must be one mask per half spectrum");
+    }
+    return irdft2Batch(inputs, masks, cols, show_progress);
+}
+
+/*!
+ * @brief Function to recover the full spectrum from a half spectrum
+ * @details Fills the negative column frequencies of a half spectrum (see rdft2) using its Hermitian symmetry, and
+ * returns the full spectrum with the same (centered) convention as dft2.
+ * @param half Half spectrum, with (rows, cols/2 + 1) elements
+ * @param cols Number of columns of the full spectrum
+ * @return Full spectrum as an Eigen::ArrayXXcd with (rows, cols) elements
+ */
+Eigen::ArrayXXcd expandHalfSpectrum(const Eigen::Ref<const Eigen::ArrayXXcd>& half, int cols){
+    int N = half.rows();
+    int M = cols;
+    if (half.cols() != M / 2 + 1) {
+        throw std::invalid_argument("Half spectrum must have cols/2 + 1 columns");
+    }
+    Eigen::ArrayXXcd output(N, M);
+    for (int j = 0; j < M; j++) {
+        int v = j - M / 2;
+        for (int i = 0; i < N; i++) {
+            if (v >= 0) {
+                output(i, j) = half(i, v);
+            } else {
+                // row of frequency -u, for the row i of frequency u = i - N/2
+                int i_mirror = (2 * (N / 2) - i) % N;
+                output(i, j) = conj(half(i_mirror, -v));
+            }
+        }
+    }
+    return output;
+}
 
+template TypedImage<uint8_t> applySeparableConvolution<uint8_t>(const TypedImage<uint8_t>& input, const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value);
+template TypedImage<uint16_t> applySeparableConvolution<uint16_t>(const TypedImage<uint16_t>& input, const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value);
+template TypedImage<float> applySeparableConvolution<float>(const TypedImage<float>& input, const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value);
+template TypedImage<uint8_t> computeGradientMagnitude<uint8_t>(const TypedImage<uint8_t>& input);
+template TypedImage<uint16_t> computeGradientMagnitude<uint16_t>(const TypedImage<uint16_t>& input);
+template TypedImage<float> computeGradientMagnitude<float>(const TypedImage<float>& input);
+template TypedImage<uint8_t> applyThreshold<uint8_t>(const TypedImage<uint8_t>& input, double threshold);
+template TypedImage<uint16_t> applyThreshold<uint16_t>(const TypedImage<uint16_t>& input, double threshold);
+template TypedImage<float> applyThreshold<float>(const TypedImage<float>& input, double threshold);
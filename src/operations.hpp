@@ -7,28 +7,123 @@
 
 
 #include <Eigen/Eigen>
+#include <functional>
 #include <vector>
 #include "Image.hpp"
+#include "TypedImage.hpp"
+#include "FFTPlan.hpp"
 
 // General //
 template <typename T>
 Eigen::ArrayXXd normalize(const Eigen::ArrayBase<T>& input);
+function<void(int, int)> progressPrinter(bool show_progress, const string& what);
 
 
 // Convolution //
-Eigen::ArrayXXd applyConvolution(Eigen::ArrayXXd input, Eigen::ArrayXXd kernel);
-Image applyConvolution(const Image& input, const Eigen::ArrayXXd& kernel);
+// Number of output columns computed by each task of the parallel convolutions
+const int CONVOLUTION_BAND = 16;
+/**
+ * @brief How an image is extended beyond its edges by the convolutions.
+ */
+enum class BorderMode {
+    Zero,      ///< 000|abcd|000
+    Constant,  ///< vvv|abcd|vvv, for a given value v
+    Reflect,   ///< dcb|abcd|cba, mirrored around the edge pixels
+    Replicate, ///< aaa|abcd|ddd
+    Wrap       ///< bcd|abcd|abc, periodic
+};
+/**
+ * @brief How a convolution is computed.
+ */
+enum class ConvolutionMethod {
+    Auto,      ///< The fastest of the others, predicted from the host calibration (see ConvolutionCalibration)
+    Direct,    ///< k^2 multiply-adds per pixel
+    Separable, ///< Two 1D passes, 2k multiply-adds per pixel, for rank-1 kernels only
+    FFT        ///< Product of the spectra, in overlapping blocks for large images
+};
+Eigen::ArrayXXd applyConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel,
+                                 BorderMode border = BorderMode::Zero, double border_value = 0,
+                                 ConvolutionMethod method = ConvolutionMethod::Auto);
+Image applyConvolution(const Image& input, const Eigen::ArrayXXd& kernel, BorderMode border = BorderMode::Zero,
+                       double border_value = 0, ConvolutionMethod method = ConvolutionMethod::Auto,
+                       bool normalize_output = true);
+Eigen::ArrayXXd applyFFTConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel,
+                                    BorderMode border = BorderMode::Zero, double border_value = 0);
+Eigen::ArrayXXcd fftConvolutionKernelSpectrum(const Eigen::ArrayXXd& kernel, int rows, int cols);
+void applyFFTConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input, int kernel_size,
+                         const Eigen::ArrayXXcd& kernel_spectrum, BorderMode border, double border_value,
+                         Eigen::Ref<Eigen::ArrayXXd> output);
+bool separateKernel(const Eigen::ArrayXXd& kernel, Eigen::ArrayXd& column_kernel, Eigen::ArrayXd& row_kernel);
+Eigen::ArrayXXd applySeparableConvolution(const Eigen::Ref<const Eigen::ArrayXXd>& input,
+                                          const Eigen::ArrayXd& column_kernel, const Eigen::ArrayXd& row_kernel,
+                                          BorderMode border = BorderMode::Zero, double border_value = 0);
+Image applySeparableConvolution(const Image& input, const Eigen::ArrayXd& column_kernel,
+                                const Eigen::ArrayXd& row_kernel, BorderMode border = BorderMode::Zero,
+                                double border_value = 0, bool normalize_output = true);
+/**
+ * @brief Buffers used to compute the columns of a convolution, owned by each task.
+ */
+template <typename Scalar>
+struct BasicColumnScratch {
+    vector<const Scalar*> sources;                      ///< Input streams of weightedSum.
+    vector<Scalar> weights;                             ///< Weights of weightedSum.
+    Eigen::Array<Scalar, Eigen::Dynamic, 1> horizontal; ///< Result of the horizontal pass of a separable convolution.
+};
+typedef BasicColumnScratch<double> ColumnScratch;
+void checkKernelSize(Eigen::Index rows, Eigen::Index cols, Eigen::Index kernel_rows, Eigen::Index kernel_cols);
+void directColumn(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXXd& kernel, BorderMode border,
+                  double border_value, int j, ColumnScratch& scratch, Eigen::Ref<Eigen::ArrayXXd> output);
+void separableColumn(const Eigen::Ref<const Eigen::ArrayXXd>& input, const Eigen::ArrayXd& column_kernel,
+                     const Eigen::ArrayXd& row_kernel, BorderMode border, double border_value, int j,
+                     ColumnScratch& scratch, Eigen::Ref<Eigen::ArrayXXd> output);
+void separableColumn(const Eigen::Ref<const Eigen::ArrayXXf>& input, const Eigen::ArrayXf& column_kernel,
+                     const Eigen::ArrayXf& row_kernel, BorderMode border, float border_value, int j,
+                     BasicColumnScratch<float>& scratch, Eigen::Ref<Eigen::ArrayXXf> output);
+template <typename T>
+TypedImage<T> applySeparableConvolution(const TypedImage<T>& input, const Eigen::ArrayXd& column_kernel,
+                                        const Eigen::ArrayXd& row_kernel, BorderMode border = BorderMode::Zero,
+                                        double border_value = 0);
+Eigen::ArrayXXd applyBoxFilter(const Eigen::Ref<const Eigen::ArrayXXd>& input, int size,
+                               BorderMode border = BorderMode::Zero, double border_value = 0);
+Image applyBoxFilter(const Image& input, int size, BorderMode border = BorderMode::Zero, double border_value = 0);
+Eigen::ArrayXXd applyRecursiveGaussian(const Eigen::Ref<const Eigen::ArrayXXd>& input, double sigma);
+Image applyRecursiveGaussian(const Image& input, double sigma);
+/**
+ * @brief Operation on an array, applied to the channels of images by applyToChannel.
+ */
+typedef function<Eigen::ArrayXXd(const Eigen::Ref<const Eigen::ArrayXXd>&)> ArrayOperation;
+Eigen::ArrayXXd applyToChannel(const Image& input, int channel, const ArrayOperation& operation);
 
 // Contour Extractor //
 Eigen::ArrayXXd computeGradientX(const Image& input);
 Eigen::ArrayXXd computeGradientY(const Image& input);
 Image computeGradientMagnitude(const Image& input);
+template <typename T>
+TypedImage<T> computeGradientMagnitude(const TypedImage<T>& input);
 
 [[maybe_unused]] Image computeGradientDirection(const Image& input);
 Image applyThreshold(const Image& input, double threshold);
+template <typename T>
+TypedImage<T> applyThreshold(const TypedImage<T>& input, double threshold);
 
 // Fourier Transform //
+void centeredTransform(const FFTPlan& plan, complex<double>* data);
+void realPairTransform(const FFTPlan& plan, const double* a, const double* b, complex<double>* A, complex<double>* B,
+                       complex<double>* buffer);
+void realPairInverseTransform(const FFTPlan& plan, const complex<double>* A, const complex<double>* B, double* a,
+                              double* b, complex<double>* buffer);
 Eigen::ArrayXcd dft(Eigen::ArrayXcd input, bool inverse = false);
 Eigen::ArrayXXcd dft2(Eigen::ArrayXXcd input, bool inverse = false, bool show_progress = false);
+Eigen::ArrayXXcd rdft2(const Eigen::Ref<const Eigen::ArrayXXd>& input, bool show_progress = false);
+Eigen::ArrayXXd irdft2(const Eigen::ArrayXXcd& input, int cols, bool show_progress = false);
+vector<Eigen::ArrayXXcd> rdft2(const vector<Eigen::ArrayXXd>& inputs, bool show_progress = false);
+vector<Eigen::ArrayXXcd> rdft2(const vector<Eigen::Ref<const Eigen::ArrayXXd>>& inputs, bool show_progress = false);
+vector<Eigen::ArrayXXd> irdft2(const vector<Eigen::ArrayXXcd>& inputs, int cols, bool show_progress = false);
+vector<Eigen::ArrayXXd> irdft2(const vector<Eigen::Map<const Eigen::ArrayXXcd>>& inputs, int cols,
+                               bool show_progress = false);
+vector<Eigen::ArrayXXd> maskedIrdft2(const vector<Eigen::Map<const Eigen::ArrayXXcd>>& inputs,
+                                     const vector<shared_ptr<const Eigen::ArrayXXd>>& masks, int cols,
+                                     bool show_progress = false);
+Eigen::ArrayXXcd expandHalfSpectrum(const Eigen::Ref<const Eigen::ArrayXXcd>& half, int cols);
 
 #endif //IMAGE_PROCESSING_OPERATIONS_HPP
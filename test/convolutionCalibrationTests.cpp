@@ -0,0 +1,72 @@
+//
+// Tests for the FFT convolution and the choice of the convolution method.
+//
+
+#include <gtest/gtest.h>
+#include "ConvolutionCalibration.hpp"
+
+TEST(convolutionCalibrationTests, fftConvolutionMatchesDirectConvolution) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(37, 52);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(9, 9);
+    for (auto border: {BorderMode::Zero, BorderMode::Constant, BorderMode::Reflect, BorderMode::Replicate,
+                       BorderMode::Wrap}) {
+        Eigen::ArrayXXd direct = applyConvolution(input, kernel, border, 0.3, ConvolutionMethod::Direct);
+        Eigen::ArrayXXd fft = applyConvolution(input, kernel, border, 0.3, ConvolutionMethod::FFT);
+        EXPECT_TRUE(fft.isApprox(direct, 1e-10));
+    }
+}
+
+TEST(convolutionCalibrationTests, fftConvolutionOfLargeImageUsesOverlappingBlocks) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(1100, 40);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(21, 21);
+    EXPECT_LT(ConvolutionCalibration::fftBlockLength(1100, 21), 1100);
+    Eigen::ArrayXXd direct = applyConvolution(input, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct);
+    Eigen::ArrayXXd fft = applyFFTConvolution(input, kernel, BorderMode::Reflect);
+    EXPECT_TRUE(fft.isApprox(direct, 1e-10));
+}
+
+TEST(convolutionCalibrationTests, fftBlocksArePowersOfTwoCoveringKernel) {
+    EXPECT_EQ(ConvolutionCalibration::fftBlockLength(100, 7), 128);
+    for (int size: {50, 1000, 3000}) {
+        for (int kernel_size: {3, 31, 301}) {
+            int block = ConvolutionCalibration::fftBlockLength(size, kernel_size);
+            EXPECT_EQ(block & (block - 1), 0);
+            EXPECT_GE(block, 2 * kernel_size);
+            EXPECT_TRUE(block <= 1024 || block < 4 * kernel_size);
+        }
+    }
+}
+
+TEST(convolutionCalibrationTests, chooseFollowsCalibration) {
+    // equal costs per unit of work: only the amount of work decides
+    ConvolutionCalibration calibration(1, 1, 1);
+    EXPECT_EQ(calibration.choose(512, 512, 3, false), ConvolutionMethod::Direct);
+    EXPECT_EQ(calibration.choose(512, 512, 3, true), ConvolutionMethod::Separable);
+    EXPECT_EQ(calibration.choose(512, 512, 31, false), ConvolutionMethod::FFT);
+    EXPECT_EQ(calibration.choose(512, 512, 15, true), ConvolutionMethod::Separable);
+    // very slow transforms
+    EXPECT_EQ(ConvolutionCalibration(1, 1, 1e6).choose(512, 512, 31, false), ConvolutionMethod::Direct);
+    EXPECT_THROW(calibration.estimate(ConvolutionMethod::Auto, 8, 8, 3), invalid_argument);
+    EXPECT_THROW(ConvolutionCalibration(0, 1, 1), invalid_argument);
+}
+
+TEST(convolutionCalibrationTests, measuredCalibrationIsPositive) {
+    ConvolutionCalibration calibration = ConvolutionCalibration::measure();
+    EXPECT_GT(calibration.getDirectCost(), 0);
+    EXPECT_GT(calibration.getSeparableCost(), 0);
+    EXPECT_GT(calibration.getFFTCost(), 0);
+}
+
+TEST(convolutionCalibrationTests, autoMethodUsesGlobalCalibration) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(64, 64);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(15, 15);
+    Eigen::ArrayXXd direct = applyConvolution(input, kernel, BorderMode::Zero, 0, ConvolutionMethod::Direct);
+    ConvolutionCalibration previous = ConvolutionCalibration::global();
+    // whatever the method chosen, the result is the same
+    ConvolutionCalibration::setGlobal(ConvolutionCalibration(1e6, 1e6, 1));
+    EXPECT_TRUE(applyConvolution(input, kernel).isApprox(direct, 1e-10));
+    ConvolutionCalibration::setGlobal(ConvolutionCalibration(1, 1, 1e6));
+    EXPECT_TRUE(applyConvolution(input, kernel).isApprox(direct, 1e-10));
+    ConvolutionCalibration::setGlobal(previous);
+    EXPECT_THROW(applyConvolution(input, kernel, BorderMode::Zero, 0, ConvolutionMethod::Separable), invalid_argument);
+}
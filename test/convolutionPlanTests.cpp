@@ -0,0 +1,140 @@
+//
+// Tests for the reusable convolution plans.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "ConvolutionPlan.hpp"
+#include "ThreadPool.hpp"
+#include "testHelpers.hpp"
+
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+#error "The test suite must be compiled with EIGEN_RUNTIME_NO_MALLOC"
+#endif
+// the forbidden Eigen allocations are reported by eigen_assert, which NDEBUG disables
+#ifdef NDEBUG
+#error "The test suite must be compiled without NDEBUG"
+#endif
+
+// Eigen allocates its arrays with malloc, and its allocations are forbidden with Eigen::internal::set_is_malloc_allowed.
+// The other allocations (std containers, tasks of the thread pool) go through operator new, whose calls are counted
+// while counting is set, so that the other tests of the suite are not affected.
+static atomic<bool> counting(false);
+static atomic<long> allocations(0);
+
+void* operator new(size_t size) {
+    if (counting) {
+        allocations++;
+    }
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+TEST(convolutionPlanTests, planMatchesApplyConvolutionForAllMethods) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(45, 70);
+    Eigen::ArrayXd a = Eigen::ArrayXd::Random(5), b = Eigen::ArrayXd::Random(5);
+    Eigen::ArrayXXd kernel = (a.matrix() * b.matrix().transpose()).array();
+    for (auto method: {ConvolutionMethod::Direct, ConvolutionMethod::Separable, ConvolutionMethod::FFT}) {
+        ConvolutionPlan plan(45, 70, kernel, BorderMode::Reflect, 0, method);
+        EXPECT_EQ(plan.getMethod(), method);
+        Eigen::ArrayXXd output(45, 70);
+        for (int frame = 0; frame < 2; frame++) {
+            plan.execute(input, output);
+            EXPECT_TRUE(output.isApprox(applyConvolution(input, kernel, BorderMode::Reflect, 0, method), 1e-12));
+        }
+    }
+
+    Image image = randomImage(45, 70, 3);
+    Image output(70, 45, 3);
+    ConvolutionPlan plan(45, 70, kernel, BorderMode::Wrap, 0, ConvolutionMethod::Direct);
+    plan.execute(image, output);
+    EXPECT_EQ(output, applyConvolution(image, kernel, BorderMode::Wrap, 0, ConvolutionMethod::Direct));
+}
+
+TEST(convolutionPlanTests, planWritesIntoBlocksOfLargerArrays) {
+    Eigen::ArrayXXd frame = Eigen::ArrayXXd::Random(50, 60);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(3, 3);
+    Eigen::ArrayXXd canvas = Eigen::ArrayXXd::Zero(60, 70);
+    ConvolutionPlan plan(40, 30, kernel);
+    plan.execute(frame.block(5, 10, 40, 30), canvas.block(10, 20, 40, 30));
+    Eigen::ArrayXXd expected = applyConvolution(Eigen::ArrayXXd(frame.block(5, 10, 40, 30)), kernel);
+    EXPECT_TRUE(canvas.block(10, 20, 40, 30).isApprox(expected, 1e-12));
+    EXPECT_EQ(canvas.block(0, 0, 10, 70).abs().maxCoeff(), 0);
+}
+
+TEST(convolutionPlanTests, planConvolvesImagesOfAnyLayout) {
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(5, 5);
+    Image image = randomImage(30, 41, 3);
+    ConvolutionPlan plan(30, 41, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct);
+    Image expected(41, 30, 3);
+    plan.execute(image, expected);
+    for (auto layout: {ImageLayout::PlanarRowMajor, ImageLayout::InterleavedColumnMajor,
+                       ImageLayout::InterleavedRowMajor}) {
+        Image output(41, 30, 3, layout);
+        plan.execute(image.toLayout(layout), output);
+        EXPECT_EQ(output, expected);
+    }
+}
+
+TEST(convolutionPlanTests, planThrowsOnInvalidSizes) {
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(3, 3);
+    EXPECT_THROW(ConvolutionPlan(2, 10, kernel), invalid_argument);
+    EXPECT_THROW(ConvolutionPlan(10, 10, Eigen::ArrayXXd::Random(3, 5)), invalid_argument);
+    EXPECT_THROW(ConvolutionPlan(10, 10, kernel, BorderMode::Zero, 0, ConvolutionMethod::Separable),
+                 invalid_argument);
+
+    ConvolutionPlan plan(10, 12, kernel);
+    Eigen::ArrayXXd output(10, 12);
+    EXPECT_THROW(plan.execute(Eigen::ArrayXXd::Random(12, 10), output), invalid_argument);
+    Image image = randomImage(10, 12, 3);
+    Image gray(12, 10, 1);
+    EXPECT_THROW(plan.execute(image, gray), invalid_argument);
+}
+
+TEST(convolutionPlanTests, steadyStateFramesDoNotAllocate) {
+    ThreadPool::setGlobalThreads(4);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(5, 5);
+    Eigen::ArrayXd kernel_1d = Eigen::ArrayXd::Random(7);
+    ConvolutionPlan direct(48, 200, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct);
+    ConvolutionPlan separable(48, 200, kernel_1d, kernel_1d, BorderMode::Constant, 0.5);
+    Image frame = randomImage(48, 200, 3);
+    Image output(200, 48, 3);
+    Eigen::ArrayXXd gray = Eigen::ArrayXXd::Random(48, 200);
+    Eigen::ArrayXXd gray_output(48, 200);
+
+    // the first frames size the buffers
+    counting = true;
+    long first = allocations;
+    direct.execute(frame, output);
+    EXPECT_GT(allocations - first, 0);
+    separable.execute(frame, output);
+    direct.execute(gray, gray_output);
+    separable.execute(gray, gray_output);
+
+    // any Eigen allocation now fails an assertion
+    long before = allocations;
+    Eigen::internal::set_is_malloc_allowed(false);
+    for (int i = 0; i < 5; i++) {
+        direct.execute(frame, output);
+        separable.execute(frame, output);
+        direct.execute(gray, gray_output);
+        separable.execute(gray, gray_output);
+    }
+    Eigen::internal::set_is_malloc_allowed(true);
+    counting = false;
+    EXPECT_EQ(allocations - before, 0);
+    ThreadPool::setGlobalThreads(0);
+}
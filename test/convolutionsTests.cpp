@@ -102,4 +102,250 @@ TEST_F(convolutionsTests, convolutionOnMultiChannelImageWorks)
     Image output = applyConvolution(input_image, kernel);
     Image expected = Image(3, input);
     EXPECT_EQ(output, expected);
-}
\ No newline at end of file
+}
+// reference 2D convolution, with zero padding
+static Eigen::ArrayXXd directConvolution(const Eigen::ArrayXXd& input, const Eigen::ArrayXXd& kernel)
+{
+    int row_radius = (kernel.rows() - 1) / 2;
+    int col_radius = (kernel.cols() - 1) / 2;
+    Eigen::ArrayXXd output = Eigen::ArrayXXd::Zero(input.rows(), input.cols());
+    for (int i = 0; i < input.rows(); i++) {
+        for (int j = 0; j < input.cols(); j++) {
+            for (int k = 0; k < kernel.rows(); k++) {
+                for (int l = 0; l < kernel.cols(); l++) {
+                    int input_i = i + k - row_radius;
+                    int input_j = j + l - col_radius;
+                    if (input_i >= 0 && input_i < input.rows() && input_j >= 0 && input_j < input.cols()) {
+                        output(i, j) += input(input_i, input_j) * kernel(k, l);
+                    }
+                }
+            }
+        }
+    }
+    return output;
+}
+
+TEST_F(convolutionsTests, separateKernelDetectsRankOneKernels)
+{
+    Eigen::ArrayXd column_kernel, row_kernel;
+    Eigen::ArrayXXd sobel(3, 3);
+    sobel << -1, 0, 1,
+             -2, 0, 2,
+             -1, 0, 1;
+    ASSERT_TRUE(separateKernel(sobel, column_kernel, row_kernel));
+    EXPECT_TRUE((column_kernel.matrix() * row_kernel.matrix().transpose()).array().isApprox(sobel, 1e-12));
+
+    Eigen::ArrayXd gaussian = Eigen::ArrayXd::LinSpaced(15, -7, 7);
+    gaussian = (-gaussian * gaussian / 8).exp();
+    Eigen::ArrayXXd gaussian_kernel = gaussian.matrix() * gaussian.matrix().transpose();
+    ASSERT_TRUE(separateKernel(gaussian_kernel, column_kernel, row_kernel));
+    EXPECT_EQ(column_kernel.size(), 15);
+    EXPECT_TRUE((column_kernel.matrix() * row_kernel.matrix().transpose()).array().isApprox(gaussian_kernel, 1e-12));
+
+    Eigen::ArrayXXd laplacian(3, 3);
+    laplacian << 0,  1, 0,
+                 1, -4, 1,
+                 0,  1, 0;
+    EXPECT_FALSE(separateKernel(laplacian, column_kernel, row_kernel));
+}
+
+TEST_F(convolutionsTests, separableConvolutionMatchesDirectConvolution)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(23, 31);
+    Eigen::ArrayXd column_kernel = Eigen::ArrayXd::Random(7);
+    Eigen::ArrayXd row_kernel = Eigen::ArrayXd::Random(5);
+    Eigen::ArrayXXd kernel = column_kernel.matrix() * row_kernel.matrix().transpose();
+    Eigen::ArrayXXd expected = directConvolution(input, kernel);
+    EXPECT_TRUE(applySeparableConvolution(input, column_kernel, row_kernel).isApprox(expected, 1e-12));
+
+    Eigen::ArrayXXd square_kernel = column_kernel.matrix() * column_kernel.matrix().transpose();
+    EXPECT_TRUE(applyConvolution(input, square_kernel).isApprox(directConvolution(input, square_kernel), 1e-12));
+}
+
+TEST_F(convolutionsTests, nonSeparableKernelUsesDirectConvolution)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(12, 9);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(5, 5);
+    EXPECT_TRUE(applyConvolution(input, kernel).isApprox(directConvolution(input, kernel), 1e-12));
+}
+
+TEST_F(convolutionsTests, separableConvolutionThrowsErrorOnInvalidKernels)
+{
+    EXPECT_THROW(applySeparableConvolution(input_eigen, Eigen::ArrayXd::Ones(2), Eigen::ArrayXd::Ones(3)),
+                 std::invalid_argument);
+    EXPECT_THROW(applySeparableConvolution(input_eigen, Eigen::ArrayXd::Ones(3), Eigen::ArrayXd::Ones(7)),
+                 std::invalid_argument);
+}
+
+TEST_F(convolutionsTests, borderModesExtendImageBeyondEdges)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(5, 6);
+    // picks the pixel at (i - 1, j - 1), so the output corner shows the extension of the image
+    Eigen::ArrayXXd shift = Eigen::ArrayXXd::Zero(3, 3);
+    shift(0, 0) = 1;
+    // not separable: adds the pixel at (i + 1, j + 1)
+    Eigen::ArrayXXd diagonal = shift;
+    diagonal(2, 2) = 1;
+
+    EXPECT_EQ(applyConvolution(input, shift, BorderMode::Zero)(0, 0), 0);
+    EXPECT_EQ(applyConvolution(input, shift, BorderMode::Constant, 0.25)(0, 0), 0.25);
+    EXPECT_DOUBLE_EQ(applyConvolution(input, shift, BorderMode::Replicate)(0, 0), input(0, 0));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, shift, BorderMode::Reflect)(0, 0), input(1, 1));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, shift, BorderMode::Wrap)(0, 0), input(4, 5));
+
+    EXPECT_DOUBLE_EQ(applyConvolution(input, diagonal, BorderMode::Zero)(0, 0), input(1, 1));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, diagonal, BorderMode::Constant, 0.25)(0, 0), 0.25 + input(1, 1));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, diagonal, BorderMode::Replicate)(4, 5), input(3, 4) + input(4, 5));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, diagonal, BorderMode::Reflect)(4, 5), input(3, 4) + input(3, 4));
+    EXPECT_DOUBLE_EQ(applyConvolution(input, diagonal, BorderMode::Wrap)(4, 5), input(3, 4) + input(0, 0));
+    // the interior does not depend on the border mode
+    EXPECT_TRUE(applyConvolution(input, diagonal, BorderMode::Wrap).block(1, 1, 3, 4).isApprox(
+            applyConvolution(input, diagonal, BorderMode::Zero).block(1, 1, 3, 4)));
+}
+
+TEST_F(convolutionsTests, directAndSeparableConvolutionsAgreeForAllBorderModes)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(9, 11);
+    Eigen::ArrayXd a = Eigen::ArrayXd::Random(5), b = Eigen::ArrayXd::Random(5);
+    Eigen::ArrayXd c = Eigen::ArrayXd::Random(5), d = Eigen::ArrayXd::Random(5);
+    // rank-2 kernel, applied directly, and as the sum of two separable convolutions
+    Eigen::MatrixXd kernel_matrix = a.matrix() * b.matrix().transpose() + c.matrix() * d.matrix().transpose();
+    Eigen::ArrayXXd kernel = kernel_matrix.array();
+    for (auto border: {BorderMode::Zero, BorderMode::Constant, BorderMode::Reflect, BorderMode::Replicate,
+                       BorderMode::Wrap}) {
+        Eigen::ArrayXXd direct = applyConvolution(input, kernel, border, 0.5);
+        Eigen::ArrayXXd separable = applySeparableConvolution(input, a, b, border, 0.5) +
+                                    applySeparableConvolution(input, c, d, border, 0.5);
+        EXPECT_TRUE(direct.isApprox(separable, 1e-12));
+    }
+}
+
+TEST_F(convolutionsTests, borderModesWorkWhenKernelCoversWholeImage)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(3, 3);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(3, 3);
+    Eigen::ArrayXXd ones = Eigen::ArrayXXd::Ones(3, 3);
+    // only the center pixel is in the interior
+    for (auto border: {BorderMode::Zero, BorderMode::Reflect, BorderMode::Replicate, BorderMode::Wrap}) {
+        EXPECT_DOUBLE_EQ(applyConvolution(input, kernel, border)(1, 1), (input * kernel).sum());
+    }
+    EXPECT_TRUE(applyConvolution(ones, ones, BorderMode::Replicate).isApprox(Eigen::ArrayXXd::Constant(3, 3, 9)));
+}
+
+TEST_F(convolutionsTests, parallelConvolutionMatchesSingleThread)
+{
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(40, 70) + 1) / 2);
+    }
+    Image input(channels);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(5, 5);
+    Eigen::ArrayXd kernel_1d = Eigen::ArrayXd::Random(7);
+
+    ThreadPool::setGlobalThreads(1);
+    Image direct = applyConvolution(input, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct);
+    Image separable = applySeparableConvolution(input, kernel_1d, kernel_1d, BorderMode::Wrap);
+    Eigen::ArrayXXd single = applyConvolution(channels[1], kernel, BorderMode::Replicate, 0, ConvolutionMethod::Direct);
+    ThreadPool::setGlobalThreads(4);
+    EXPECT_EQ(applyConvolution(input, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct), direct);
+    EXPECT_EQ(applySeparableConvolution(input, kernel_1d, kernel_1d, BorderMode::Wrap), separable);
+    EXPECT_TRUE((applyConvolution(channels[1], kernel, BorderMode::Replicate, 0, ConvolutionMethod::Direct) ==
+                 single).all());
+    ThreadPool::setGlobalThreads(0);
+
+    // each channel of the image is convolved on its own
+    for (int c = 0; c < 3; c++) {
+        Eigen::ArrayXXd expected = applyConvolution(channels[c], kernel, BorderMode::Reflect, 0,
+                                                    ConvolutionMethod::Direct);
+        EXPECT_TRUE(direct.getData(c).isApprox(normalize(expected)));
+    }
+}
+
+TEST_F(convolutionsTests, fusedNormalizationMatchesNormalizingRawOutput)
+{
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(37, 90) + 1) / 2);
+    }
+    Image input(channels);
+    Eigen::ArrayXd a = Eigen::ArrayXd::Random(5), b = Eigen::ArrayXd::Random(5);
+    Eigen::ArrayXXd kernel = (a.matrix() * b.matrix().transpose()).array();
+
+    // the ranges of the channels are merged across the workers
+    ThreadPool::setGlobalThreads(4);
+    for (auto method: {ConvolutionMethod::Direct, ConvolutionMethod::Separable, ConvolutionMethod::FFT}) {
+        Image raw = applyConvolution(input, kernel, BorderMode::Reflect, 0, method, false);
+        Image normalized = applyConvolution(input, kernel, BorderMode::Reflect, 0, method);
+        for (int c = 0; c < 3; c++) {
+            EXPECT_TRUE(raw.getData(c).isApprox(applyConvolution(channels[c], kernel, BorderMode::Reflect, 0, method),
+                                                1e-12));
+            EXPECT_TRUE((normalized.getData(c) == normalize(raw.getData(c))).all());
+        }
+    }
+    Image raw = applySeparableConvolution(input, a, b, BorderMode::Zero, 0, false);
+    Image normalized = applySeparableConvolution(input, a, b);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE((normalized.getData(c) == normalize(raw.getData(c))).all());
+    }
+    ThreadPool::setGlobalThreads(0);
+}
+
+TEST_F(convolutionsTests, smallKernelsMatchNaiveConvolution)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(30, 37);
+    for (int size: {3, 5, 7}) {
+        Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(size, size);
+        EXPECT_TRUE(applyConvolution(input, kernel, BorderMode::Zero, 0, ConvolutionMethod::Direct).isApprox(
+                directConvolution(input, kernel), 1e-12));
+        // separable kernel of the same size, with 1D passes of size taps
+        Eigen::ArrayXd a = Eigen::ArrayXd::Random(size), b = Eigen::ArrayXd::Random(size);
+        Eigen::ArrayXXd outer = (a.matrix() * b.matrix().transpose()).array();
+        EXPECT_TRUE(applySeparableConvolution(input, a, b).isApprox(
+                applyConvolution(input, outer, BorderMode::Zero, 0, ConvolutionMethod::Direct), 1e-12));
+    }
+}
+
+TEST_F(convolutionsTests, boxFilterMatchesUniformConvolutionForAllBorderModes)
+{
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(150, 31);
+    for (int size: {1, 3, 9, 31}) {
+        Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Constant(size, size, 1.0 / (size * size));
+        for (auto border: {BorderMode::Zero, BorderMode::Constant, BorderMode::Reflect, BorderMode::Replicate,
+                           BorderMode::Wrap}) {
+            Eigen::ArrayXXd expected = applyConvolution(input, kernel, border, 0.5, ConvolutionMethod::Direct);
+            EXPECT_TRUE(applyBoxFilter(input, size, border, 0.5).isApprox(expected, 1e-12));
+        }
+    }
+    EXPECT_THROW(applyBoxFilter(input, 4), std::invalid_argument);
+    EXPECT_THROW(applyBoxFilter(input, 33), std::invalid_argument);
+}
+
+TEST_F(convolutionsTests, recursiveGaussianApproximatesGaussianConvolution)
+{
+    // smooth image in [0, 1], with some noise
+    Eigen::ArrayXXd input(120, 150);
+    for (int j = 0; j < input.cols(); j++) {
+        for (int i = 0; i < input.rows(); i++) {
+            input(i, j) = 0.5 + 0.3 * sin(i / 7.0) * cos(j / 11.0);
+        }
+    }
+    input += 0.1 * Eigen::ArrayXXd::Random(120, 150);
+    for (double sigma: {1.0, 3.0, 10.0}) {
+        int radius = (int) ceil(4 * sigma);
+        Eigen::ArrayXd gaussian(2 * radius + 1);
+        for (int k = -radius; k <= radius; k++) {
+            gaussian(k + radius) = exp(-k * k / (2 * sigma * sigma));
+        }
+        gaussian /= gaussian.sum();
+        Eigen::ArrayXXd fir = applySeparableConvolution(input, gaussian, gaussian, BorderMode::Replicate);
+        Eigen::ArrayXXd iir = applyRecursiveGaussian(input, sigma);
+        double max_error = (iir - fir).abs().maxCoeff();
+        double mean_error = (iir - fir).abs().mean();
+        // measured: max error 0.012, 0.007 and 0.005, mean error 0.0024, 0.0024 and 0.0018 for sigma 1, 3 and 10
+        RecordProperty("max_error_sigma_" + std::to_string((int) sigma), std::to_string(max_error));
+        RecordProperty("mean_error_sigma_" + std::to_string((int) sigma), std::to_string(mean_error));
+        EXPECT_LT(max_error, 0.015);
+        EXPECT_LT(mean_error, 0.003);
+    }
+    EXPECT_THROW(applyRecursiveGaussian(input, 0.4), std::invalid_argument);
+}
@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 #include "Denoiser.hpp"
+#include "operations.hpp"
 
 
 class denoiserTests : public ::testing::Test
@@ -184,4 +185,59 @@ TEST_F(denoiserTests, setKernelWorks) {
             ASSERT_EQ(denoiser.getKernel()(i, j), kernel(i, j));
         }
     }
-}
\ No newline at end of file
+}
+TEST_F(denoiserTests, meanFilterMatchesConvolutionWithUniformKernel) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(40, 50) + 1) / 2);
+    }
+    Image image(channels);
+    for (int size: {1, 3, 15}) {
+        Denoiser denoiser(size, 0);
+        Image expected = applyConvolution(image, denoiser.getKernel(), BorderMode::Zero, 0, ConvolutionMethod::Direct);
+        Image denoised = denoiser.denoise(image);
+        for (int c = 0; c < 3; c++) {
+            ASSERT_TRUE(denoised.getData(c).isApprox(expected.getData(c), 1e-12));
+        }
+    }
+}
+
+TEST_F(denoiserTests, recursiveGaussianDenoiserUsesRecursiveFilter) {
+    ASSERT_THROW(Denoiser::recursiveGaussian(0.1), invalid_argument);
+    Denoiser denoiser = Denoiser::recursiveGaussian(2);
+    ASSERT_TRUE(denoiser.isRecursive());
+    ASSERT_EQ(denoiser.getKernel().rows(), 13);
+    ASSERT_NEAR(denoiser.getKernel().sum(), 1, 1e-6);
+
+    Image image((Eigen::ArrayXXd::Random(30, 40) + 1) / 2);
+    Image expected = applyRecursiveGaussian(image, 2);
+    ASSERT_TRUE(denoiser.denoise(image).getData(0).isApprox(expected.getData(0)));
+
+    denoiser.setKernel(Denoiser(3, 0).getKernel());
+    ASSERT_FALSE(denoiser.isRecursive());
+}
+
+TEST_F(denoiserTests, denoiseKeepsAnOpaqueAlphaChannel) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(30, 40) + 1) / 2);
+    }
+    Image color(channels);
+    channels.emplace_back(Eigen::ArrayXXd::Ones(30, 40));
+    Image image(channels);
+    ASSERT_TRUE(image.hasAlpha());
+    ASSERT_EQ(image.getColorChannels(), 3);
+
+    for (const Denoiser& denoiser: {Denoiser(), Denoiser(5, 0), Denoiser::recursiveGaussian(2)}) {
+        Denoiser copy = denoiser;
+        Image expected = copy.denoise(color);
+        for (auto layout: {ImageLayout::PlanarColumnMajor, ImageLayout::InterleavedRowMajor}) {
+            Image denoised = copy.denoise(image.toLayout(layout));
+            ASSERT_EQ(denoised.getChannels(), 4);
+            for (int c = 0; c < 3; c++) {
+                ASSERT_TRUE(denoised.getData(c).isApprox(expected.getData(c), 1e-12));
+            }
+            ASSERT_TRUE((denoised.getData(3) == 1).all());
+        }
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Tests for the FFT plans and their cache.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "FFTPlan.hpp"
+#include "testHelpers.hpp"
+
+TEST(fftPlanTests, constructorThrowsExceptionOnNegativeLength) {
+    ASSERT_THROW(FFTPlan(-1, false), invalid_argument);
+}
+
+TEST(fftPlanTests, algorithmIsChosenFromLength) {
+    EXPECT_EQ(FFTPlan(1, false).getAlgorithm(), FFTPlan::Algorithm::Trivial);
+    EXPECT_EQ(FFTPlan(256, false).getAlgorithm(), FFTPlan::Algorithm::Radix2);
+    EXPECT_EQ(FFTPlan(360, false).getAlgorithm(), FFTPlan::Algorithm::MixedRadix);
+    EXPECT_EQ(FFTPlan(2 * 101, false).getAlgorithm(), FFTPlan::Algorithm::Bluestein);
+}
+
+TEST(fftPlanTests, planMatchesDirectTransform) {
+    for (int N : {2, 32, 30, 49, 19, 202}) {
+        for (bool inverse : {false, true}) {
+            vector<complex<double>> data(N);
+            for (int i = 0; i < N; i++) {
+                data[i] = complex<double>(sin(i * 0.7), cos(i * 1.3));
+            }
+            vector<complex<double>> expected = referenceTransform(data, inverse);
+            FFTPlan::get(N, inverse)->execute(data.data());
+            for (int i = 0; i < N; i++) {
+                ASSERT_NEAR(data[i].real(), expected[i].real(), 1e-9) << "N = " << N;
+                ASSERT_NEAR(data[i].imag(), expected[i].imag(), 1e-9) << "N = " << N;
+            }
+        }
+    }
+}
+
+TEST(fftPlanTests, cacheReturnsSamePlanForSameKey) {
+    FFTPlan::clearCache();
+    auto forward = FFTPlan::get(48, false);
+    EXPECT_EQ(forward, FFTPlan::get(48, false));
+    EXPECT_NE(forward, FFTPlan::get(48, true));
+    EXPECT_EQ(FFTPlan::cacheSize(), 2);
+}
+
+TEST(fftPlanTests, clearCacheKeepsPlansInUseValid) {
+    auto plan = FFTPlan::get(12, false);
+    FFTPlan::clearCache();
+    EXPECT_EQ(FFTPlan::cacheSize(), 0);
+    vector<complex<double>> data(12, 1.);
+    plan->execute(data.data());
+    EXPECT_NEAR(data[0].real(), 12, 1e-12);
+}
+
+TEST(fftPlanTests, concurrentGetReturnsSinglePlan) {
+    FFTPlan::clearCache();
+    vector<shared_ptr<const FFTPlan>> plans(8);
+    vector<thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&plans, i]() { plans[i] = FFTPlan::get(1009, false); });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    for (auto &plan: plans) {
+        EXPECT_EQ(plan, plans[0]);
+    }
+}
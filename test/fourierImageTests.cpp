@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 #include "FourierImage.hpp"
 #include "operations.hpp"
+#include "testHelpers.hpp"
 
 class fourierImageTests : public ::testing::Test {
 protected:
@@ -284,3 +285,296 @@ TEST_F(fourierImageTests, bandPassFilterWithSameCutoffsReturnsZeroImage) {
         }
     }
 }
+
+// FFT engine
+
+// centered DFT, reordered from the reference transform
+static Eigen::ArrayXcd referenceDft(const Eigen::ArrayXcd& input) {
+    int N = (int) input.size();
+    vector<complex<double>> natural = referenceTransform(vector<complex<double>>(input.begin(), input.end()), false);
+    Eigen::ArrayXcd output(N);
+    for (int m = 0; m < N; m++) {
+        output(m) = natural[((m - N / 2) % N + N) % N];
+    }
+    return output;
+}
+
+TEST_F(fourierImageTests, dftMatchesDirectSumForAllLengths) {
+    // powers of 2, small primes products, odd lengths and large primes (Bluestein)
+    for (int N : {1, 2, 8, 64, 6, 12, 15, 45, 7, 9, 17, 31, 97, 34, 101 * 2}) {
+        Eigen::ArrayXcd input = Eigen::ArrayXcd::Random(N);
+        Eigen::ArrayXcd output = dft(input);
+        Eigen::ArrayXcd expected = referenceDft(input);
+        for (int i = 0; i < N; i++) {
+            ASSERT_NEAR(output(i).real(), expected(i).real(), 1e-9) << "N = " << N;
+            ASSERT_NEAR(output(i).imag(), expected(i).imag(), 1e-9) << "N = " << N;
+        }
+    }
+}
+
+TEST_F(fourierImageTests, inverseDftRecoversSignalForAllLengths) {
+    for (int N : {1, 16, 10, 21, 13, 53, 1000}) {
+        Eigen::ArrayXcd input = Eigen::ArrayXcd::Random(N);
+        Eigen::ArrayXcd output = dft(dft(input), true);
+        for (int i = 0; i < N; i++) {
+            ASSERT_NEAR(output(i).real(), input(i).real(), 1e-9) << "N = " << N;
+            ASSERT_NEAR(output(i).imag(), input(i).imag(), 1e-9) << "N = " << N;
+        }
+    }
+}
+
+TEST_F(fourierImageTests, dft2InverseRecoversNonSquareOddImage) {
+    Eigen::ArrayXXcd input = Eigen::ArrayXXcd::Random(7, 12);
+    Eigen::ArrayXXcd output = dft2(dft2(input), true);
+    for (int i = 0; i < input.rows(); i++) {
+        for (int j = 0; j < input.cols(); j++) {
+            ASSERT_NEAR(output(i, j).real(), input(i, j).real(), 1e-9);
+            ASSERT_NEAR(output(i, j).imag(), input(i, j).imag(), 1e-9);
+        }
+    }
+}
+
+// Real-to-complex transforms
+
+TEST_F(fourierImageTests, rdft2MatchesFullTransformOfRealSignal) {
+    for (auto size : {std::make_pair(4, 4), std::make_pair(7, 12), std::make_pair(10, 9), std::make_pair(13, 17)}) {
+        Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(size.first, size.second);
+        Eigen::ArrayXXcd half = rdft2(input);
+        ASSERT_EQ(half.cols(), size.second / 2 + 1);
+        Eigen::ArrayXXcd full = expandHalfSpectrum(half, size.second);
+        Eigen::ArrayXXcd expected = dft2(input.cast<std::complex<double>>());
+        for (int i = 0; i < input.rows(); i++) {
+            for (int j = 0; j < input.cols(); j++) {
+                ASSERT_NEAR(full(i, j).real(), expected(i, j).real(), 1e-9);
+                ASSERT_NEAR(full(i, j).imag(), expected(i, j).imag(), 1e-9);
+            }
+        }
+    }
+}
+
+TEST_F(fourierImageTests, irdft2RecoversRealSignal) {
+    for (auto size : {std::make_pair(1, 1), std::make_pair(6, 8), std::make_pair(9, 7), std::make_pair(11, 14)}) {
+        Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(size.first, size.second);
+        Eigen::ArrayXXd output = irdft2(rdft2(input), size.second);
+        for (int i = 0; i < input.rows(); i++) {
+            for (int j = 0; j < input.cols(); j++) {
+                ASSERT_NEAR(output(i, j), input(i, j), 1e-9);
+            }
+        }
+    }
+}
+
+TEST_F(fourierImageTests, filtersOnHalfSpectrumMatchFullSpectrumFiltering) {
+    Eigen::ArrayXXd image_data = (Eigen::ArrayXXd::Random(10, 13) + 1) / 2;
+    FourierImage image(1, image_data);
+    image.applyTransform();
+    image.applyBandPassFilter(0.2, 0.7);
+    FourierImage filtered = image.applyInverseTransform();
+
+    // same filter applied to the full spectrum, around the zero frequency
+    Eigen::ArrayXXcd full = dft2(image_data.cast<std::complex<double>>());
+    double min_dimension = 10;
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 13; j++) {
+            double distance = sqrt(pow(i - 10 / 2, 2) + pow(j - 13 / 2, 2));
+            if (distance < 0.2 * min_dimension / 2 || distance >= 0.7 * min_dimension / 2) {
+                full(i, j) = 0;
+            }
+        }
+    }
+    Eigen::ArrayXXd expected_real = dft2(full, true).real();
+    Eigen::ArrayXXd expected = normalize(expected_real);
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 13; j++) {
+            ASSERT_NEAR(filtered(0)(i, j), expected(i, j), 1e-9);
+        }
+    }
+}
+
+TEST_F(fourierImageTests, lowAndHighPassWithSameCutoffAreComplementary) {
+    FourierImage low = image_1ch;
+    FourierImage high = image_1ch;
+    low.applyLowPassFilter(0.5);
+    high.applyHighPassFilter(0.5);
+    Eigen::ArrayXXcd sum = low.getTransform() + high.getTransform();
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            ASSERT_NEAR(sum(i, j).real(), expected_transf(i, j).real(), 1e-10);
+            ASSERT_NEAR(sum(i, j).imag(), expected_transf(i, j).imag(), 1e-10);
+        }
+    }
+}
+
+TEST_F(fourierImageTests, dft2MatchesRowAndColumnDftsAcrossRowBlocks) {
+    // sizes that are not multiples of the row blocks
+    Eigen::ArrayXXcd input = Eigen::ArrayXXcd::Random(45, 70);
+    Eigen::ArrayXXcd expected = input;
+    for (int i = 0; i < expected.rows(); i++) {
+        Eigen::ArrayXcd row = expected.row(i);
+        expected.row(i) = dft(row);
+    }
+    for (int j = 0; j < expected.cols(); j++) {
+        Eigen::ArrayXcd col = expected.col(j);
+        expected.col(j) = dft(col);
+    }
+    Eigen::ArrayXXcd output = dft2(input);
+    Eigen::ArrayXXcd half = rdft2(input.real());
+    Eigen::ArrayXXcd expected_half = expandHalfSpectrum(half, 70);
+    Eigen::ArrayXXcd expected_real = dft2(input.real().cast<std::complex<double>>());
+    for (int i = 0; i < input.rows(); i++) {
+        for (int j = 0; j < input.cols(); j++) {
+            ASSERT_NEAR(std::abs(output(i, j) - expected(i, j)), 0, 1e-9);
+            ASSERT_NEAR(std::abs(expected_half(i, j) - expected_real(i, j)), 0, 1e-9);
+        }
+    }
+}
+
+TEST_F(fourierImageTests, batchedTransformsMatchSingleTransforms) {
+    vector<Eigen::ArrayXXd> inputs = {Eigen::ArrayXXd::Random(33, 20), Eigen::ArrayXXd::Random(33, 20),
+                                      Eigen::ArrayXXd::Random(33, 20)};
+    vector<Eigen::ArrayXXcd> spectra = rdft2(inputs);
+    ASSERT_EQ(spectra.size(), 3);
+    vector<Eigen::ArrayXXd> outputs = irdft2(spectra, 20);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE(spectra[c].isApprox(rdft2(inputs[c]), 1e-12));
+        EXPECT_TRUE(outputs[c].isApprox(inputs[c], 1e-10));
+    }
+    vector<Eigen::ArrayXXd> mismatched = {Eigen::ArrayXXd::Random(4, 4), Eigen::ArrayXXd::Random(4, 5)};
+    EXPECT_THROW(rdft2(mismatched), invalid_argument);
+}
+
+TEST_F(fourierImageTests, transformDoesNotDependOnTheLayout) {
+    Image image = randomImage(18, 25, 3);
+    vector<Eigen::Ref<const Eigen::ArrayXXd>> views;
+    for (int c = 0; c < 3; c++) {
+        views.emplace_back(image.getColumnMajorView(c));
+    }
+    vector<Eigen::ArrayXXcd> expected = rdft2(image.getData());
+    vector<Eigen::ArrayXXcd> spectra = rdft2(views);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE((spectra[c] == expected[c]).all());
+    }
+
+    for (auto layout: {ImageLayout::PlanarColumnMajor, ImageLayout::InterleavedRowMajor}) {
+        FourierImage fourier_image(image.toLayout(layout));
+        fourier_image.setMultiChannel(true);
+        fourier_image.applyTransform();
+        for (int c = 0; c < 3; c++) {
+            EXPECT_TRUE(fourier_image.getTransform(c).isApprox(expandHalfSpectrum(expected[c], 25), 1e-12));
+        }
+    }
+}
+
+TEST_F(fourierImageTests, multiChannelModeFiltersEachChannel) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(18, 25) + 1) / 2);
+    }
+    FourierImage color(channels);
+    color.setMultiChannel(true);
+    EXPECT_TRUE(color.isMultiChannel());
+    color.applyTransform();
+    ASSERT_EQ(color.getTransformChannels(), 3);
+    color.applyLowPassFilter(0.4);
+    FourierImage filtered = color.applyInverseTransform();
+    ASSERT_EQ(filtered.getChannels(), 3);
+
+    for (int c = 0; c < 3; c++) {
+        FourierImage single(1, channels[c]);
+        single.applyTransform();
+        EXPECT_TRUE(color.getTransform(c).isApprox((single.applyLowPassFilter(0.4), single.getTransform()), 1e-10));
+        EXPECT_TRUE(filtered.getData(c).isApprox(single.applyInverseTransform().getData(0), 1e-10));
+    }
+    EXPECT_THROW(color.getTransform(3), invalid_argument);
+}
+
+TEST_F(fourierImageTests, multiChannelModeKeepsAnOpaqueAlphaChannel) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(18, 25) + 1) / 2);
+    }
+    FourierImage color(channels);
+    channels.emplace_back(Eigen::ArrayXXd::Ones(18, 25));
+    FourierImage with_alpha(channels);
+    for (FourierImage* image: {&color, &with_alpha}) {
+        image->setMultiChannel(true);
+        image->applyTransform();
+        image->applyLowPassFilter(0.2);
+    }
+    ASSERT_EQ(with_alpha.getTransformChannels(), 3);
+    FourierImage expected = color.applyInverseTransform();
+    FourierImage filtered = with_alpha.applyInverseTransform();
+    ASSERT_EQ(filtered.getChannels(), 4);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE(filtered.getData(c).isApprox(expected.getData(c), 1e-12));
+    }
+    EXPECT_TRUE((filtered.getData(3) == 1).all());
+
+    vector<Image> bank = with_alpha.applyFilterBank({FilterSpec::highPass(0.1)});
+    ASSERT_EQ(bank[0].getChannels(), 4);
+    EXPECT_TRUE((bank[0].getData(3) == 1).all());
+}
+
+TEST_F(fourierImageTests, colorImageIsConvertedToGrayscaleByDefault) {
+    FourierImage color(vector<Eigen::ArrayXXd>(3, (Eigen::ArrayXXd::Random(6, 6) + 1) / 2));
+    color.applyTransform();
+    EXPECT_EQ(color.getTransformChannels(), 1);
+    EXPECT_EQ(color.applyInverseTransform().getChannels(), 1);
+}
+
+TEST_F(fourierImageTests, filterBankMatchesIndividualFilters) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 2; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(22, 17) + 1) / 2);
+    }
+    FourierImage source(channels);
+    source.setMultiChannel(true);
+    source.applyTransform();
+    Eigen::ArrayXXcd spectrum = source.getTransform(1);
+
+    vector<FilterSpec> filters = {
+            FilterSpec::lowPass(0.3),
+            FilterSpec::highPass(0.2, FrequencyMask::Profile::Butterworth, 3),
+            FilterSpec::bandPass(0.1, 0.6, FrequencyMask::Profile::Gaussian),
+            FilterSpec::notch(3, 2, 1.5)
+    };
+    vector<Image> bank = source.applyFilterBank(filters);
+    ASSERT_EQ(bank.size(), filters.size());
+    // the source spectrum is not modified
+    EXPECT_TRUE(source.getTransform(1).isApprox(spectrum));
+
+    for (size_t f = 0; f < filters.size(); f++) {
+        FourierImage single(channels);
+        single.setMultiChannel(true);
+        single.applyTransform();
+        single.applyFilter(filters[f]);
+        FourierImage expected = single.applyInverseTransform();
+        ASSERT_EQ(bank[f].getChannels(), 2);
+        for (int c = 0; c < 2; c++) {
+            EXPECT_TRUE(bank[f].getData(c).isApprox(expected.getData(c), 1e-10));
+        }
+    }
+}
+
+TEST_F(fourierImageTests, filterBankWorksOnFullTransforms) {
+    Eigen::ArrayXXd image_data = (Eigen::ArrayXXd::Random(12, 15) + 1) / 2;
+    FourierImage source(1, image_data);
+    source.applyTransform();
+    source.setTransform(source.getTransform());
+    vector<FilterSpec> filters = {FilterSpec::lowPass(0.5), FilterSpec::notch(2, -3, 1)};
+    vector<Image> bank = source.applyFilterBank(filters);
+
+    for (size_t f = 0; f < filters.size(); f++) {
+        FourierImage single(1, image_data);
+        single.applyTransform();
+        single.applyFilter(filters[f]);
+        EXPECT_TRUE(bank[f].getData(0).isApprox(single.applyInverseTransform().getData(0), 1e-8));
+    }
+}
+
+TEST_F(fourierImageTests, filterBankThrowsWithoutTransform) {
+    FourierImage source(1, Eigen::ArrayXXd::Zero(4, 4));
+    EXPECT_THROW(source.applyFilterBank({FilterSpec::lowPass(0.5)}), runtime_error);
+    source.applyTransform();
+    EXPECT_THROW(source.applyFilterBank({FilterSpec::notch(1, 1, -1)}), invalid_argument);
+}
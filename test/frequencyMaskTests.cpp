@@ -0,0 +1,123 @@
+//
+// Tests for the frequency-domain masks and their cache.
+//
+
+#include <gtest/gtest.h>
+#include "FrequencyMask.hpp"
+#include "FourierImage.hpp"
+
+TEST(frequencyMaskTests, constructorThrowsForInvalidArguments) {
+    EXPECT_THROW(FrequencyMask(-1, 2), invalid_argument);
+    EXPECT_THROW(FrequencyMask(3, 2), invalid_argument);
+    EXPECT_THROW(FrequencyMask(0, 2, FrequencyMask::Profile::Butterworth, 0), invalid_argument);
+}
+
+TEST(frequencyMaskTests, idealMaskKeepsOnlyTheRing) {
+    FrequencyMask mask(2, 5);
+    EXPECT_EQ(mask.gain(1.9), 0);
+    EXPECT_EQ(mask.gain(2), 1);
+    EXPECT_EQ(mask.gain(4.9), 1);
+    EXPECT_EQ(mask.gain(5), 0);
+}
+
+TEST(frequencyMaskTests, smoothProfilesHaveExpectedValuesAtCutoff) {
+    double inf = numeric_limits<double>::infinity();
+    FrequencyMask butterworth_low(0, 10, FrequencyMask::Profile::Butterworth, 3);
+    EXPECT_DOUBLE_EQ(butterworth_low.gain(0), 1);
+    EXPECT_DOUBLE_EQ(butterworth_low.gain(10), 0.5);
+    FrequencyMask butterworth_high(10, inf, FrequencyMask::Profile::Butterworth, 3);
+    EXPECT_DOUBLE_EQ(butterworth_high.gain(0), 0);
+    EXPECT_DOUBLE_EQ(butterworth_high.gain(10), 0.5);
+    FrequencyMask gaussian_low(0, 10, FrequencyMask::Profile::Gaussian);
+    EXPECT_DOUBLE_EQ(gaussian_low.gain(10), exp(-0.5));
+    FrequencyMask gaussian_high(10, inf, FrequencyMask::Profile::Gaussian);
+    EXPECT_DOUBLE_EQ(gaussian_high.gain(10), 1 - exp(-0.5));
+}
+
+TEST(frequencyMaskTests, bandMaskIsProductOfLowAndHighMasks) {
+    double inf = numeric_limits<double>::infinity();
+    for (auto profile: {FrequencyMask::Profile::Butterworth, FrequencyMask::Profile::Gaussian}) {
+        FrequencyMask band(3, 12, profile);
+        FrequencyMask low(0, 12, profile);
+        FrequencyMask high(3, inf, profile);
+        for (double distance = 0; distance < 30; distance += 0.7) {
+            EXPECT_DOUBLE_EQ(band.gain(distance), low.gain(distance) * high.gain(distance));
+        }
+    }
+}
+
+TEST(frequencyMaskTests, sampleIsCenteredOnZeroFrequency) {
+    FrequencyMask mask(0, 2);
+    Eigen::ArrayXXd half = mask.sample(7, 4, 0);
+    EXPECT_EQ(half(3, 0), 1);
+    EXPECT_EQ(half(3, 1), 1);
+    EXPECT_EQ(half(3, 2), 0);
+    EXPECT_EQ(half(0, 0), 0);
+    Eigen::ArrayXXd full = mask.sample(7, 6, -3);
+    EXPECT_TRUE((full.rightCols(3) == half.leftCols(3)).all());
+}
+
+TEST(frequencyMaskTests, getCachesMasksPerShapeAndCutoff) {
+    FrequencyMask::clearCache();
+    FrequencyMask mask(1, 4, FrequencyMask::Profile::Gaussian);
+    auto first = FrequencyMask::get(mask, 16, 9, 0);
+    auto second = FrequencyMask::get(FrequencyMask(1, 4, FrequencyMask::Profile::Gaussian), 16, 9, 0);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(FrequencyMask::cacheSize(), 1);
+    auto other_shape = FrequencyMask::get(mask, 16, 16, -8);
+    auto other_cutoff = FrequencyMask::get(FrequencyMask(1, 5, FrequencyMask::Profile::Gaussian), 16, 9, 0);
+    EXPECT_NE(first, other_shape);
+    EXPECT_NE(first, other_cutoff);
+    EXPECT_EQ(FrequencyMask::cacheSize(), 3);
+    FrequencyMask::clearCache();
+    EXPECT_EQ(FrequencyMask::cacheSize(), 0);
+}
+
+TEST(frequencyMaskTests, cacheIsBoundedByBytes) {
+    FrequencyMask::clearCache();
+    FrequencyMask::setCacheBudget(3 * 16 * 9 * sizeof(double));
+    for (int i = 0; i < 5; i++) {
+        auto sampled = FrequencyMask::get(FrequencyMask(0, 1 + i), 16, 9, 0);
+    }
+    EXPECT_EQ(FrequencyMask::cacheSize(), 3);
+    EXPECT_EQ(FrequencyMask::cacheBytes(), 3 * 16 * 9 * sizeof(double));
+
+    // masks larger than the budget are not kept
+    auto large = FrequencyMask::get(FrequencyMask(0, 3), 64, 33, 0);
+    EXPECT_EQ(FrequencyMask::cacheSize(), 0);
+    EXPECT_EQ(large->rows(), 64);
+    FrequencyMask::setCacheBudget(1 << 20);
+    FrequencyMask::get(FrequencyMask(0, 3), 64, 33, 0);
+    EXPECT_EQ(FrequencyMask::cacheSize(), 1);
+    FrequencyMask::setCacheBudget(0);
+    EXPECT_EQ(FrequencyMask::cacheBytes(), 0);
+    FrequencyMask::setCacheBudget((size_t) 256 << 20);
+}
+
+TEST(frequencyMaskTests, smoothFilterOnHalfSpectrumMatchesFullSpectrum) {
+    Eigen::ArrayXXd image_data = (Eigen::ArrayXXd::Random(20, 27) + 1) / 2;
+    FourierImage half(1, image_data);
+    half.applyTransform();
+    FourierImage full(1, image_data);
+    full.setTransform(half.getTransform());
+
+    half.applyBandPassFilter(0.1, 0.5, FrequencyMask::Profile::Butterworth, 4);
+    full.applyBandPassFilter(0.1, 0.5, FrequencyMask::Profile::Butterworth, 4);
+    EXPECT_TRUE(half.getTransform().isApprox(full.getTransform(), 1e-10));
+    EXPECT_TRUE(half.applyInverseTransform().getData(0).isApprox(full.applyInverseTransform().getData(0), 1e-8));
+}
+
+TEST(frequencyMaskTests, notchMaskRemovesBothSymmetricFrequencies) {
+    FrequencyMask notch = FrequencyMask::notch(3, -2, 1.5);
+    EXPECT_TRUE(notch.isNotch());
+    EXPECT_FALSE(FrequencyMask(0, 2).isNotch());
+    EXPECT_EQ(notch.gain(3, -2), 0);
+    EXPECT_EQ(notch.gain(-3, 2), 0);
+    EXPECT_EQ(notch.gain(0, 0), 1);
+    EXPECT_EQ(notch.gain(3, 2), 1);
+    for (double u = -5; u <= 5; u++) {
+        for (double v = -5; v <= 5; v++) {
+            EXPECT_EQ(notch.gain(u, v), notch.gain(-u, -v));
+        }
+    }
+}
@@ -3,6 +3,7 @@
 //
 
 #include "Image.cpp"
+#include "TypedImage.hpp"
 #include "gtest/gtest.h"
 #include <opencv2/opencv.hpp>
 
@@ -432,4 +433,155 @@ TEST_F(imageTests, reduceChannelreturnsImageWithReducedChannels) {
     EXPECT_EQ(reduced_image.getWidth(), 5);
     EXPECT_EQ(reduced_image.getHeight(), 5);
     EXPECT_EQ(reduced_image.getChannels(), 1);
-}
\ No newline at end of file
+}
+TEST_F(imageTests, layoutsPlacePixelsAtTheirStrides) {
+    for (auto layout: {ImageLayout::PlanarColumnMajor, ImageLayout::PlanarRowMajor,
+                       ImageLayout::InterleavedColumnMajor, ImageLayout::InterleavedRowMajor}) {
+        Image image(4, 3, 2, layout);
+        EXPECT_EQ(image.getLayout(), layout);
+        image.setPixel(3, 1, 1, 0.5);
+        Eigen::Index offset = 1 * image.getRowStride() + 3 * image.getColStride() + image.getChannelStride();
+        EXPECT_EQ(image.getBuffer()[offset], 0.5);
+        EXPECT_EQ(image.getChannelView(1)(1, 3), 0.5);
+        EXPECT_EQ(image.getData(1).sum(), 0.5);
+    }
+    Image planar(4, 3, 2);
+    EXPECT_EQ(planar.getRowStride(), 1);
+    EXPECT_EQ(planar.getColStride(), 3);
+    EXPECT_EQ(planar.getChannelStride(), 12);
+    Image interleaved(4, 3, 2, ImageLayout::InterleavedRowMajor);
+    EXPECT_EQ(interleaved.getChannelStride(), 1);
+    EXPECT_EQ(interleaved.getColStride(), 2);
+    EXPECT_EQ(interleaved.getRowStride(), 8);
+}
+
+TEST_F(imageTests, toLayoutKeepsThePixels) {
+    vector<Eigen::ArrayXXd> data;
+    for (int c = 0; c < 3; c++) {
+        data.emplace_back((Eigen::ArrayXXd::Random(6, 9) + 1) / 2);
+    }
+    Image image(data);
+    for (auto layout: {ImageLayout::PlanarRowMajor, ImageLayout::InterleavedColumnMajor,
+                       ImageLayout::InterleavedRowMajor, ImageLayout::PlanarColumnMajor}) {
+        Image copy = image.toLayout(layout);
+        EXPECT_EQ(copy.getLayout(), layout);
+        EXPECT_EQ(copy, image);
+        EXPECT_TRUE((copy.getPixel(7, 2) == image.getPixel(7, 2)).all());
+        EXPECT_TRUE(copy.reduceChannels().getData(0).isApprox(image.reduceChannels().getData(0)));
+        copy.setData(1, data[0]);
+        EXPECT_TRUE((copy.getData(1) == data[0]).all());
+        EXPECT_TRUE((copy.getData(2) == data[2]).all());
+    }
+}
+
+TEST_F(imageTests, constructorFromCvMatScalesThePixels) {
+    cv::Mat mat(4, 5, CV_8UC3);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 5; j++) {
+            for (int k = 0; k < 3; k++) {
+                mat.ptr<uchar>(i)[j * 3 + k] = (uchar) (i * 50 + j * 10 + k);
+            }
+        }
+    }
+    for (auto layout: {ImageLayout::PlanarColumnMajor, ImageLayout::InterleavedRowMajor}) {
+        Image image(mat, layout);
+        EXPECT_EQ(image.getWidth(), 5);
+        EXPECT_EQ(image.getHeight(), 4);
+        EXPECT_EQ(image.getLayout(), layout);
+        EXPECT_DOUBLE_EQ(image.getPixel(3, 2, 1), (2 * 50 + 3 * 10 + 1) / 255.0);
+        // the conversion back truncates, as the per-pixel loop did
+        cv::Mat back = image.toCvMat();
+        EXPECT_EQ(back.at<cv::Vec3b>(2, 3)[1], (uchar) (image.getPixel(3, 2, 1) * 255));
+        EXPECT_EQ(Image(back, layout), Image(image.toCvMat(), layout));
+    }
+    cv::Mat mat16(3, 2, CV_16UC1);
+    mat16.at<uint16_t>(1, 1) = 65535;
+    EXPECT_EQ(Image(mat16).getPixel(1, 1, 0), 1);
+    cv::Mat mat_float(3, 2, CV_32FC1);
+    mat_float.at<float>(0, 0) = 2;
+    EXPECT_THROW(Image{mat_float}, std::invalid_argument);
+    EXPECT_THROW(Image{cv::Mat(3, 2, CV_8S)}, std::invalid_argument);
+    EXPECT_THROW(Image{cv::Mat()}, std::invalid_argument);
+}
+
+TEST_F(imageTests, asCvMatSharesTheBuffer) {
+    Image image(input_vector);
+    EXPECT_THROW(image.asCvMat(), std::invalid_argument);
+    Image interleaved = image.toLayout(ImageLayout::InterleavedRowMajor);
+    cv::Mat mat = interleaved.asCvMat();
+    EXPECT_EQ(mat.channels(), 3);
+    EXPECT_EQ((void*) mat.data, (void*) interleaved.getBuffer());
+    mat.ptr<double>(2)[3 * 3 + 1] = 0.5;
+    EXPECT_EQ(interleaved.getPixel(3, 2, 1), 0.5);
+}
+
+TEST_F(imageTests, constructorFromFilenameKeepsDepthAndChannels) {
+    cv::Mat gray16(3, 4, CV_16UC1);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            gray16.at<uint16_t>(i, j) = (uint16_t) (i * 20000 + j * 257 + 1);
+        }
+    }
+    string path16 = loc + "/output/test_gray16.png";
+    cv::imwrite(path16, gray16);
+    Image image16(path16);
+    EXPECT_EQ(image16.getChannels(), 1);
+    EXPECT_TRUE(image16.usedAbsolutePath());
+    EXPECT_DOUBLE_EQ(image16.getPixel(3, 2, 0), (2 * 20000 + 3 * 257 + 1) / 65535.0);
+    // copies keep the path of the file, whether constructed or assigned
+    Image copy(image16);
+    Image assigned = Image(1, 1, 1);
+    assigned = image16;
+    EXPECT_EQ(copy.getPath(), image16.getPath());
+    EXPECT_EQ(assigned.getPath(), image16.getPath());
+    EXPECT_TRUE(copy.usedAbsolutePath());
+
+    // pixels of the type of the file are not converted
+    TypedImage<uint16_t> typed16(path16);
+    EXPECT_TRUE(typed16.wrapsCvMat());
+    EXPECT_EQ(typed16.getPixel(3, 2, 0), 2 * 20000 + 3 * 257 + 1);
+    TypedImage<uint8_t> typed8(path16);
+    EXPECT_EQ(typed8.getPixel(3, 2, 0), (uint8_t) lround((2 * 20000 + 3 * 257 + 1) / 257.0));
+
+    cv::Mat alpha(2, 3, CV_8UC4);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 12; j++) {
+            alpha.ptr<uchar>(i)[j] = (uchar) (i * 100 + j * 10);
+        }
+    }
+    string path_alpha = loc + "/output/test_alpha.png";
+    cv::imwrite(path_alpha, alpha);
+    Image image_alpha(path_alpha);
+    EXPECT_EQ(image_alpha.getChannels(), 4);
+    EXPECT_DOUBLE_EQ(image_alpha.getPixel(2, 1, 3), (100 + 11 * 10) / 255.0);
+    EXPECT_TRUE(image_alpha.reduceChannels().getData(0).isApprox(
+            0.2126 * image_alpha.getData(0) + 0.7152 * image_alpha.getData(1) + 0.0722 * image_alpha.getData(2)));
+    EXPECT_NO_THROW(image_alpha.save(path_alpha, true));
+}
+
+TEST_F(imageTests, moveKeepsTheBuffer) {
+    Image image(3, 2, 3);
+    image.setPixel(1, 1, 2, 0.5);
+    const double* buffer = image.getBuffer();
+    Image moved(std::move(image));
+    EXPECT_EQ(moved.getBuffer(), buffer);
+    EXPECT_DOUBLE_EQ(moved.getPixel(1, 1, 2), 0.5);
+    Image assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.getBuffer(), buffer);
+}
+
+TEST_F(imageTests, columnMajorViewReadsTheBuffer) {
+    Eigen::ArrayXXd data = Eigen::ArrayXXd::Random(2, 3).abs();
+    Image image(data);
+    ConstColumnMajorView view = image.getColumnMajorView(0);
+    EXPECT_EQ(view.data(), image.getBuffer());
+    EXPECT_TRUE(view.isApprox(data));
+    EXPECT_THROW(image.toLayout(ImageLayout::InterleavedRowMajor).getColumnMajorView(0), invalid_argument);
+
+    // setters take views without copying them first
+    Image other(3, 2, 1);
+    other.setData(0, view);
+    EXPECT_TRUE(other == image);
+    EXPECT_THROW(other.setData(0, view - 1), invalid_argument);
+}
@@ -0,0 +1,105 @@
+//
+// Tests for the disk-backed (out-of-core) Fourier transforms.
+//
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include "OutOfCoreSpectrum.hpp"
+#include "FourierImage.hpp"
+#include "operations.hpp"
+
+static string scratchPath() {
+    return testing::TempDir() + "out_of_core_scratch.bin";
+}
+
+TEST(outOfCoreSpectrumTests, constructorThrowsForInvalidDimensions) {
+    EXPECT_THROW(OutOfCoreSpectrum(scratchPath(), 0, 10, 1 << 20), invalid_argument);
+    EXPECT_THROW(OutOfCoreSpectrum(scratchPath(), 10, -1, 1 << 20), invalid_argument);
+}
+
+TEST(outOfCoreSpectrumTests, smallBudgetSplitsSpectrumInTiles) {
+    OutOfCoreSpectrum spectrum(scratchPath(), 300, 500, 64 * 1024);
+    EXPECT_LT(spectrum.getTileRows(), 300);
+    EXPECT_LT(spectrum.getTileCols(), 251);
+    EXPECT_EQ(spectrum.getTileRows() % 32, 0);
+    EXPECT_EQ(spectrum.getTileCols() % 32, 0);
+}
+
+TEST(outOfCoreSpectrumTests, scratchFilesAreUniqueAndUnlinked) {
+    Eigen::ArrayXXd first_input = Eigen::ArrayXXd::Random(40, 40);
+    Eigen::ArrayXXd second_input = Eigen::ArrayXXd::Random(40, 40);
+    OutOfCoreSpectrum first(scratchPath(), 40, 40, 1 << 20);
+    OutOfCoreSpectrum second(scratchPath(), 40, 40, 1 << 20);
+    EXPECT_FALSE(ifstream(scratchPath()).good());
+    first.forward(first_input);
+    second.forward(second_input);
+    EXPECT_TRUE(first.inverse().isApprox(first_input, 1e-10));
+    EXPECT_TRUE(second.inverse().isApprox(second_input, 1e-10));
+}
+
+TEST(outOfCoreSpectrumTests, copiesAreIndependent) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(70, 50);
+    OutOfCoreSpectrum spectrum(scratchPath(), 70, 50, 16 * 1024);
+    spectrum.forward(input);
+    Eigen::ArrayXXcd before = spectrum.load();
+    OutOfCoreSpectrum copy(spectrum);
+    EXPECT_TRUE(copy.load().isApprox(before));
+    copy.applyMask(FrequencyMask(0, 5));
+    EXPECT_TRUE(spectrum.load().isApprox(before));
+    EXPECT_FALSE(copy.load().isApprox(before));
+}
+
+TEST(outOfCoreSpectrumTests, forwardMatchesRdft2) {
+    // odd sizes, spanning several partial tiles in both directions
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(101, 77);
+    OutOfCoreSpectrum spectrum(scratchPath(), 101, 77, 32 * 1024);
+    spectrum.forward(input);
+    Eigen::ArrayXXcd expected = rdft2(input);
+    EXPECT_TRUE(spectrum.load().isApprox(expected, 1e-10));
+}
+
+TEST(outOfCoreSpectrumTests, inverseRecoversInputAndKeepsSpectrum) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(64, 90);
+    OutOfCoreSpectrum spectrum(scratchPath(), 64, 90, 32 * 1024);
+    spectrum.forward(input);
+    Eigen::ArrayXXcd before = spectrum.load();
+    EXPECT_TRUE(spectrum.inverse().isApprox(input, 1e-10));
+    EXPECT_TRUE(spectrum.load().isApprox(before));
+}
+
+TEST(outOfCoreSpectrumTests, outOfCoreFiltersMatchInMemoryFilters) {
+    Eigen::ArrayXXd image_data = (Eigen::ArrayXXd::Random(97, 130) + 1) / 2;
+    FourierImage in_memory(1, image_data);
+    FourierImage on_disk(1, image_data);
+    on_disk.enableOutOfCore(scratchPath(), 48 * 1024);
+    EXPECT_TRUE(on_disk.isOutOfCore());
+    EXPECT_FALSE(in_memory.isOutOfCore());
+
+    in_memory.applyTransform();
+    on_disk.applyTransform();
+    EXPECT_TRUE(on_disk.getTransform().isApprox(in_memory.getTransform(), 1e-10));
+
+    in_memory.applyBandPassFilter(0.1, 0.6);
+    on_disk.applyBandPassFilter(0.1, 0.6);
+    FourierImage expected = in_memory.applyInverseTransform();
+    FourierImage result = on_disk.applyInverseTransform();
+    EXPECT_TRUE(result.getData(0).isApprox(expected.getData(0), 1e-10));
+    EXPECT_TRUE(result.getTransform().isApprox(expected.getTransform(), 1e-10));
+}
+
+TEST(outOfCoreSpectrumTests, copiesOfImagesKeepTheirOwnSpectrum) {
+    Eigen::ArrayXXd image_data = (Eigen::ArrayXXd::Random(64, 64) + 1) / 2;
+    FourierImage original(1, image_data);
+    original.enableOutOfCore(scratchPath(), 32 * 1024);
+    original.applyTransform();
+    Eigen::ArrayXXcd before = original.getTransform();
+
+    FourierImage filtered = original;
+    filtered.applyLowPassFilter(0.2);
+    EXPECT_TRUE(original.getTransform().isApprox(before));
+    EXPECT_FALSE(filtered.getTransform().isApprox(before));
+
+    FourierImage recomputed = original;
+    recomputed.applyTransform();
+    EXPECT_TRUE(original.getTransform().isApprox(before));
+}
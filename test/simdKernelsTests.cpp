@@ -0,0 +1,84 @@
+//
+// Tests for the vectorized convolution kernels and their runtime dispatch.
+//
+
+#include <gtest/gtest.h>
+#include <Eigen/Eigen>
+#include "SimdKernels.hpp"
+#include "operations.hpp"
+
+// all levels supported by this processor
+static vector<SimdLevel> supportedLevels() {
+    vector<SimdLevel> levels;
+    for (auto level: {SimdLevel::Scalar, SimdLevel::SSE4, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level <= detectSimdLevel()) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+template <typename T>
+static void checkWeightedSum(int count, double tolerance) {
+    typedef Eigen::Array<T, Eigen::Dynamic, 1> Vector;
+    for (int length: {0, 1, 7, 8, 33, 100}) {
+        vector<Vector> streams;
+        vector<const T*> sources;
+        Vector weights = Vector::Random(count);
+        Vector expected = Vector::Zero(length);
+        for (int t = 0; t < count; t++) {
+            streams.push_back(Vector::Random(length + t));
+        }
+        for (int t = 0; t < count; t++) {
+            // shifted streams, as in the vertical pass
+            sources.push_back(streams[t].data() + t);
+            expected += weights(t) * streams[t].segment(t, length);
+        }
+        for (SimdLevel level: supportedLevels()) {
+            setSimdLevel(level);
+            Vector output = Vector::Constant(length, 42);
+            weightedSum(sources.data(), weights.data(), count, output.data(), length);
+            EXPECT_TRUE(((output - expected).abs() <= tolerance).all())
+                    << simdLevelName(level) << " " << count << " " << length;
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+}
+
+TEST(simdKernelsTests, weightedSumMatchesScalarSumForAllLevels) {
+    checkWeightedSum<double>(4, 1e-12);
+    checkWeightedSum<float>(4, 1e-5);
+}
+
+TEST(simdKernelsTests, fixedSizeKernelsMatchScalarSumForAllLevels) {
+    // 1D and 2D kernels of size 3, 5 and 7, and their neighbours on the generic path
+    for (int count: {2, 3, 5, 7, 8, 9, 25, 49, 50}) {
+        checkWeightedSum<double>(count, 1e-12);
+        checkWeightedSum<float>(count, 1e-4);
+    }
+}
+
+TEST(simdKernelsTests, defaultLevelIsDetected) {
+    EXPECT_EQ(getSimdLevel(), detectSimdLevel());
+    EXPECT_EQ(simdLevelName(SimdLevel::AVX2), "AVX2");
+    if (detectSimdLevel() != SimdLevel::AVX512) {
+        EXPECT_THROW(setSimdLevel(SimdLevel::AVX512), invalid_argument);
+    }
+}
+
+TEST(simdKernelsTests, convolutionsMatchForAllLevels) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(45, 30);
+    Eigen::ArrayXXd kernel = Eigen::ArrayXXd::Random(5, 5);
+    Eigen::ArrayXd kernel_1d = Eigen::ArrayXd::Random(9);
+    setSimdLevel(SimdLevel::Scalar);
+    Eigen::ArrayXXd direct = applyConvolution(input, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct);
+    Eigen::ArrayXXd separable = applySeparableConvolution(input, kernel_1d, kernel_1d, BorderMode::Constant, 0.5);
+    for (SimdLevel level: supportedLevels()) {
+        setSimdLevel(level);
+        EXPECT_TRUE(applyConvolution(input, kernel, BorderMode::Reflect, 0, ConvolutionMethod::Direct).isApprox(
+                direct, 1e-12));
+        EXPECT_TRUE(applySeparableConvolution(input, kernel_1d, kernel_1d, BorderMode::Constant, 0.5).isApprox(
+                separable, 1e-12));
+    }
+    setSimdLevel(detectSimdLevel());
+}
@@ -0,0 +1,157 @@
+//
+// Tests for the spectrum files and the save/load of FourierImage transforms.
+//
+
+#include <gtest/gtest.h>
+#include "SpectrumFile.hpp"
+#include "FourierImage.hpp"
+
+static string spectrumPath() {
+    return testing::TempDir() + "spectrum_test.bin";
+}
+
+TEST(spectrumFileTests, headerIsSixtyFourBytesAndDescribesSpectrum) {
+    SpectrumFile::Header header = SpectrumFile::makeHeader(10, 7, 3, false, SpectrumFile::Precision::Double);
+    EXPECT_EQ(sizeof(header), 64);
+    EXPECT_EQ(header.rows, 10);
+    EXPECT_EQ(header.cols, 7);
+    EXPECT_EQ(header.stored_cols, 4);
+    EXPECT_EQ(header.channels, 3);
+    EXPECT_EQ(header.centering, SpectrumFile::Centering::Centered);
+}
+
+TEST(spectrumFileTests, openThrowsForMissingOrInvalidFiles) {
+    EXPECT_THROW(SpectrumFile{"/nonexistent/spectrum.bin"}, runtime_error);
+    {
+        ofstream file(spectrumPath(), ios::binary | ios::trunc);
+        file << "this is not a spectrum file, but it is long enough to hold a header..........";
+    }
+    EXPECT_THROW(SpectrumFile{spectrumPath()}, runtime_error);
+
+    // dimensions whose product overflows, and empty files, are rejected from the header
+    for (auto header: {SpectrumFile::makeHeader(1 << 30, 1 << 30, 1 << 30, true, SpectrumFile::Precision::Double),
+                       SpectrumFile::makeHeader(4, 4, 0, true, SpectrumFile::Precision::Double)}) {
+        ofstream file = SpectrumFile::create(spectrumPath(), header);
+        file.close();
+        EXPECT_THROW(SpectrumFile{spectrumPath()}, runtime_error);
+    }
+    SpectrumFile::Header huge = SpectrumFile::makeHeader(4, 4, 1, true, SpectrumFile::Precision::Double);
+    huge.rows = (uint64_t) 1 << 62;
+    SpectrumFile::create(spectrumPath(), huge).close();
+    EXPECT_THROW(SpectrumFile{spectrumPath()}, runtime_error);
+}
+
+TEST(spectrumFileTests, truncatedFileIsRejected) {
+    Eigen::ArrayXXcd spectrum = Eigen::ArrayXXcd::Random(6, 4);
+    {
+        ofstream file = SpectrumFile::create(spectrumPath(), SpectrumFile::makeHeader(6, 6, 1, false,
+                                                                                      SpectrumFile::Precision::Double));
+        SpectrumFile::append(file, spectrum.leftCols(3), SpectrumFile::Precision::Double);
+    }
+    EXPECT_THROW(SpectrumFile{spectrumPath()}, runtime_error);
+}
+
+TEST(spectrumFileTests, writtenSpectraAreMappedBack) {
+    Eigen::ArrayXXcd first = Eigen::ArrayXXcd::Random(6, 4);
+    Eigen::ArrayXXcd second = Eigen::ArrayXXcd::Random(6, 4);
+    {
+        ofstream file = SpectrumFile::create(spectrumPath(), SpectrumFile::makeHeader(6, 7, 2, false,
+                                                                                      SpectrumFile::Precision::Double));
+        SpectrumFile::append(file, first, SpectrumFile::Precision::Double);
+        SpectrumFile::append(file, second, SpectrumFile::Precision::Double);
+    }
+    SpectrumFile file(spectrumPath());
+    EXPECT_EQ(file.getChannels(), 2);
+    EXPECT_FALSE(file.isFull());
+    EXPECT_TRUE((file.map(0) == first).all());
+    EXPECT_TRUE((file.map(1) == second).all());
+    EXPECT_THROW(file.map(2), invalid_argument);
+
+    // modifying the mapped spectrum does not change the file
+    file.map(0) *= 0;
+    EXPECT_TRUE((SpectrumFile(spectrumPath()).read(0) == first).all());
+}
+
+TEST(spectrumFileTests, singlePrecisionSpectraAreConvertedWhenRead) {
+    Eigen::ArrayXXcd spectrum = Eigen::ArrayXXcd::Random(5, 5);
+    {
+        ofstream file = SpectrumFile::create(spectrumPath(), SpectrumFile::makeHeader(5, 5, 1, true,
+                                                                                      SpectrumFile::Precision::Float));
+        SpectrumFile::append(file, spectrum, SpectrumFile::Precision::Float);
+    }
+    SpectrumFile file(spectrumPath());
+    EXPECT_TRUE(file.isFull());
+    EXPECT_THROW(file.map(0), runtime_error);
+    EXPECT_TRUE(file.read(0).isApprox(spectrum, 1e-6));
+}
+
+TEST(spectrumFileTests, loadedTransformFiltersLikeComputedTransform) {
+    vector<Eigen::ArrayXXd> channels;
+    for (int c = 0; c < 3; c++) {
+        channels.emplace_back((Eigen::ArrayXXd::Random(16, 21) + 1) / 2);
+    }
+    FourierImage computed(channels);
+    computed.setMultiChannel(true);
+    computed.applyTransform();
+    computed.saveTransform(spectrumPath());
+
+    FourierImage loaded(channels);
+    loaded.setMultiChannel(true);
+    loaded.loadTransform(spectrumPath());
+    ASSERT_EQ(loaded.getTransformChannels(), 3);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE((loaded.getTransform(c) == computed.getTransform(c)).all());
+    }
+
+    computed.applyBandPassFilter(0.1, 0.7, FrequencyMask::Profile::Gaussian);
+    loaded.applyBandPassFilter(0.1, 0.7, FrequencyMask::Profile::Gaussian);
+    FourierImage expected = computed.applyInverseTransform();
+    FourierImage result = loaded.applyInverseTransform();
+    ASSERT_EQ(result.getChannels(), 3);
+    for (int c = 0; c < 3; c++) {
+        EXPECT_TRUE(result.getData(c).isApprox(expected.getData(c), 1e-12));
+    }
+
+    // the file still holds the unfiltered transform
+    FourierImage reloaded(channels);
+    reloaded.setMultiChannel(true);
+    reloaded.loadTransform(spectrumPath());
+    EXPECT_TRUE(reloaded.getTransform(1).isApprox(expandHalfSpectrum(rdft2(channels[1]), 21), 1e-12));
+}
+
+TEST(spectrumFileTests, loadTransformThrowsForMismatchedImage) {
+    FourierImage image(1, (Eigen::ArrayXXd::Random(8, 8) + 1) / 2);
+    image.applyTransform();
+    image.saveTransform(spectrumPath());
+    FourierImage other(1, (Eigen::ArrayXXd::Random(8, 9) + 1) / 2);
+    EXPECT_THROW(other.loadTransform(spectrumPath()), invalid_argument);
+
+    // the number of spectra must match the channels transformed by the image
+    vector<Eigen::ArrayXXd> channels(3, (Eigen::ArrayXXd::Random(8, 8) + 1) / 2);
+    FourierImage color(channels);
+    color.setMultiChannel(true);
+    EXPECT_THROW(color.loadTransform(spectrumPath()), invalid_argument);
+    color.applyTransform();
+    color.saveTransform(spectrumPath());
+    color.setMultiChannel(false);
+    EXPECT_THROW(color.loadTransform(spectrumPath()), invalid_argument);
+    color.setMultiChannel(true);
+    EXPECT_NO_THROW(color.loadTransform(spectrumPath()));
+}
+
+TEST(spectrumFileTests, copiesOfLoadedImagesKeepTheirOwnSpectrum) {
+    FourierImage computed(1, (Eigen::ArrayXXd::Random(24, 30) + 1) / 2);
+    computed.applyTransform();
+    computed.saveTransform(spectrumPath());
+
+    FourierImage loaded(1, computed.getData(0));
+    loaded.loadTransform(spectrumPath());
+    FourierImage copy = loaded;
+    copy.applyLowPassFilter(0.3);
+    EXPECT_TRUE(loaded.getTransform().isApprox(computed.getTransform(), 1e-12));
+    EXPECT_FALSE(copy.getTransform().isApprox(computed.getTransform(), 1e-12));
+
+    // the copy no longer shares the mapped spectrum, which is now filtered in place
+    loaded.applyLowPassFilter(0.3);
+    EXPECT_TRUE(loaded.getTransform().isApprox(copy.getTransform(), 1e-12));
+}
@@ -0,0 +1,36 @@
+//
+// Helpers shared by the tests.
+//
+
+#ifndef IMAGEPROCESSING_TESTHELPERS_HPP
+#define IMAGEPROCESSING_TESTHELPERS_HPP
+
+#include <Eigen/Eigen>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "Image.hpp"
+
+// image with uniformly random pixels in [0, 1]
+inline Image randomImage(int rows, int cols, int channels) {
+    vector<Eigen::ArrayXXd> data;
+    for (int c = 0; c < channels; c++) {
+        data.emplace_back((Eigen::ArrayXXd::Random(rows, cols) + 1) / 2);
+    }
+    return Image(data);
+}
+
+// direct O(N^2) evaluation of the DFT (natural order, not normalized), used as reference
+inline vector<complex<double>> referenceTransform(const vector<complex<double>>& input, bool inverse) {
+    int N = (int) input.size();
+    double sign = inverse ? 1. : -1.;
+    vector<complex<double>> output(N, 0.);
+    for (int k = 0; k < N; k++) {
+        for (int n = 0; n < N; n++) {
+            output[k] += input[n] * polar(1., sign * 2 * M_PI * ((long long) k * n % N) / N);
+        }
+    }
+    return output;
+}
+
+#endif //IMAGEPROCESSING_TESTHELPERS_HPP
@@ -0,0 +1,78 @@
+//
+// Tests for the thread pool and the parallel Fourier transforms.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include "ThreadPool.hpp"
+#include "operations.hpp"
+
+TEST(threadPoolTests, constructorWithNonPositiveThreadsUsesHardwareThreads) {
+    ThreadPool pool(0);
+    EXPECT_GE(pool.getNumThreads(), 1);
+}
+
+TEST(threadPoolTests, parallelForRunsEveryIterationOnce) {
+    ThreadPool pool(4);
+    vector<atomic<int>> counts(1000);
+    pool.parallelFor(0, 1000, [&counts](int, int i) { counts[i]++; });
+    for (auto &count: counts) {
+        ASSERT_EQ(count, 1);
+    }
+}
+
+TEST(threadPoolTests, parallelForGivesValidWorkerIndices) {
+    ThreadPool pool(3);
+    atomic<bool> valid(true);
+    pool.parallelFor(0, 500, [&valid, &pool](int worker, int) {
+        if (worker < 0 || worker >= pool.getNumThreads()) {
+            valid = false;
+        }
+    });
+    EXPECT_TRUE(valid);
+}
+
+TEST(threadPoolTests, parallelForRethrowsExceptions) {
+    ThreadPool pool(4);
+    EXPECT_THROW(pool.parallelFor(0, 100, [](int, int i) {
+        if (i == 42) {
+            throw invalid_argument("error");
+        }
+    }), invalid_argument);
+}
+
+TEST(threadPoolTests, nestedParallelForCompletes) {
+    ThreadPool pool(2);
+    atomic<int> total(0);
+    pool.parallelFor(0, 8, [&](int, int) {
+        pool.parallelFor(0, 8, [&total](int, int) { total++; });
+    });
+    EXPECT_EQ(total, 64);
+}
+
+TEST(threadPoolTests, progressIsReportedUntilTotal) {
+    ThreadPool pool(2);
+    int last_done = -1;
+    int last_total = -1;
+    pool.parallelFor(0, 50, [](int, int) {}, [&](int done, int total) {
+        last_done = done;
+        last_total = total;
+    });
+    EXPECT_EQ(last_done, 50);
+    EXPECT_EQ(last_total, 50);
+}
+
+TEST(threadPoolTests, parallelTransformsMatchSingleThreadedTransforms) {
+    Eigen::ArrayXXd input = Eigen::ArrayXXd::Random(37, 64);
+    ThreadPool::setGlobalThreads(1);
+    Eigen::ArrayXXcd expected = dft2(input.cast<complex<double>>());
+    Eigen::ArrayXXcd expected_half = rdft2(input);
+    ThreadPool::setGlobalThreads(4);
+    Eigen::ArrayXXcd output = dft2(input.cast<complex<double>>());
+    Eigen::ArrayXXcd output_half = rdft2(input);
+    Eigen::ArrayXXd inverse = irdft2(output_half, 64);
+    ThreadPool::setGlobalThreads(0);
+    EXPECT_TRUE(output.isApprox(expected, 1e-12));
+    EXPECT_TRUE(output_half.isApprox(expected_half, 1e-12));
+    EXPECT_TRUE(inverse.isApprox(input, 1e-12));
+}
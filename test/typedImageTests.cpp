@@ -0,0 +1,193 @@
+//
+// Tests for the images with compact pixels and their native operations.
+//
+
+#include <gtest/gtest.h>
+#include "TypedImage.hpp"
+#include "operations.hpp"
+#include "Denoiser.hpp"
+#include "Histogram.hpp"
+#include "testHelpers.hpp"
+
+TEST(typedImageTests, pixelsUseTheSizeOfTheirType) {
+    TypedImage<uint8_t> image8(40, 30, 3);
+    TypedImage<uint16_t> image16(40, 30, 3);
+    TypedImage<float> image_float(40, 30, 3);
+    EXPECT_EQ(image8.getBuffer() + 40 * 30 * 3, &image8.getChannelView(2)(29, 39) + 1);
+    EXPECT_EQ(sizeof(*image8.getBuffer()), 1);
+    EXPECT_EQ(sizeof(*image16.getBuffer()), 2);
+    EXPECT_EQ(sizeof(*image_float.getBuffer()), 4);
+    EXPECT_EQ(TypedImage<uint8_t>::maxValue(), 255);
+    EXPECT_EQ(TypedImage<uint16_t>::maxValue(), 65535);
+    EXPECT_EQ(TypedImage<float>::maxValue(), 1);
+}
+
+TEST(typedImageTests, constructorAndSettersThrowOnInvalidArguments) {
+    EXPECT_THROW(TypedImage<uint8_t>(0, 10, 1), invalid_argument);
+    TypedImage<float> image(10, 8, 2);
+    EXPECT_THROW(image.setPixel(10, 0, 0, 0.5f), invalid_argument);
+    EXPECT_THROW(image.setPixel(0, 0, 2, 0.5f), invalid_argument);
+    EXPECT_THROW(image.setPixel(0, 0, 0, 1.5f), invalid_argument);
+    EXPECT_THROW(image.setChannel(0, Eigen::ArrayXXf::Zero(10, 8)), invalid_argument);
+    image.setPixel(3, 2, 1, 0.25f);
+    EXPECT_EQ(image.getPixel(3, 2, 1), 0.25f);
+}
+
+TEST(typedImageTests, movedImagesDoNotSharePixels) {
+    TypedImage<uint8_t> source(6, 4, 2);
+    source.setPixel(1, 2, 1, 7);
+    TypedImage<uint8_t> moved(std::move(source));
+    EXPECT_EQ(moved.getPixel(1, 2, 1), 7);
+
+    TypedImage<uint8_t> other(3, 3, 1);
+    TypedImage<uint8_t> target(5, 5, 1);
+    target = std::move(other);
+    EXPECT_EQ(target.getWidth(), 3);
+    EXPECT_NE(other.getBuffer(), target.getBuffer());
+    other = TypedImage<uint8_t>(3, 3, 1);
+    other.setPixel(0, 0, 0, 99);
+    EXPECT_EQ(target.getPixel(0, 0, 0), 0);
+    target = std::move(moved);
+    EXPECT_EQ(target.getBuffer(), &target.getChannelView(0)(0, 0));
+    EXPECT_EQ(target.getPixel(1, 2, 1), 7);
+}
+
+TEST(typedImageTests, conversionsRoundPixelsToTheirType) {
+    Image image = randomImage(12, 17, 3);
+    TypedImage<uint8_t> image8(image);
+    for (int c = 0; c < 3; c++) {
+        Eigen::ArrayXXd expected = (image.getData(c) * 255).round();
+        EXPECT_TRUE((image8.getChannelView(c).cast<double>() == expected).all());
+    }
+    EXPECT_LE((image8.toImage().getData(1) - image.getData(1)).abs().maxCoeff(), 0.5 / 255 + 1e-6);
+
+    // 8-bit pixels are exact in the other types, and come back unchanged
+    TypedImage<uint16_t> image16 = convertPixels<uint16_t>(image8);
+    EXPECT_EQ(image16.getPixel(5, 3, 2), image8.getPixel(5, 3, 2) * 257);
+    EXPECT_EQ(convertPixels<uint8_t>(image16), image8);
+    EXPECT_EQ(convertPixels<uint8_t>(convertPixels<float>(image8)), image8);
+
+    TypedImage<uint8_t> interleaved = image8.toLayout(ImageLayout::InterleavedRowMajor);
+    EXPECT_EQ(interleaved.getChannelStride(), 1);
+    EXPECT_EQ(interleaved, image8);
+    EXPECT_EQ(interleaved.toImage().getLayout(), ImageLayout::InterleavedRowMajor);
+}
+
+TEST(typedImageTests, separableConvolutionMatchesDoublePrecision) {
+    Image image = randomImage(33, 45, 3);
+    TypedImage<uint8_t> image8(image);
+    TypedImage<float> image_float(image);
+    Eigen::ArrayXd kernel = Eigen::ArrayXd::Constant(5, 0.2);
+    TypedImage<uint8_t> output8 = applySeparableConvolution(image8, kernel, kernel, BorderMode::Reflect);
+    TypedImage<float> output_float = applySeparableConvolution(image_float, kernel, kernel, BorderMode::Reflect);
+    for (int c = 0; c < 3; c++) {
+        Eigen::ArrayXXd expected = applySeparableConvolution(image8.toImage().getData(c), kernel, kernel,
+                                                             BorderMode::Reflect) * 255;
+        EXPECT_LE((output8.getChannelView(c).cast<double>() - expected).abs().maxCoeff(), 0.5 + 1e-3);
+        expected = applySeparableConvolution(image_float.toImage().getData(c), kernel, kernel, BorderMode::Reflect);
+        EXPECT_LE((output_float.getChannelView(c).cast<double>() - expected).abs().maxCoeff(), 1e-5);
+    }
+}
+
+TEST(typedImageTests, denoiserKeepsTheTypeAndBrightness) {
+    Image image = randomImage(40, 50, 3);
+    TypedImage<uint16_t> image16(image, ImageLayout::InterleavedRowMajor);
+    Denoiser denoiser(5, 1.5);
+    TypedImage<uint16_t> denoised = denoiser.denoise(image16);
+    EXPECT_EQ(denoised.getLayout(), ImageLayout::InterleavedRowMajor);
+    Eigen::ArrayXXd expected = applyConvolution(image16.toImage().getData(0), denoiser.getKernel()) * 65535;
+    EXPECT_LE((denoised.getChannelView(0).cast<double>() - expected).abs().maxCoeff(), 1);
+
+    // the recursive filter goes through double precision
+    TypedImage<uint8_t> recursive = Denoiser::recursiveGaussian(2).denoise(TypedImage<uint8_t>(image));
+    EXPECT_EQ(recursive.getChannels(), 3);
+    EXPECT_NEAR(recursive.getChannelView(1).cast<double>().mean(), image.getData(1).mean() * 255, 5);
+}
+
+TEST(typedImageTests, gradientMagnitudeMatchesDoublePrecision) {
+    Image image = randomImage(30, 35, 3);
+    TypedImage<uint8_t> image8(image);
+    Image expected = computeGradientMagnitude(image8.toImage());
+    TypedImage<uint8_t> magnitude = computeGradientMagnitude(image8);
+    EXPECT_EQ(magnitude.getChannels(), 1);
+    EXPECT_LE((magnitude.getChannelView(0).cast<double>() - expected.getData(0) * 255).abs().maxCoeff(), 0.5 + 1e-2);
+    TypedImage<float> magnitude_float = computeGradientMagnitude(TypedImage<float>(image));
+    EXPECT_LE((magnitude_float.getChannelView(0).cast<double>() -
+               computeGradientMagnitude(image).getData(0)).abs().maxCoeff(), 1e-5);
+    EXPECT_THROW(computeGradientMagnitude(TypedImage<uint8_t>(2, 2, 1)), invalid_argument);
+}
+
+TEST(typedImageTests, gradientMagnitudeOfConstantImageIsZero) {
+    TypedImage<uint8_t> constant(12, 9, 3);
+    TypedImage<uint8_t> magnitude = computeGradientMagnitude(constant);
+    EXPECT_EQ(magnitude.getChannels(), 1);
+    EXPECT_TRUE((magnitude.getChannelView(0) == 0).all());
+}
+
+TEST(typedImageTests, thresholdMatchesDoublePrecision) {
+    Image image = randomImage(25, 20, 1);
+    TypedImage<uint8_t> image8(image);
+    for (double threshold: {-0.5, 0.0, 0.3, 0.5, 1.0}) {
+        TypedImage<uint8_t> output = applyThreshold(image8, threshold);
+        Image expected = applyThreshold(image8.toImage(), threshold);
+        EXPECT_TRUE((output.getChannelView(0).cast<double>() == expected.getData(0) * 255).all());
+    }
+    TypedImage<uint16_t> color(randomImage(25, 20, 3));
+    TypedImage<uint16_t> output = applyThreshold(color, 0.5);
+    Image expected = applyThreshold(color.toImage(), 0.5);
+    EXPECT_LE((output.getChannelView(0).cast<double>() != expected.getData(0) * 65535).count(), 2);
+}
+
+TEST(typedImageTests, histogramMatchesDoublePrecision) {
+    Image image = randomImage(60, 40, 1);
+    TypedImage<uint8_t> image8(image);
+    Histogram histogram(50, 0.1, 0.9);
+    vector<vector<double>> expected = histogram.computeHistogram(image8.toImage());
+    EXPECT_EQ(histogram.computeHistogram(image8), expected);
+    EXPECT_EQ(histogram.computeHistogram(convertPixels<float>(image8)), expected);
+    double total = 0;
+    for (auto& bin: histogram.computeHistogram(TypedImage<uint16_t>(randomImage(60, 40, 3)))) {
+        total += bin[1];
+    }
+    EXPECT_GT(total, 0.7 * 60 * 40);
+}
+
+TEST(typedImageTests, wrapCvMatSharesTheBuffer) {
+    cv::Mat mat(6, 7, CV_8UC3);
+    for (int i = 0; i < 6; i++) {
+        for (int j = 0; j < 21; j++) {
+            mat.ptr<uchar>(i)[j] = (uchar) (i * 21 + j);
+        }
+    }
+    TypedImage<uint8_t> image = TypedImage<uint8_t>::wrapCvMat(mat);
+    EXPECT_TRUE(image.wrapsCvMat());
+    EXPECT_EQ(image.getLayout(), ImageLayout::InterleavedRowMajor);
+    EXPECT_EQ(image.getBuffer(), mat.ptr<uchar>(0));
+    EXPECT_EQ(image.getPixel(4, 2, 1), 2 * 21 + 4 * 3 + 1);
+    image.setPixel(4, 2, 1, 7);
+    EXPECT_EQ(mat.ptr<uchar>(2)[4 * 3 + 1], 7);
+    EXPECT_EQ(image.asCvMat().data, mat.data);
+
+    // copies own their pixels
+    TypedImage<uint8_t> copy = image;
+    EXPECT_FALSE(copy.wrapsCvMat());
+    EXPECT_EQ(copy, image);
+    copy.setPixel(0, 0, 0, 1);
+    EXPECT_NE(mat.ptr<uchar>(0)[0], 1);
+
+    // moves keep sharing the buffer of the Mat
+    TypedImage<uint8_t> moved = TypedImage<uint8_t>::wrapCvMat(mat);
+    copy = std::move(moved);
+    EXPECT_TRUE(copy.wrapsCvMat());
+    EXPECT_EQ(copy.getBuffer(), mat.ptr<uchar>(0));
+
+    // the native operations read the wrapped pixels
+    Image expected(mat, ImageLayout::InterleavedRowMajor);
+    EXPECT_EQ(image.toImage(), expected);
+
+    EXPECT_THROW(TypedImage<uint16_t>::wrapCvMat(mat), invalid_argument);
+    TypedImage<float> planar(3, 2, 1);
+    EXPECT_THROW(planar.asCvMat(), invalid_argument);
+    TypedImage<float> interleaved = planar.toLayout(ImageLayout::InterleavedRowMajor);
+    EXPECT_EQ((void*) interleaved.asCvMat().data, (void*) interleaved.getBuffer());
+}